@@ -0,0 +1,188 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "lockstep.h"
+#include "memory.h"
+
+namespace {
+  // Program counter and index register the opcode runs with, reset before each execution so
+  // jumps, skips and register transfers stay put
+  constexpr unsigned short bench_pc = 0x200;
+  constexpr unsigned short bench_index = 0x300;
+
+  // Machine with the registers the opcodes below read set to fixed values, so every run does the
+  // same work
+  struct Machine {
+    Machine() {
+      for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+        cpu.set_general_reg(reg, static_cast<unsigned char>(reg * 3));
+      }
+      cpu.index_reg = bench_index;
+    }
+
+    arch::CPU cpu{};
+    arch::Memory mem{};
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+  };
+
+  // Throughput of decode_execute on one opcode form, given as the opcode in the first argument
+  void decode_execute(benchmark::State& state) {
+    Machine machine;
+    const auto opcode = static_cast<unsigned short>(state.range(0));
+    for (auto _ : state) {
+      machine.cpu.curr_opcode = opcode;
+      machine.cpu.pc_reg = bench_pc;
+      machine.cpu.index_reg = bench_index;
+      machine.cpu.decode_execute(machine.mem, machine.graphics, machine.keypad);
+      benchmark::DoNotOptimize(machine.cpu.pc_reg);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(arch::disassemble(opcode));
+  }
+
+  // One opcode of each family that executes without touching the stack
+  BENCHMARK(decode_execute)
+      ->Arg(0x1200)   // Jump
+      ->Arg(0x3103)   // Skip on register and constant, taken
+      ->Arg(0x5120)   // Skip on two registers, not taken
+      ->Arg(0x6105)   // Load constant
+      ->Arg(0x7105)   // Add constant
+      ->Arg(0x8124)   // Add registers with carry
+      ->Arg(0x8126)   // Shift right
+      ->Arg(0xA300)   // Load index
+      ->Arg(0xB200)   // Jump with offset
+      ->Arg(0xC1FF)   // Random
+      ->Arg(0xE19E)   // Skip on key
+      ->Arg(0xF107)   // Read delay timer
+      ->Arg(0xF01E)   // Add to index
+      ->Arg(0xF129)   // Font character
+      ->Arg(0xF133)   // Binary coded decimal
+      ->Arg(0xF755)   // Store 8 registers
+      ->Arg(0xF765);  // Load 8 registers
+
+  // Call and return, which have to run as a pair to keep the stack balanced
+  void call_return(benchmark::State& state) {
+    Machine machine;
+    machine.mem.set_value(0x300, 0x00);
+    machine.mem.set_value(0x301, 0xEE);
+    for (auto _ : state) {
+      machine.cpu.curr_opcode = 0x2300;
+      machine.cpu.decode_execute(machine.mem, machine.graphics, machine.keypad);
+      machine.cpu.curr_opcode = 0x00EE;
+      machine.cpu.decode_execute(machine.mem, machine.graphics, machine.keypad);
+      benchmark::DoNotOptimize(machine.cpu.pc_reg);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+  }
+  BENCHMARK(call_return);
+
+  void fetch(benchmark::State& state) {
+    Machine machine;
+    machine.mem.set_value(bench_pc, 0x81);
+    machine.mem.set_value(bench_pc + 1, 0x24);
+    for (auto _ : state) {
+      machine.cpu.pc_reg = bench_pc;
+      machine.cpu.fetch(machine.mem);
+      benchmark::DoNotOptimize(machine.cpu.curr_opcode);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(fetch);
+
+  // DXYN with the sprite height in the first argument and its x coordinate in the second. Sprites
+  // at x 0 are byte aligned, those at 3 are not and those at 60 wrap around the right edge.
+  void draw(benchmark::State& state) {
+    Machine machine;
+    for (unsigned short i = 0; i < 15; i++) {
+      machine.mem.set_value(static_cast<unsigned short>(0x300 + i), 0xA5);
+    }
+    const auto height = static_cast<unsigned short>(state.range(0));
+    machine.cpu.set_general_reg(0x1, static_cast<unsigned char>(state.range(1)));
+    machine.cpu.set_general_reg(0x2, 28);  // Tall sprites also wrap around the bottom
+    const auto opcode = static_cast<unsigned short>(0xD120 | height);
+    for (auto _ : state) {
+      machine.cpu.curr_opcode = opcode;
+      machine.cpu.decode_execute(machine.mem, machine.graphics, machine.keypad);
+      benchmark::DoNotOptimize(machine.graphics);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["rows"] = benchmark::Counter(static_cast<double>(state.iterations() * height),
+                                                benchmark::Counter::kIsRate);
+  }
+  BENCHMARK(draw)->ArgsProduct({{1, 5, 15}, {0, 3, 60}});
+
+  void clear_screen(benchmark::State& state) {
+    arch::Graphics graphics{};
+    for (auto _ : state) {
+      graphics.clear_screen();
+      benchmark::DoNotOptimize(graphics);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(clear_screen);
+
+  // Reads every byte of memory through the bounds checked accessor
+  void memory_read(benchmark::State& state) {
+    arch::Memory mem{};
+    for (auto _ : state) {
+      unsigned int sum = 0;
+      for (unsigned short address = 0; address <= arch::max_mem_address; address++) {
+        sum += mem.get_value(address);
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * arch::mem_size);
+  }
+  BENCHMARK(memory_read);
+
+  // Writes every byte of memory, which also invalidates the predecoded caches
+  void memory_write(benchmark::State& state) {
+    arch::Memory mem{};
+    for (auto _ : state) {
+      for (unsigned short address = 0; address <= arch::max_mem_address; address++) {
+        mem.set_value(address, static_cast<unsigned char>(address));
+      }
+      benchmark::DoNotOptimize(mem);
+    }
+    state.SetBytesProcessed(state.iterations() * arch::mem_size);
+  }
+  BENCHMARK(memory_write);
+
+  // Builds a machine with a program of the size in the first argument loaded
+  void chip8_construction(benchmark::State& state) {
+    const std::vector<unsigned char> program(static_cast<size_t>(state.range(0)), 0x70);
+    for (auto _ : state) {
+      Chip8 emulator(program);
+      benchmark::DoNotOptimize(emulator);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(chip8_construction)->Arg(0)->Arg(256)->Arg(3584);
+
+  // Lane instructions per second of a lockstep engine with the number of lanes in the first
+  // argument, all running the same register only loop so that every step covers every lane.
+  // 0x200: 7001 (V0 += 1), 0x202: 8014 (V0 += V1), 0x204: 8125 (V1 -= V2), 0x206: 7201 (V2 += 1),
+  // 0x208: 1200 (jump to 0x200)
+  void lockstep(benchmark::State& state) {
+    const auto lanes = static_cast<size_t>(state.range(0));
+    arch::Lockstep engine(
+        boot_memory<arch::CheckedAccess>({0x70, 0x01, 0x80, 0x14, 0x81, 0x25, 0x72, 0x01, 0x12,
+                                          0x00}),
+        lanes);
+    constexpr size_t instructions = 1000;
+    for (auto _ : state) {
+      engine.run(instructions);
+      benchmark::DoNotOptimize(engine.general_reg(0, 0));
+    }
+    state.SetItemsProcessed(static_cast<long long>(state.iterations() * lanes * instructions));
+  }
+  BENCHMARK(lockstep)->Arg(1)->Arg(8)->Arg(32)->Arg(256)->Arg(1024);
+}  // namespace
+
+BENCHMARK_MAIN();
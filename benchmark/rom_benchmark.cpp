@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/resource.h>
+#endif
+
+#include "chip8.h"
+#include "display/null_frontend.h"
+#include "frontend_loop.h"
+
+namespace {
+  // A ROM or a synthetic program to run
+  struct Workload {
+    std::string name;
+    std::vector<unsigned char> program;
+  };
+
+  // Programs that stress one part of the emulator each
+  std::vector<Workload> synthetic_workloads() {
+    return {
+        // 0x200: 7001 (V0 += 1), 0x202: 8014 (V0 += V1), 0x204: 8125 (V1 -= V2),
+        // 0x206: 7201 (V2 += 1), 0x208: 3200 (skip if V2 == 0), 0x20A: 1200 (jump to 0x200),
+        // 0x20C: 1200 (jump to 0x200)
+        {"synthetic_alu",
+         {0x70, 0x01, 0x80, 0x14, 0x81, 0x25, 0x72, 0x01, 0x32, 0x00, 0x12, 0x00, 0x12, 0x00}},
+        // 0x200: A000 (I = sprite for 0), 0x202: D015 (draw at V0, V1), 0x204: 7003 (V0 += 3),
+        // 0x206: 7101 (V1 += 1), 0x208: 1202 (jump to 0x202)
+        {"synthetic_draw", {0xA0, 0x00, 0xD0, 0x15, 0x70, 0x03, 0x71, 0x01, 0x12, 0x02}},
+        // 0x200: 6002 (V0 = 2), 0x202: F015 (delay timer = V0), 0x204: F007 (V0 = delay timer),
+        // 0x206: 3000 (skip if V0 == 0), 0x208: 1204 (jump to 0x204), 0x20A: 1200 (jump to 0x200)
+        {"synthetic_delay_wait",
+         {0x60, 0x02, 0xF0, 0x15, 0xF0, 0x07, 0x30, 0x00, 0x12, 0x04, 0x12, 0x00}},
+    };
+  }
+
+  std::vector<Workload> rom_workloads(const std::filesystem::path& directory) {
+    std::vector<Workload> workloads;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+      if (entry.path().extension() != ".rom") {
+        continue;
+      }
+      std::ifstream rom(entry.path(), std::fstream::binary);
+      workloads.push_back({entry.path().stem().string(),
+                           std::vector<unsigned char>((std::istreambuf_iterator<char>(rom)),
+                                                      std::istreambuf_iterator<char>())});
+    }
+    std::sort(workloads.begin(), workloads.end(),
+              [](const Workload& a, const Workload& b) { return a.name < b.name; });
+    return workloads;
+  }
+
+  // Largest resident set of the process so far in KiB, 0 where it cannot be measured
+  long peak_rss_kib() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#  if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#  else
+    return usage.ru_maxrss;
+#  endif
+#else
+    return 0;
+#endif
+  }
+
+  // Mean of a set of repetitions and the half width of its 95% confidence interval
+  struct Estimate {
+    double mean;
+    double half_width;
+  };
+
+  // Student's t for a two sided 95% interval, indexed by degrees of freedom
+  constexpr std::array<double, 31> t_95{0,     12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                                        2.306, 2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                                        2.120, 2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069,
+                                        2.064, 2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+
+  Estimate estimate(const std::vector<double>& samples) {
+    const auto n = samples.size();
+    double sum = 0;
+    for (const auto sample : samples) {
+      sum += sample;
+    }
+    const auto mean = sum / static_cast<double>(n);
+    if (n < 2) {
+      return {mean, 0};
+    }
+
+    double squares = 0;
+    for (const auto sample : samples) {
+      squares += (sample - mean) * (sample - mean);
+    }
+    const auto deviation = std::sqrt(squares / static_cast<double>(n - 1));
+    const auto t = n - 1 < t_95.size() ? t_95[n - 1] : 1.960;
+    return {mean, t * deviation / std::sqrt(static_cast<double>(n))};
+  }
+
+  struct Options {
+    std::filesystem::path roms = CHIP8_ROMS_DIR;
+    double seconds = 60;  // Guest time each repetition emulates
+    size_t repetitions = 5;
+    bool csv = false;
+    arch::Timing timing = arch::Timing::instructions;
+    std::optional<arch::Tier> tier;  // Tiered promotion unless set
+  };
+
+  std::optional<arch::Tier> parse_tier(const std::string& name) {
+    if (name == "interpreter") {
+      return arch::Tier::interpreter;
+    }
+    if (name == "predecoded") {
+      return arch::Tier::predecoded;
+    }
+    if (name == "translated") {
+      return arch::Tier::translated;
+    }
+    return std::nullopt;
+  }
+
+  // Measurements of one workload over every repetition
+  struct Result {
+    std::string name;
+    size_t frames;        // Frames per repetition
+    size_t instructions;  // Guest instructions per repetition
+    Estimate instructions_per_second;
+    Estimate frames_per_second;
+    Estimate ns_per_frame;
+    long peak_rss_kib;  // Of the whole process after the workload ran
+  };
+
+  Result run(const Workload& workload, const Options& options) {
+    FrontendOptions frontend_options;
+    frontend_options.max_frames = static_cast<size_t>(options.seconds * arch::timer_frequency);
+
+    Result result{workload.name, frontend_options.max_frames, 0, {}, {}, {}, 0};
+    std::vector<double> instructions_per_second;
+    std::vector<double> frames_per_second;
+    std::vector<double> ns_per_frame;
+
+    for (size_t repetition = 0; repetition < options.repetitions; repetition++) {
+      BasicChip8<arch::DefaultAccess> emulator(workload.program);
+      emulator.set_timing(options.timing);
+      emulator.force_tier(options.tier);
+      display::NullFrontend frontend;
+
+      const auto start = std::chrono::steady_clock::now();
+      const auto frontend_result = run_frontend(emulator, frontend, frontend_options);
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (frontend_result.stop == FrontendStop::trap) {
+        std::cerr << std::format("{0} stopped with {1} after {2} frames\n", workload.name,
+                                 arch::fault_name(emulator.trap().fault), frontend_result.frames);
+      }
+
+      const auto frames = static_cast<double>(frontend_result.frames);
+      result.frames = frontend_result.frames;
+      result.instructions = frontend_result.cycles;
+      instructions_per_second.push_back(static_cast<double>(frontend_result.cycles)
+                                        / elapsed.count());
+      frames_per_second.push_back(frames / elapsed.count());
+      ns_per_frame.push_back(elapsed.count() * 1e9 / frames);
+    }
+
+    result.instructions_per_second = estimate(instructions_per_second);
+    result.frames_per_second = estimate(frames_per_second);
+    result.ns_per_frame = estimate(ns_per_frame);
+    result.peak_rss_kib = peak_rss_kib();
+    return result;
+  }
+
+  void print_json(const std::vector<Result>& results, const Options& options) {
+    std::cout << std::format("{{\n  \"guest_seconds\": {0},\n  \"repetitions\": {1},\n",
+                             options.seconds, options.repetitions);
+    std::cout << "  \"confidence\": 0.95,\n  \"workloads\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      const auto& result = results[i];
+      const auto field = [](const char* name, const Estimate& value) {
+        return std::format("\"{0}\": {{\"mean\": {1:.6g}, \"ci95\": {2:.6g}}}", name, value.mean,
+                           value.half_width);
+      };
+      std::cout << std::format(
+          "    {{\"name\": \"{0}\", \"frames\": {1}, \"instructions\": {2}, {3}, {4}, {5}, "
+          "\"peak_rss_kib\": {6}}}{7}\n",
+          result.name, result.frames, result.instructions,
+          field("instructions_per_second", result.instructions_per_second),
+          field("frames_per_second", result.frames_per_second),
+          field("ns_per_frame", result.ns_per_frame), result.peak_rss_kib,
+          i + 1 < results.size() ? "," : "");
+    }
+    std::cout << "  ]\n}\n";
+  }
+
+  void print_csv(const std::vector<Result>& results) {
+    std::cout << "name,frames,instructions,instructions_per_second,instructions_per_second_ci95,"
+                 "frames_per_second,frames_per_second_ci95,ns_per_frame,ns_per_frame_ci95,"
+                 "peak_rss_kib\n";
+    for (const auto& result : results) {
+      std::cout << std::format("{0},{1},{2},{3:.6g},{4:.6g},{5:.6g},{6:.6g},{7:.6g},{8:.6g},{9}\n",
+                               result.name, result.frames, result.instructions,
+                               result.instructions_per_second.mean,
+                               result.instructions_per_second.half_width,
+                               result.frames_per_second.mean, result.frames_per_second.half_width,
+                               result.ns_per_frame.mean, result.ns_per_frame.half_width,
+                               result.peak_rss_kib);
+    }
+  }
+}  // namespace
+
+// Runs every ROM in the roms directory and a few synthetic programs headlessly for a fixed amount
+// of guest time, repeatedly, and prints their throughput with 95% confidence intervals
+int main(int argc, char** argv) {
+  Options options;
+  for (auto i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const auto has_value = i + 1 < argc;
+    if (arg == "--roms" && has_value) {
+      options.roms = argv[++i];
+    } else if (arg == "--seconds" && has_value) {
+      options.seconds = std::stod(argv[++i]);
+    } else if (arg == "--repetitions" && has_value) {
+      options.repetitions = std::max<size_t>(1, std::stoull(argv[++i]));
+    } else if (arg == "--csv") {
+      options.csv = true;
+    } else if (arg == "--vip-timing") {
+      options.timing = arch::Timing::vip_cycles;
+    } else if (arg == "--tier" && has_value && parse_tier(argv[i + 1])) {
+      options.tier = parse_tier(argv[++i]);
+    } else {
+      std::string current_exec_name = argv[0];
+      std::cout << "Usage: " << current_exec_name
+                << " [--roms < directory >] [--seconds < guest seconds >]"
+                   " [--repetitions < count >] [--csv] [--vip-timing]"
+                   " [--tier interpreter|predecoded|translated]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Workload> workloads;
+  if (std::filesystem::is_directory(options.roms)) {
+    workloads = rom_workloads(options.roms);
+  } else {
+    std::cerr << "No ROM directory at " << options.roms << ", running synthetic workloads only"
+              << std::endl;
+  }
+  for (auto& workload : synthetic_workloads()) {
+    workloads.push_back(std::move(workload));
+  }
+
+  std::vector<Result> results;
+  for (const auto& workload : workloads) {
+    results.push_back(run(workload, options));
+  }
+
+  if (options.csv) {
+    print_csv(results);
+  } else {
+    print_json(results, options);
+  }
+}
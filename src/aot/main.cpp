@@ -0,0 +1,36 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "aot.h"
+
+// Compiles a ROM ahead of time into a C++ translation unit, see arch::recompile
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    std::string current_exec_name = argv[0];
+    std::cout << "Usage: " << current_exec_name
+              << " < path to rom > < path to output .cpp > [ program name ] " << std::endl;
+    return 1;
+  }
+
+  const std::string rom_path = argv[1];
+  const std::string output_path = argv[2];
+  const std::string name = argc == 4 ? argv[3] : "aot_program";
+
+  std::ifstream rom_file(rom_path, std::fstream::binary);
+  if (!rom_file) {
+    std::cerr << "Could not open " << rom_path << std::endl;
+    return 1;
+  }
+  const std::vector<unsigned char> rom((std::istreambuf_iterator<char>(rom_file)),
+                                       std::istreambuf_iterator<char>());
+
+  std::ofstream output(output_path);
+  output << arch::recompile(rom, name, rom_path);
+  if (!output) {
+    std::cerr << "Could not write " << output_path << std::endl;
+    return 1;
+  }
+}
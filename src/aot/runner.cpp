@@ -0,0 +1,85 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "aot.h"
+#include "chip8.h"
+
+// Defined by the translation unit chip8_aot generated for the ROM
+extern const arch::AotProgram aot_program;
+
+namespace {
+  // FNV-1a over everything an instruction can change, so runs can be compared for bit exactness
+  unsigned long long digest(const arch::CPU& cpu, const arch::Memory& mem,
+                            const arch::Graphics& graphics) {
+    unsigned long long hash = 0xCBF29CE484222325;
+    const auto add = [&](unsigned int value) {
+      hash = (hash ^ value) * 0x100000001B3;
+    };
+
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      add(cpu.get_general_reg(reg));
+    }
+    add(cpu.index_reg);
+    add(cpu.pc_reg);
+    add(cpu.get_stack_pointer());
+    add(cpu.delay_timer_reg);
+    add(cpu.sound_timer_reg);
+    for (unsigned short address = 0; address <= arch::max_mem_address; address++) {
+      add(mem.get_value(address));
+    }
+    for (size_t y = 0; y < arch::graphics::screen_height; y++) {
+      for (size_t x = 0; x < arch::graphics::screen_width; x++) {
+        add(graphics.get_pixel(x, y));
+      }
+    }
+    return hash;
+  }
+}  // namespace
+
+// Runs the ROM compiled into this binary for a number of instructions, either through the compiled
+// blocks or with --interpret through the interpreter, and prints the speed and a digest of the
+// final machine state
+int main(int argc, char** argv) {
+  size_t instructions = 100'000'000;
+  auto interpret = false;
+  for (auto i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--interpret") {
+      interpret = true;
+    } else {
+      instructions = std::stoull(arg);
+    }
+  }
+
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  for (size_t i = 0; i < chip8_fontset.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(i), chip8_fontset[i]);
+  }
+  for (size_t i = 0; i < aot_program.rom_size; i++) {
+    mem.set_value(static_cast<unsigned short>(arch::pc_start_value + i), aot_program.rom[i]);
+  }
+
+  arch::AotEngine engine(aot_program);
+  const auto start = std::chrono::steady_clock::now();
+  if (interpret) {
+    cpu.try_run(mem, graphics, keypad, instructions);
+  } else {
+    engine.run(cpu, mem, graphics, keypad, instructions);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  if (cpu.trapped()) {
+    const auto& trap = cpu.trap();
+    std::cout << std::format("Stopped with {0} at {1:#05x} (opcode {2:#06x})\n",
+                             arch::fault_name(trap.fault), trap.pc, trap.opcode);
+  }
+  std::cout << std::format("{0} instructions in {1:.3f} s, {2:.1f} M instructions per second\n",
+                           instructions, elapsed.count(),
+                           static_cast<double>(instructions) / elapsed.count() / 1e6);
+  std::cout << std::format("State digest {0:016x}\n", digest(cpu, mem, graphics));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace arch {
+  // Bounds policies that BasicMemory, BasicGraphics and everything built on them are templated on.
+  // They decide what happens to an address or pixel coordinate that is past the end of the
+  // machine. Every size they are used with is a power of two, so wrapping is a single mask.
+
+  // Rejects out of range indices by throwing OutOfRange, and makes the CPU trap on them. This is
+  // the behaviour the emulator has always had and what the tests expect.
+  struct CheckedAccess {
+    static constexpr bool wraps = false;
+
+    template <class OutOfRange>
+    static size_t index(size_t index, size_t size) {
+      if (index >= size) {
+        throw OutOfRange();
+      }
+      return index;
+    }
+  };
+
+  // Wraps out of range indices around the way the hardware does with its 12 bit address bus, so
+  // every access compiles down to a masked array index and nothing can fail.
+  struct WrappingAccess {
+    static constexpr bool wraps = true;
+
+    template <class OutOfRange>
+    static constexpr size_t index(size_t index, size_t size) noexcept {
+      return index & (size - 1);
+    }
+  };
+
+  // Policy the emulator application is built with. Bounds checks are only kept when the
+  // CHIP8_CHECKED_ACCESS option is set.
+#if defined(CHIP8_CHECKED_ACCESS)
+  using DefaultAccess = CheckedAccess;
+#else
+  using DefaultAccess = WrappingAccess;
+#endif
+}  // namespace arch
@@ -0,0 +1,294 @@
+#include "aot.h"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+namespace {
+  // Ops that can trap, which need the program counter and opcode in place for the trap record
+  constexpr bool can_trap(arch::Op op) {
+    return op == arch::Op::op_00EE || op == arch::Op::op_2NNN || op == arch::Op::op_DXYN
+           || op == arch::Op::op_FX33 || op == arch::Op::op_FX55 || op == arch::Op::op_FX65;
+  }
+
+  // Ops that set the program counter themselves
+  constexpr bool sets_pc(arch::Op op) {
+    return op == arch::Op::op_00EE || op == arch::Op::op_1NNN || op == arch::Op::op_2NNN
+           || op == arch::Op::op_BNNN || op == arch::Op::op_FX0A || is_skip(op);
+  }
+
+  // Ops that read the program counter they are executed with
+  constexpr bool reads_pc(arch::Op op) {
+    return can_trap(op) || op == arch::Op::op_FX0A || is_skip(op);
+  }
+
+  constexpr bool is_store(unsigned short opcode) {
+    return (opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055;
+  }
+
+  std::string block_name(unsigned short address) { return std::format("block_{0:04X}", address); }
+
+  // Addresses control can statically pass to after the last instruction of block, the first for
+  // when a jump or skip is taken. Empty where that is only known at run time.
+  std::vector<size_t> successors(const arch::AotBlockSource& block) {
+    const auto last = block.opcodes.back();
+    const auto op = arch::decode_op(last);
+    const size_t end = block.address + 2 * block.opcodes.size();
+
+    if (op == arch::Op::op_1NNN || op == arch::Op::op_2NNN) {
+      return {static_cast<size_t>(last & 0x0FFF)};
+    } else if (is_skip(op)) {
+      return {end + 2, end};
+    } else if (op == arch::Op::op_00EE || op == arch::Op::op_BNNN) {
+      return {};
+    }
+    return {end};
+  }
+}  // namespace
+
+std::vector<arch::AotBlockSource> arch::find_aot_blocks(const std::vector<unsigned char>& rom) {
+  const size_t rom_end = pc_start_value + rom.size();
+  const auto in_rom
+      = [&](size_t address) { return address >= pc_start_value && address + 1 < rom_end; };
+
+  std::vector<AotBlockSource> blocks;
+  std::vector<bool> queued(mem_size, false);
+  std::vector<unsigned short> pending;
+
+  const auto add_target = [&](size_t address) {
+    if (in_rom(address) && !queued[address]) {
+      queued[address] = true;
+      pending.push_back(static_cast<unsigned short>(address));
+    }
+  };
+  add_target(pc_start_value);
+
+  while (!pending.empty()) {
+    AotBlockSource block{pending.back(), {}};
+    pending.pop_back();
+
+    size_t pc = block.address;
+    auto ends = false;
+    while (!ends && block.opcodes.size() < aot_max_block_length && in_rom(pc)) {
+      const auto offset = pc - pc_start_value;
+      const auto opcode = static_cast<unsigned short>(rom[offset] << 8 | rom[offset + 1]);
+      const auto op = decode_op(opcode);
+      // Left to the interpreter, which traps on it
+      if (op == Op::op_invalid) {
+        break;
+      }
+
+      block.opcodes.push_back(opcode);
+      const auto next = pc + 2;
+      const auto nnn = static_cast<size_t>(opcode & 0x0FFF);
+      ends = true;
+
+      if (op == Op::op_1NNN) {
+        add_target(nnn);
+      } else if (op == Op::op_2NNN) {
+        add_target(nnn);
+        add_target(next);
+      } else if (op == Op::op_BNNN) {
+        // Usually a jump table of 1NNN instructions indexed by V0
+        for (size_t entry = 0; entry <= 0xFF; entry += 2) {
+          add_target(nnn + entry);
+        }
+      } else if (is_skip(op)) {
+        add_target(next);
+        add_target(next + 2);
+      } else if (op == Op::op_FX0A || op == Op::op_FX33 || op == Op::op_FX55) {
+        add_target(next);
+      } else {
+        ends = op == Op::op_00EE;
+      }
+      pc = next;
+    }
+
+    // A block cut short by its length carries on in the next one
+    if (!ends && block.opcodes.size() == aot_max_block_length) {
+      add_target(pc);
+    }
+    if (!block.opcodes.empty()) {
+      blocks.push_back(std::move(block));
+    }
+  }
+
+  std::sort(blocks.begin(), blocks.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.address < rhs.address; });
+  return blocks;
+}
+
+std::string arch::recompile(const std::vector<unsigned char>& rom, const std::string& name,
+                            const std::string& source_name) {
+  const auto blocks = find_aot_blocks(rom);
+
+  auto out = std::format("// Generated by chip8_aot from {0}, do not edit.\n\n", source_name);
+  out += "#include <array>\n\n#include \"aot.h\"\n#include \"cpu_handlers.h\"\n\nnamespace {\n";
+  out += "  using arch::AotEngine;\n\n";
+
+  out += std::format("  constexpr std::array<unsigned char, {0}> rom{{", rom.size());
+  for (size_t i = 0; i < rom.size(); i++) {
+    out += std::format("{0}0x{1:02X},", i % 12 == 0 ? "\n      " : " ", rom[i]);
+  }
+  out += rom.empty() ? "};\n" : "\n  };\n";
+
+  for (const auto& block : blocks) {
+    const auto end = static_cast<unsigned short>(block.address + 2 * block.opcodes.size());
+    out += std::format("\n  // 0x{0:04X} to 0x{1:04X}\n", block.address, end);
+    out += std::format(
+        "  size_t {0}(arch::CPU& cpu, arch::Memory& mem, arch::Graphics& graphics,\n"
+        "                    arch::Keypad& keypad) {{\n",
+        block_name(block.address));
+
+    for (size_t i = 0; i < block.opcodes.size(); i++) {
+      const auto opcode = block.opcodes[i];
+      const auto op = decode_op(opcode);
+      const auto next = block.address + 2 * (i + 1);
+
+      out += std::format("    // {0}\n", disassemble(opcode));
+      if (reads_pc(op)) {
+        out += std::format("    cpu.pc_reg = 0x{0:04X};\n", next);
+      }
+      if (can_trap(op)) {
+        out += std::format("    cpu.curr_opcode = 0x{0:04X};\n", opcode);
+      }
+      out += std::format("    AotEngine::execute<0x{0:04X}>(cpu, mem, graphics, keypad);\n",
+                         opcode);
+      // The rest of the block is skipped once an instruction traps
+      if (can_trap(op) && i + 1 < block.opcodes.size()) {
+        out += std::format("    if (cpu.trapped()) {{\n      return {0};\n    }}\n", i + 1);
+      }
+    }
+
+    if (!sets_pc(decode_op(block.opcodes.back()))) {
+      out += std::format("    cpu.pc_reg = 0x{0:04X};\n", end);
+    }
+    out += std::format("    return {0};\n  }}\n", block.opcodes.size());
+  }
+
+  if (!blocks.empty()) {
+    out += std::format("\n  const std::array<arch::AotBlock, {0}> blocks{{{{\n", blocks.size());
+    for (const auto& block : blocks) {
+      std::array<std::string, 2> next{"nullptr", "nullptr"};
+      const auto targets = successors(block);
+      for (size_t i = 0; i < targets.size(); i++) {
+        const auto target = std::lower_bound(
+            blocks.begin(), blocks.end(), targets[i],
+            [](const auto& candidate, size_t address) { return candidate.address < address; });
+        if (target != blocks.end() && target->address == targets[i]) {
+          next[i] = std::format("&blocks[{0}]", target - blocks.begin());
+        }
+      }
+      out += std::format("      {{0x{0:04X}, {1}, 0x{2:04X}, {3}, {{{4}, {5}}}}},\n", block.address,
+                         block.opcodes.size(), block.opcodes.back(), block_name(block.address),
+                         next[0], next[1]);
+    }
+    out += "  }};\n";
+  }
+
+  out += "\n  const arch::AotBlock* lookup(unsigned short address) {\n    switch (address) {\n";
+  for (size_t i = 0; i < blocks.size(); i++) {
+    out += std::format("      case 0x{0:04X}:\n        return &blocks[{1}];\n", blocks[i].address,
+                       i);
+  }
+  out += "      default:\n        return nullptr;\n    }\n  }\n}  // namespace\n\n";
+
+  out += std::format("extern const arch::AotProgram {0};\n", name);
+  out += std::format("const arch::AotProgram {0}{{rom.data(), rom.size(), lookup}};\n", name);
+  return out;
+}
+
+arch::AotEngine::AotEngine(const AotProgram& program) : program(&program) { reset(); }
+
+size_t arch::AotEngine::run(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad,
+                            size_t count) {
+  size_t executed = 0;
+  size_t compiled = 0;
+  auto screen_changed = false;
+
+  const auto* block = program->lookup(cpu.pc_reg);
+  while (executed < count && !cpu.trapped()) {
+    if (block != nullptr && block->length <= count - executed && is_current(*block, mem)) {
+      cpu.updated_screen = false;
+      const auto block_executed = block->code(cpu, mem, graphics, keypad);
+      executed += block_executed;
+      compiled += block_executed;
+      screen_changed = screen_changed || cpu.updated_screen;
+
+      const auto last = block->last_opcode;
+      if (!cpu.trapped()) {
+        cpu.curr_opcode = last;
+      }
+      // A store can only be the final instruction of a block. FX55 has already moved the index
+      // register past what it wrote.
+      if (!cpu.trapped() && is_store(last)) {
+        const auto index = (last & 0xF0FF) == 0xF055 ? cpu.index_reg - ((last & 0x0F00) >> 8) - 1
+                                                     : cpu.index_reg;
+        invalidate_stores(last, static_cast<unsigned short>(index));
+      }
+      block = next_block(*block, cpu.pc_reg);
+      continue;
+    }
+
+    // Fall back to the interpreter for a single instruction
+    const auto index_before = cpu.index_reg;
+    cpu.try_step(mem, graphics, keypad);
+    executed++;
+    screen_changed = screen_changed || cpu.updated_screen;
+    invalidate_stores(cpu.curr_opcode, index_before);
+    block = program->lookup(cpu.pc_reg);
+  }
+
+  cpu.updated_screen = screen_changed;
+  return compiled;
+}
+
+void arch::AotEngine::invalidate(unsigned short address) noexcept {
+  if (address > max_mem_address) {
+    return;
+  }
+
+  // Only blocks starting at most a full block length before address can cover it
+  constexpr size_t max_block_bytes = 2 * aot_max_block_length;
+  const size_t first = address >= max_block_bytes ? address - max_block_bytes + 1 : 0;
+  std::fill(states.begin() + first, states.begin() + address + 1, BlockState::unchecked);
+}
+
+void arch::AotEngine::reset() noexcept { states.fill(BlockState::unchecked); }
+
+bool arch::AotEngine::check(const AotBlock& block, const Memory& mem) noexcept {
+  auto& state = states[block.address];
+  state = BlockState::current;
+  const size_t offset = block.address - pc_start_value;
+  for (size_t i = 0; i < 2 * block.length; i++) {
+    if (mem.get_value_unchecked(static_cast<unsigned short>(block.address + i))
+        != program->rom[offset + i]) {
+      state = BlockState::stale;
+      break;
+    }
+  }
+  return state == BlockState::current;
+}
+
+const arch::AotBlock* arch::AotEngine::next_block(const AotBlock& block,
+                                                  unsigned short address) const noexcept {
+  for (const auto* next : block.next) {
+    if (next != nullptr && next->address == address) {
+      return next;
+    }
+  }
+  return program->lookup(address);
+}
+
+void arch::AotEngine::invalidate_stores(unsigned short opcode, unsigned short index) noexcept {
+  size_t written = 0;
+  if ((opcode & 0xF0FF) == 0xF033) {
+    written = 3;
+  } else if ((opcode & 0xF0FF) == 0xF055) {
+    written = ((opcode & 0x0F00) >> 8) + 1;
+  }
+
+  for (size_t i = 0; i < written; i++) {
+    invalidate(static_cast<unsigned short>(index + i));
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace arch {
+  constexpr size_t aot_max_block_length = 64;  // Most instructions compiled into one block
+
+  // Compiled code of a guest basic block. Executes the instructions starting at the program
+  // counter and returns how many were executed, which is less than the length of the block if one
+  // of them trapped.
+  using AotBlockFunction = size_t (*)(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad);
+
+  struct AotBlock {
+    unsigned short address;      // Guest address of the first instruction
+    unsigned short length;       // Number of guest instructions in the block
+    unsigned short last_opcode;  // Opcode of the final instruction in the block
+    AotBlockFunction code;
+
+    // Blocks that can run next as found when the ROM was compiled, which saves going through
+    // AotProgram::lookup. nullptr where the next block is only known at run time.
+    std::array<const AotBlock*, 2> next;
+  };
+
+  // What chip8_aot emits for a ROM
+  struct AotProgram {
+    const unsigned char* rom;  // Bytes the blocks were compiled from, loaded at pc_start_value
+    size_t rom_size;
+
+    // Switch on the program counter. Returns the block starting at address, nullptr if there is
+    // none. Used for the targets of BNNN and 00EE and any other block entry that AotBlock::next
+    // does not cover.
+    const AotBlock* (*lookup)(unsigned short address);
+  };
+
+  // Guest basic block found by disassembling a ROM, before it is compiled
+  struct AotBlockSource {
+    unsigned short address;               // Guest address of the first instruction
+    std::vector<unsigned short> opcodes;  // Opcodes of the block in order
+  };
+
+  // Statically disassembles rom, loaded at pc_start_value, into the basic blocks reachable from
+  // its entry point. A block ends at a jump, call, return, skip, FX0A or store (FX33 and FX55), at
+  // an invalid opcode or after aot_max_block_length instructions. Blocks may overlap when code
+  // jumps into the middle of another block. Returned in order of address.
+  [[nodiscard]] std::vector<AotBlockSource> find_aot_blocks(const std::vector<unsigned char>& rom);
+
+  // Emits a C++ translation unit defining the AotProgram name for rom. source_name only appears in
+  // the header comment. The generated code includes aot.h and cpu_handlers.h.
+  [[nodiscard]] std::string recompile(const std::vector<unsigned char>& rom,
+                                      const std::string& name, const std::string& source_name);
+
+  // Runs code compiled ahead of time by chip8_aot. Blocks are only entered while the bytes they
+  // were compiled from are still in memory, anything else, including code the program wrote over
+  // itself, runs through the interpreter.
+  class AotEngine {
+  public:
+    explicit AotEngine(const AotProgram& program);
+
+    // Runs count instructions starting at the program counter of cpu and returns how many were
+    // executed by compiled code. Blocks are only entered when they fit in the remaining count so
+    // that exactly count instructions are executed. updated_screen is set if any instruction
+    // updated the screen. Stops early if an instruction traps, see CPU::trap.
+    size_t run(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad, size_t count);
+
+    // Makes blocks that cover address check their bytes against memory again before they are next
+    // entered. Writes made by FX33 and FX55 while running are handled automatically, this is for
+    // writes made to mem from outside of run.
+    void invalidate(unsigned short address) noexcept;
+
+    // Makes every block check its bytes again
+    void reset() noexcept;
+
+    // Executes Opcode with all of its operands known at compile time. Called by generated code,
+    // which includes cpu_handlers.h for the handler definitions.
+    template <unsigned short Opcode>
+    static void execute(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad) {
+      CPU::op_fixed<Opcode>(cpu, CPU::Instruction{}, mem, graphics, keypad);
+    }
+
+  private:
+    enum class BlockState : unsigned char {
+      unchecked,  // Bytes have not been compared against memory since the last write near them
+      current,    // Memory holds the bytes the block was compiled from
+      stale,      // Memory differs, the block is interpreted instead
+    };
+
+    // Returns true if the block can be entered, comparing its bytes against mem if needed
+    bool is_current(const AotBlock& block, const Memory& mem) noexcept {
+      const auto state = states[block.address];
+      return state == BlockState::current
+             || (state == BlockState::unchecked && check(block, mem));
+    }
+
+    // Compares the bytes of block against mem and records the result
+    bool check(const AotBlock& block, const Memory& mem) noexcept;
+
+    // Returns the block starting at address that follows block
+    const AotBlock* next_block(const AotBlock& block, unsigned short address) const noexcept;
+
+    // Drops the checks of blocks written over by opcode when it ran with the index register at
+    // index. Only FX33 and FX55 write to memory, any other opcode does nothing.
+    void invalidate_stores(unsigned short opcode, unsigned short index) noexcept;
+
+    const AotProgram* program;
+
+    // Indexed by the address a block starts at
+    std::array<BlockState, mem_size> states;
+  };
+}  // namespace arch
@@ -1,8 +1,14 @@
 #include "cpu.h"
 
+#include "cpu_handlers.h"
 #include "memory.h"
 
-arch::CPU::CPU() {
+template <class Access>
+const std::array<arch::InstructionHandler<Access>, arch::num_ops>
+    arch::BasicCPU<Access>::handlers = make_handlers(std::make_index_sequence<num_ops>{});
+
+template <class Access>
+arch::BasicCPU<Access>::BasicCPU() {
   index_reg = 0;
   pc_reg = pc_start_value;
   sp_reg = 0;
@@ -14,6 +20,11 @@ arch::CPU::CPU() {
   curr_opcode = 0;
 
   updated_screen = false;
+  waiting_for_key = false;
+  dispatch = initial_dispatch;
+  fusion_counters = FusionCounters{};
+  guest_cycles = 0;
+  trap_record = Trap{};
 
   const std::string seed_str("RNG seed string");
   const std::seed_seq seed(seed_str.begin(), seed_str.end());
@@ -21,425 +32,413 @@ arch::CPU::CPU() {
   rng = std::uniform_int_distribution<>(0x00, 0xFF);
 }
 
-void arch::CPU::fetch(Memory& mem) {
+template <class Access>
+void arch::BasicCPU<Access>::fetch(Memory& mem) {
+  try_fetch(mem);
+  throw_if_trapped();
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::decode_execute(Memory& mem, Graphics& graphics, Keypad& keypad) {
+  try_decode_execute(mem, graphics, keypad);
+  throw_if_trapped();
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::step(Memory& mem, Graphics& graphics, Keypad& keypad) {
+  try_step(mem, graphics, keypad);
+  throw_if_trapped();
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::execute(const Instruction& instruction, Memory& mem,
+                                     Graphics& graphics, Keypad& keypad) {
+  if (!trapped()) {
+    updated_screen = false;
+    instruction.handler(*this, instruction, mem, graphics, keypad);
+  }
+  throw_if_trapped();
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::run(Memory& mem, Graphics& graphics, Keypad& keypad, size_t count) {
+  try_run(mem, graphics, keypad, count);
+  throw_if_trapped();
+}
+
+template <class Access>
+arch::Status arch::BasicCPU<Access>::try_fetch(Memory& mem) noexcept {
+  if (!trapped()) {
+    fetch_opcode(mem);
+  }
+  return status();
+}
+
+template <class Access>
+arch::Status arch::BasicCPU<Access>::try_decode_execute(Memory& mem, Graphics& graphics,
+                                                        Keypad& keypad) noexcept {
+  if (trapped()) {
+    return Status::trapped;
+  }
+
+#if defined(CHIP8_OPCODE_TABLE)
+  if (dispatch == Dispatch::opcode_table) {
+    execute_opcode_table(mem, graphics, keypad);
+    return status();
+  }
+#endif
+
+  const auto instruction = decode(curr_opcode);
+  if (dispatch == Dispatch::threaded) {
+    run_threaded(instruction, mem, graphics, keypad, 1);
+  } else {
+    updated_screen = false;
+    instruction.handler(*this, instruction, mem, graphics, keypad);
+  }
+  return status();
+}
+
+template <class Access>
+arch::Status arch::BasicCPU<Access>::try_step(Memory& mem, Graphics& graphics,
+                                              Keypad& keypad) noexcept {
+  if (trapped()) {
+    return Status::trapped;
+  }
+
+  step_untrapped(mem, graphics, keypad);
+  return status();
+}
+
+template <class Access>
+arch::Status arch::BasicCPU<Access>::try_run(Memory& mem, Graphics& graphics, Keypad& keypad,
+                                             size_t count) noexcept {
+  if (count == 0 || trapped()) {
+    return status();
+  }
+
+  if (dispatch == Dispatch::threaded) {
+    Instruction scratch;
+    const auto& first = fetch_decoded(mem, scratch);
+    run_threaded(first, mem, graphics, keypad, count);
+  } else if (dispatch == Dispatch::fused) {
+    auto screen_changed = false;
+    size_t executed = 0;
+    while (executed < count && !trapped()) {
+      executed += step_fused(mem, graphics, keypad, count - executed);
+      screen_changed = screen_changed || updated_screen;
+    }
+    updated_screen = screen_changed;
+  } else {
+    auto screen_changed = false;
+    for (size_t i = 0; i < count; i++) {
+      step_untrapped(mem, graphics, keypad);
+      screen_changed = screen_changed || updated_screen;
+      if (trapped()) {
+        break;
+      }
+    }
+    updated_screen = screen_changed;
+  }
+  return status();
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::throw_if_trapped() {
+  if (trapped()) {
+    const auto trap = trap_record;
+    clear_trap();
+    throw_trap(trap);
+  }
+}
+
+template <class Access>
+bool arch::BasicCPU<Access>::fetch_opcode(const Memory& mem) noexcept {
   // Instructions are 2 bytes, hence need to get current program counter and the next address to
   // build opcode. It is also big endian, hence mem[PC] represents the left most value and mem[PC+1]
-  // represents the right most value. Will throw a InvalidMemoryAddress exception if PC holds a
-  // value that is either at the greatest memory address or greater.
+  // represents the right most value. Unless addresses wrap, traps with Fault::invalid_address if PC
+  // holds a value that is either at the greatest memory address or greater.
+  if (!in_memory(pc_reg, 2)) {
+    raise(Fault::invalid_address, pc_reg, 0);
+    return false;
+  }
 
-  const auto left_most = static_cast<unsigned>(mem.get_value(pc_reg));
-  const auto right_most = static_cast<unsigned>(mem.get_value(pc_reg + 1));
+  const auto left_most = static_cast<unsigned>(mem.get_value_unchecked(pc_reg));
+  const auto right_most = static_cast<unsigned>(mem.get_value_unchecked(pc_reg + 1));
   curr_opcode = static_cast<unsigned short>(left_most << 8 | right_most);
   pc_reg += 2;
+  return true;
+}
+
+template <class Access>
+void arch::BasicCPU<Access>::step_untrapped(Memory& mem, Graphics& graphics,
+                                            Keypad& keypad) noexcept {
+#if defined(CHIP8_OPCODE_TABLE)
+  if (dispatch == Dispatch::opcode_table) {
+    if (fetch_opcode(mem)) {
+      execute_opcode_table(mem, graphics, keypad);
+    }
+    return;
+  }
+#endif
+
+  Instruction scratch;
+  const auto& instruction = fetch_decoded(mem, scratch);
+  if (dispatch == Dispatch::threaded) {
+    run_threaded(instruction, mem, graphics, keypad, 1);
+  } else {
+    updated_screen = false;
+    instruction.handler(*this, instruction, mem, graphics, keypad);
+  }
+}
+
+template <class Access>
+const arch::BasicInstruction<Access>& arch::BasicCPU<Access>::fetch_decode_uncached(
+    Memory& mem, Instruction& scratch) noexcept {
+  const auto address = pc_reg;
+  if (!fetch_opcode(mem)) {
+    // Runs as an invalid instruction, which leaves the fetch fault recorded
+    scratch = decode(0x0000);
+    return scratch;
+  }
+  scratch = decode(curr_opcode);
+  mem.set_decoded(address, scratch);
+  return scratch;
 }
 
-void arch::CPU::decode_execute(Memory& mem, Graphics& graphics, Keypad& keypad) {
-  // Parse out first 4 bits
+#if defined(__GNUC__)
+// Labels as values are a GNU extension that both GCC and Clang support
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wpedantic"
+
+template <class Access>
+void arch::BasicCPU<Access>::run_threaded(const Instruction& first, Memory& mem,
+                                          Graphics& graphics, Keypad& keypad,
+                                          size_t count) noexcept {
+  // Must be kept in the same order as Op
+  static const void* const labels[num_ops] = {
+      &&do_00E0,
+      &&do_00EE,
+      &&do_1NNN,
+      &&do_2NNN,
+      &&do_3XNN,
+      &&do_4XNN,
+      &&do_5XY0,
+      &&do_6XNN,
+      &&do_7XNN,
+      &&do_8XY0,
+      &&do_8XY1,
+      &&do_8XY2,
+      &&do_8XY3,
+      &&do_8XY4,
+      &&do_8XY5,
+      &&do_8XY6,
+      &&do_8XY7,
+      &&do_8XYE,
+      &&do_9XY0,
+      &&do_ANNN,
+      &&do_BNNN,
+      &&do_CXNN,
+      &&do_DXYN,
+      &&do_EX9E,
+      &&do_EXA1,
+      &&do_FX07,
+      &&do_FX0A,
+      &&do_FX15,
+      &&do_FX18,
+      &&do_FX1E,
+      &&do_FX29,
+      &&do_FX33,
+      &&do_FX55,
+      &&do_FX65,
+      &&do_invalid,
+  };
+
+  Instruction scratch;
+  const Instruction* instruction = &first;
   updated_screen = false;
-  switch (curr_opcode & 0xF000) {
-    case 0x0000:
-      switch (curr_opcode) {
-        case 0x00E0:
-          // Clears the screen
-          graphics.clear_screen();
-          updated_screen = true;
-          break;
-        case 0x00EE:
-          // Set program counter to top of stack. Decrease stack pointer by 1.
-          pc_reg = stack[sp_reg];
-          sp_reg--;
-          break;
-        default:
-          throw InvalidInstruction();
-      }
-      break;
-    case 0x1000:
-      // Of form 1NNN. Jumps to address NNN
-      {
-        const auto address = static_cast<unsigned short>(curr_opcode & 0x0FFF);
-        pc_reg = address;
-      }
-      break;
-    case 0x2000:
-      // Of form 2NNN. Increment stack pointer and store current program counter on stack. Stack
-      // pointer is then set to address NNN
-      {
-        const auto address = static_cast<unsigned short>(curr_opcode & 0x0FFF);
-        sp_reg++;
-        stack[sp_reg] = pc_reg;
-        pc_reg = address;
-      }
-      break;
-    case 0x3000:
-      // Of form 3XNN. Skips the next instruction if value of register X equals NN
-      {
-        // Mask to get the register id and bitshift right 8 to remove the two trailing zeros.
-        const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto value = static_cast<unsigned char>(curr_opcode & 0x00FF);
-        if (general_reg[reg_id] == value) {
-          pc_reg += 2;
-        }
-      }
-      break;
-    case 0x4000:
-      // Of form 4XNN. Skips the next instruction if the value of register X does not equal NN
-      {
-        // Mask to get the register id and bitshift right 8 to remove the two trailing zeros.
-        const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto value = static_cast<unsigned char>(curr_opcode & 0x00FF);
-        if (general_reg[reg_id] != value) {
-          pc_reg += 2;
-        }
-      }
-      break;
-    case 0x5000:
-      // Must be of form 5XY0. Skips the next instruction of the value of register X equals the
-      // value of register Y. The right most value must be a 0.
-      if ((curr_opcode & 0x00F) != 0) {
-        throw InvalidInstruction();
-      } else {
-        const auto reg_X = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto reg_Y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-        if (general_reg[reg_X] == general_reg[reg_Y]) {
-          pc_reg += 2;
-        }
-      }
-      break;
-    case 0x6000:
-      // Of form 6XNN. Stores the value NN in the register X
-      {
-        const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto value = static_cast<unsigned char>(curr_opcode & 0x00FF);
-
-        general_reg[reg_id] = value;
-      }
-      break;
-    case 0x7000:
-      // Of form 7XNN. Adds the value of NN in the register X
-      {
-        const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto value = static_cast<unsigned char>(curr_opcode & 0x00FF);
-        general_reg[reg_id] += value;
-      }
-      break;
-    case 0x8000:
-      switch (curr_opcode & 0x000F) {
-        case 0x0000:
-          // Of form 8XY0. Stores the value of register Y in register X
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[reg_x] = general_reg[reg_y];
-          }
-          break;
-        case 0x0001:
-          // Of form 8XY1. Stores the result of register X bitwise OR register Y in register X
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[reg_x] = static_cast<unsigned char>(static_cast<int>(general_reg[reg_x])
-                                                            | static_cast<int>(general_reg[reg_y]));
-          }
-          break;
-        case 0x0002:
-          // Of form 8XY2. Stores the result of register X bitwise AND register Y in register X
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[reg_x] = static_cast<unsigned char>(static_cast<int>(general_reg[reg_x])
-                                                            & static_cast<int>(general_reg[reg_y]));
-          }
-          break;
-        case 0x0003:
-          // Of form 8XY3. Stores the result of register X bitwise XOR register Y in register X
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[reg_x] = static_cast<unsigned char>(static_cast<int>(general_reg[reg_x])
-                                                            ^ static_cast<int>(general_reg[reg_y]));
-          }
-          break;
-        case 0x0004:
-          // Of form 8XY4. Adds the value in register Y to the value in register X. If there is an
-          // overflow, register F is set to 0x01. Else register F is set to 0x0.
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-            const auto sum = static_cast<unsigned char>(general_reg[reg_x] + general_reg[reg_y]);
-
-            if (sum < general_reg[reg_x]) {
-              general_reg[0xF] = 0x01;
-            } else {
-              general_reg[0xF] = 0x00;
-            }
-
-            general_reg[reg_x] = sum;
-          }
-          break;
-        case 0x0005:
-          // Of form 8XY5. Adds the value. Subtracts the value of register Y from register X. Set
-          // register F to 0 if borrow occurs, otherwise set register F to 1.
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            if (general_reg[reg_x] >= general_reg[reg_y]) {
-              general_reg[0xF] = 0x01;
-            } else {
-              general_reg[0xF] = 0x00;
-            }
-
-            general_reg[reg_x] -= general_reg[reg_y];
-          }
-          break;
-        case 0x0006:
-          // Of form 8XY6. Stores the value of register Y shifted right one bit in register X.
-          // Register F holds the least significant bit of register Y before the shift.
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[0xF] = static_cast<unsigned char>(general_reg[reg_y] & 0b00000001);
-
-            general_reg[reg_x] = static_cast<unsigned char>(general_reg[reg_y] >> 1);
-          }
-          break;
-        case 0x0007:
-          // Of form 8XY7. Stores the value of register Y subtracted by the value of register X in
-          // register X. If there is a borrow, register F is set to 0. Else register F is set to 1.
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-            const auto diff = static_cast<unsigned char>(general_reg[reg_y] - general_reg[reg_x]);
-
-            if (general_reg[reg_y] >= general_reg[reg_x]) {
-              general_reg[0xF] = 0x01;
-            } else {
-              general_reg[0xF] = 0x00;
-            }
-
-            general_reg[reg_x] = diff;
-          }
-          break;
-        case 0x000E:
-          // Of form 8XYE. Stores the value of register Y shifted left one bit in register X. Stores
-          // the most signficant bit of register Y before the shift in register F.
-          {
-            const auto reg_x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            const auto reg_y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-
-            general_reg[0xF] = static_cast<unsigned char>((general_reg[reg_y] & 0b10000000) >> 7);
-
-            general_reg[reg_x] = static_cast<unsigned char>(general_reg[reg_y] << 1);
-          }
-          break;
-        default:
-          throw InvalidInstruction();
-      }
-      break;
-    case 0x9000:
-      // Must be of form 9XY0. Skips the next instruction if the value of register X does not equal
-      // the value of register Y. The right most value must be a 0.
-      if ((curr_opcode & 0x00F) != 0) {
-        throw InvalidInstruction();
-      } else {
-        const auto reg_X = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-        const auto reg_Y = static_cast<size_t>((curr_opcode & 0x00F0) >> 4);
-        if (general_reg[reg_X] != general_reg[reg_Y]) {
-          pc_reg += 2;
-        }
-      }
-      break;
-    case 0xA000:
-      // Of form ANNN. Stores memory address NNN in index register
-      index_reg = static_cast<unsigned short>(curr_opcode & 0x0FFF);
-      break;
-    case 0xB000:
-      // Of form BNNN. Jump to address NNN + value in register 0
-      {
-        const auto jump_offset = static_cast<unsigned short>(curr_opcode & 0x0FFF);
-        pc_reg = static_cast<unsigned short>(jump_offset + general_reg[0]);
-      }
-      break;
-    case 0xC000:
-      // Of form CXNN. Generates a random number from 0 to 255 and masks with NN and stores in
-      // register X
-      {
-        const auto random_num = static_cast<unsigned>(rng(gen));
-        const auto mask = static_cast<unsigned>(curr_opcode & 0x00FF);
-        const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-        general_reg[reg_id] = static_cast<unsigned char>(random_num & mask);
-      }
-      break;
-    case 0xD000:
-      // Of form DXYN. Draws a sprite at location (register X value, register Y value) using the
-      // sprite data that is a total of N bytes which stored starting at address of the value in
-      // register I
-      {
-        const auto reg_X = static_cast<unsigned char>((curr_opcode & 0x0F00) >> 8);
-        const auto reg_Y = static_cast<unsigned char>((curr_opcode & 0x00F0) >> 4);
-        const auto height = static_cast<unsigned char>(curr_opcode & 0x000F);
-        const auto x_coord = general_reg[reg_X];
-        const auto y_coord = general_reg[reg_Y];
-
-        auto collision_flag = false;
-
-        for (auto y = 0; y < height; y++) {
-          const auto row_byte = mem.get_value(static_cast<unsigned short>(index_reg + y));
-          for (auto x = 0; x < 8; x++) {
-            const auto val = static_cast<bool>(row_byte & (0x80 >> x));
-            const auto result = graphics.draw_pixel(
-                static_cast<size_t>((x_coord + x) % arch::graphics::screen_width),
-                static_cast<size_t>((y_coord + y) % arch::graphics::screen_height), val);
-            collision_flag = static_cast<bool>(collision_flag || result);
-          }
-        }
-
-        general_reg[0xF] = collision_flag;
-
-        updated_screen = true;
-      }
-      break;
-    case 0xE000:
-      switch (curr_opcode & 0x00FF) {
-        case 0x9E:
-          // Of form EX9E. Skips the next instruction if the key number in register X is pressed.
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            try {
-              if (keypad.is_pressed(general_reg[reg_id])) {
-                pc_reg += 2;
-              }
-            } catch (const arch::keypad::InvalidKey&) {
-            }
-          }
-          break;
-        case 0xA1:
-          // Of form EXA1. Skips the next instruction if the key number in register X is not
-          // pressed.
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            try {
-              if (!keypad.is_pressed(general_reg[reg_id])) {
-                pc_reg += 2;
-              }
-            } catch (const arch::keypad::InvalidKey&) {
-            }
-          }
-          break;
-        default:
-          throw InvalidInstruction();
-      }
-      break;
-    case 0xF000:
-      switch (curr_opcode & 0x00FF) {
-        case 0x07:
-          // Of form FX07. Store the current value of the delay timer in register X
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            general_reg[reg_id] = delay_timer_reg;
-          }
-          break;
-        case 0x0A:
-          // Of form FX0A. Wait for key press and store result in register X
-          {
-            if (keypad.key_pressed) {
-              const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-              general_reg[reg_id] = keypad.pressed_key;
-            } else {
-              pc_reg -= 2;
-            }
-          }
-          break;
-        case 0x15:
-          // Of form FX15. Set the delay timer to the value in register X
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            delay_timer_reg = general_reg[reg_id];
-          }
-          break;
-        case 0x18:
-          // Of form FX1E. Set the sound timer to the value in register X
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-            sound_timer_reg = general_reg[reg_id];
-          }
-          break;
-        case 0x1E:
-          // Of form FX1E. Adds the value in register X to register I
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-            index_reg += general_reg[reg_id];
-          }
-          break;
-        case 0x29:
-          // Of form FX29. Set the value of register I to the address of the sprite that represents
-          // the hexadecimal digit stored in register X.
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-            index_reg = (general_reg[reg_id] & 0x0F) * 5;
-          }
-          break;
-        case 0x33:
-          // Of form FX33. Set the value stored in register X in binary coded. The hundredth digit
-          // is placed at address stored in register I, the tenth digit is placed at 1 + address
-          // stored in register I and the ones digit is placed at 2 + address stored in register I.
-          {
-            const auto reg_id = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-            // Yay floor division
-            // truncates the last 2 digits
-            mem.set_value(index_reg, general_reg[reg_id] / 100);
-            // truncates the last digit and then truncates the first digit of result
-            mem.set_value(index_reg + 1, (general_reg[reg_id] / 10) % 10);
-            // truncates the first digit and then truncates the first digit of result
-            mem.set_value(index_reg + 2, (general_reg[reg_id] % 100) % 10);
-          }
-          break;
-        case 0x55:
-          // Of form FX55. Stores the values from register 0 to register X inclusive starting at the
-          // address in register I. Register I is then set to I + X + 1 after the operation.
-          {
-            const auto x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-            for (auto reg = 0; reg <= x; reg++) {
-              mem.set_value(index_reg + reg, general_reg[reg]);
-            }
-            index_reg = static_cast<unsigned short>(index_reg + x + 1);
-          }
-          break;
-        case 0x65:
-          // Of form FX65. Stores values in registers 0 to X inclusive with values in memory
-          // starting from the address in register I. Register I is then set to I + X + 1 after the
-          // operation.
-          {
-            const auto x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
-
-            for (auto reg = 0; reg <= x; reg++) {
-              general_reg[reg] = mem.get_value(index_reg + reg);
-            }
-            index_reg = static_cast<unsigned short>(index_reg + x + 1);
-          }
-
-          break;
-        default:
-          throw InvalidInstruction();
-      }
-      break;
-    default:
-      // This is actually technically impossible to reach
-      throw InvalidInstruction();
+
+  // Every handler ends with its own copy of this so that each has a separate indirect branch for
+  // the branch predictor to learn the likely next handler from.
+#  define CHIP8_DISPATCH_NEXT()                         \
+    if (--count == 0) {                                 \
+      return;                                           \
+    }                                                   \
+    instruction = &fetch_decoded(mem, scratch);         \
+    goto* labels[static_cast<size_t>(instruction->op)]
+
+  // Used instead by the handlers that can trap, so that the rest pay nothing for the check
+#  define CHIP8_DISPATCH_NEXT_CHECKED() \
+    if (trapped()) {                    \
+      return;                           \
+    }                                   \
+    CHIP8_DISPATCH_NEXT()
+
+  goto* labels[static_cast<size_t>(instruction->op)];
+
+do_00E0:
+  semantics<Op::op_00E0>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_00EE:
+  semantics<Op::op_00EE>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_1NNN:
+  semantics<Op::op_1NNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_2NNN:
+  semantics<Op::op_2NNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_3XNN:
+  semantics<Op::op_3XNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_4XNN:
+  semantics<Op::op_4XNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_5XY0:
+  semantics<Op::op_5XY0>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_6XNN:
+  semantics<Op::op_6XNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_7XNN:
+  semantics<Op::op_7XNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY0:
+  semantics<Op::op_8XY0>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY1:
+  semantics<Op::op_8XY1>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY2:
+  semantics<Op::op_8XY2>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY3:
+  semantics<Op::op_8XY3>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY4:
+  semantics<Op::op_8XY4>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY5:
+  semantics<Op::op_8XY5>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY6:
+  semantics<Op::op_8XY6>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XY7:
+  semantics<Op::op_8XY7>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_8XYE:
+  semantics<Op::op_8XYE>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_9XY0:
+  semantics<Op::op_9XY0>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_ANNN:
+  semantics<Op::op_ANNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_BNNN:
+  semantics<Op::op_BNNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_CXNN:
+  semantics<Op::op_CXNN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_DXYN:
+  semantics<Op::op_DXYN>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_EX9E:
+  semantics<Op::op_EX9E>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_EXA1:
+  semantics<Op::op_EXA1>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX07:
+  semantics<Op::op_FX07>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX0A:
+  semantics<Op::op_FX0A>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX15:
+  semantics<Op::op_FX15>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX18:
+  semantics<Op::op_FX18>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX1E:
+  semantics<Op::op_FX1E>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX29:
+  semantics<Op::op_FX29>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT();
+do_FX33:
+  semantics<Op::op_FX33>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_FX55:
+  semantics<Op::op_FX55>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_FX65:
+  semantics<Op::op_FX65>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+do_invalid:
+  semantics<Op::op_invalid>(*this, *instruction, mem, graphics, keypad);
+  CHIP8_DISPATCH_NEXT_CHECKED();
+
+#  undef CHIP8_DISPATCH_NEXT_CHECKED
+#  undef CHIP8_DISPATCH_NEXT
+}
+
+#  pragma GCC diagnostic pop
+#else
+template <class Access>
+void arch::BasicCPU<Access>::run_threaded(const Instruction& first, Memory& mem,
+                                          Graphics& graphics, Keypad& keypad,
+                                          size_t count) noexcept {
+  // No computed goto available. Fall back to calling each handler in turn straight from its
+  // predecoded pointer, which still skips decoding.
+  Instruction scratch;
+  const Instruction* instruction = &first;
+  updated_screen = false;
+
+  for (;;) {
+    instruction->handler(*this, *instruction, mem, graphics, keypad);
+    if (--count == 0 || trapped()) {
+      return;
+    }
+    instruction = &fetch_decoded(mem, scratch);
   }
 }
+#endif
+
+template <class Access>
+arch::BasicInstruction<Access> arch::BasicCPU<Access>::decode(unsigned short opcode) noexcept {
+  Instruction instruction{};
+  instruction.opcode = opcode;
+  instruction.nnn = static_cast<unsigned short>(opcode & 0x0FFF);
+  // Mask to get the register id and bitshift to remove the trailing zeros.
+  instruction.x = static_cast<unsigned char>((opcode & 0x0F00) >> 8);
+  instruction.y = static_cast<unsigned char>((opcode & 0x00F0) >> 4);
+  instruction.n = static_cast<unsigned char>(opcode & 0x000F);
+  instruction.nn = static_cast<unsigned char>(opcode & 0x00FF);
+
+  instruction.op = decode_op(opcode);
+  instruction.handler = handlers[static_cast<size_t>(instruction.op)];
+
+  return instruction;
+}
 
-unsigned char arch::CPU::get_general_reg(size_t reg_id) const {
+template <class Access>
+unsigned int arch::BasicCPU<Access>::count_cycles(unsigned short address,
+                                                  unsigned char vf) noexcept {
+  const auto x = static_cast<size_t>((curr_opcode & 0x0F00) >> 8);
+  const auto vx = x == 0xF ? vf : general_reg[x];
+  // Only the skips have a cost for moving past the next instruction, so any other instruction
+  // that lands there costs the same
+  const auto skipped = static_cast<unsigned short>(pc_reg - address) == 4;
+  const auto cycles = instruction_cycles(curr_opcode, vx, skipped);
+  guest_cycles += cycles;
+  return cycles;
+}
+
+template <class Access>
+unsigned char arch::BasicCPU<Access>::get_general_reg(size_t reg_id) const {
   if (reg_id >= num_general_reg) {
     throw InvalidRegisterID();
   } else {
@@ -447,7 +446,8 @@ unsigned char arch::CPU::get_general_reg(size_t reg_id) const {
   }
 }
 
-void arch::CPU::set_general_reg(size_t reg_idx, unsigned char value) {
+template <class Access>
+void arch::BasicCPU<Access>::set_general_reg(size_t reg_idx, unsigned char value) {
   if (reg_idx >= num_general_reg) {
     throw InvalidRegisterID();
   } else {
@@ -455,9 +455,11 @@ void arch::CPU::set_general_reg(size_t reg_idx, unsigned char value) {
   }
 }
 
-unsigned short arch::CPU::get_stack_pointer() const { return sp_reg; }
+template <class Access>
+unsigned short arch::BasicCPU<Access>::get_stack_pointer() const { return sp_reg; }
 
-void arch::CPU::set_stack_pointer(unsigned char value) {
+template <class Access>
+void arch::BasicCPU<Access>::set_stack_pointer(unsigned char value) {
   if (value >= stack_size) {
     throw InvalidStackPointerValue();
   } else {
@@ -465,6 +467,17 @@ void arch::CPU::set_stack_pointer(unsigned char value) {
   }
 }
 
-unsigned short arch::CPU::get_stack() const { return stack[sp_reg]; }
+template <class Access>
+unsigned short arch::BasicCPU<Access>::get_stack() const { return stack[sp_reg]; }
+
+template <class Access>
+void arch::BasicCPU<Access>::set_stack(unsigned short value) { stack[sp_reg] = value; }
+
+template <class Access>
+void arch::BasicCPU<Access>::seed_rng(unsigned int seed) {
+  gen.seed(seed);
+  rng.reset();
+}
 
-void arch::CPU::set_stack(unsigned short value) { stack[sp_reg] = value; }
+template class arch::BasicCPU<arch::CheckedAccess>;
+template class arch::BasicCPU<arch::WrappingAccess>;
@@ -4,24 +4,150 @@
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "access.h"
+#include "cycles.h"
 #include "graphics.h"
+#include "instruction.h"
 #include "keypad.h"
+#include "latency.h"
 #include "memory.h"
+#include "opcode_spec.h"
+#include "trace.h"
+#include "trap.h"
 
 namespace arch {
   constexpr size_t num_general_reg = 16;            // Number of general purpose registers
   constexpr size_t stack_size = 16;                 // Depth of nested subroutine calls
   constexpr unsigned short pc_start_value = 0x200;  // Initial value of PC when booted
 
-  class CPU {
+  // How decoded instructions are dispatched to their handlers
+  enum class Dispatch {
+    switch_table,  // Every instruction returns to a central loop and is called through its handler
+    threaded,      // Each handler jumps straight to the handler of the next instruction
+    fused,         // As switch_table, but run executes known sequences as one superinstruction
+#if defined(CHIP8_OPCODE_TABLE)
+    opcode_table,  // The raw opcode indexes a table of handlers specialized for every opcode
+#endif
+  };
+
+#if defined(CHIP8_THREADED_DISPATCH)
+  constexpr Dispatch default_dispatch = Dispatch::threaded;
+#else
+  constexpr Dispatch default_dispatch = Dispatch::switch_table;
+#endif
+
+  // How often run dispatched each kind of superinstruction when using Dispatch::fused
+  struct FusionCounters {
+    std::array<unsigned long long, num_fusions> hits;          // Superinstructions dispatched
+    std::array<unsigned long long, num_fusions> instructions;  // Guest instructions they covered
+    unsigned long long total_instructions;                     // Fused or not
+  };
+
+  // Human readable hit rate of every kind of superinstruction, one line each
+  [[nodiscard]] std::string fusion_report(const FusionCounters& counters);
+
+  // True for the forms that conditionally skip the next instruction
+  constexpr bool is_skip(Op op) noexcept {
+    return op == Op::op_3XNN || op == Op::op_4XNN || op == Op::op_5XY0 || op == Op::op_9XY0
+           || op == Op::op_EX9E || op == Op::op_EXA1;
+  }
+
+  // How often each opcode form and each raw opcode executed, and how often each skip form skipped.
+  // Only kept by the CPU when built with CHIP8_OPCODE_COUNTERS.
+  struct OpcodeCounters {
+    std::array<unsigned long long, num_ops> forms{};        // Indexed by Op
+    std::array<unsigned long long, num_ops> skips_taken{};  // Indexed by Op, only skip forms
+    std::vector<unsigned long long> opcodes
+        = std::vector<unsigned long long>(0x10000);  // Indexed by raw opcode
+
+    // Records one execution of opcode of form op. skipped is whether the program counter moved past
+    // the next instruction, which only matters for skip forms.
+    void count(Op op, unsigned short opcode, bool skipped) noexcept {
+      forms[static_cast<size_t>(op)]++;
+      opcodes[opcode]++;
+      if (is_skip(op) && skipped) {
+        skips_taken[static_cast<size_t>(op)]++;
+      }
+    }
+  };
+
+  // Instruction mix: every opcode form, how often each skip was taken and every opcode that
+  // executed, most frequent first
+  [[nodiscard]] std::string opcode_report(const OpcodeCounters& counters);
+
+  template <class Access>
+  class BasicLockstep;
+
+  // The CHIP-8 processor. Access is the bounds policy of the memory and screen it runs against:
+  // with CheckedAccess instructions that reach past the end of memory trap with
+  // Fault::invalid_address, with WrappingAccess their addresses wrap around instead and no check is
+  // compiled in at all.
+  template <class Access>
+  class BasicCPU {
   public:
-    CPU();
+    using CPU = BasicCPU;
+    using Memory = BasicMemory<Access>;
+    using Graphics = BasicGraphics<Access>;
+    using Instruction = BasicInstruction<Access>;
+    using InstructionHandler = arch::InstructionHandler<Access>;
+
+    BasicCPU();
+
+    // fetch, decode_execute, step, execute and run throw the exception matching the fault when an
+    // instruction traps, see throw_trap, and clear the trap before doing so. They are kept for
+    // tests and callers that want exceptions, the execution loops use the try_ versions below.
 
     void fetch(Memory& mem);
 
     void decode_execute(Memory& mem, Graphics& graphics, Keypad& keypad);
 
+    // Fetches, decodes and executes the instruction at the program counter. Instructions are
+    // decoded once and kept in the predecoded cache of mem, so later executions of the same address
+    // skip both the memory reads of fetch and the parsing of decode.
+    void step(Memory& mem, Graphics& graphics, Keypad& keypad);
+
+    // Resolves the handler and extracts the operand fields of opcode. Invalid opcodes decode to a
+    // handler that traps with Fault::invalid_instruction when executed.
+    [[nodiscard]] static Instruction decode(unsigned short opcode) noexcept;
+
+    void execute(const Instruction& instruction, Memory& mem, Graphics& graphics, Keypad& keypad);
+
+    // Runs count instructions starting at the program counter using the selected dispatch engine.
+    // updated_screen is set if any of the instructions updated the screen.
+    void run(Memory& mem, Graphics& graphics, Keypad& keypad, size_t count);
+
+    // Exception free versions of fetch, decode_execute, step and run. The first fault stops
+    // execution and is recorded in trap, with the program counter left past the faulting
+    // instruction. From then on they return Status::trapped without executing anything until
+    // clear_trap is called.
+
+    Status try_fetch(Memory& mem) noexcept;
+
+    Status try_decode_execute(Memory& mem, Graphics& graphics, Keypad& keypad) noexcept;
+
+    Status try_step(Memory& mem, Graphics& graphics, Keypad& keypad) noexcept;
+
+    Status try_run(Memory& mem, Graphics& graphics, Keypad& keypad, size_t count) noexcept;
+
+    [[nodiscard]] const Trap& trap() const noexcept { return trap_record; }
+
+    [[nodiscard]] bool trapped() const noexcept { return trap_record.fault != Fault::none; }
+
+    void clear_trap() noexcept { trap_record = Trap{}; }
+
+    // Executes the superinstruction at the program counter if there is one that fits in budget,
+    // otherwise a single instruction through try_step. Returns the number of guest instructions
+    // executed, including one that trapped. Registers, flags and the program counter end up
+    // exactly as if the instructions had been stepped one at a time.
+    size_t step_fused(Memory& mem, Graphics& graphics, Keypad& keypad, size_t budget) noexcept;
+
+    // Fusion pass. Decodes the instructions starting at address and returns the superinstruction
+    // they form, which has kind Fusion::none if they do not match a known sequence.
+    [[nodiscard]] static FusedInstruction fuse(const Memory& mem, unsigned short address);
+
     // Getters and setters for general registers and stack to make sure that only valid indices are
     // provided. Although they are both std::array which has its own bounds checking, by doing the
     // checking through getter and setter, there is control over the type of exception thrown which
@@ -39,6 +165,10 @@ namespace arch {
 
     void set_stack(unsigned short value);
 
+    // Restarts the random numbers CXNN draws from seed. Every CPU starts from the same fixed seed,
+    // so copies of a machine draw the same numbers unless they are seeded differently.
+    void seed_rng(unsigned int seed);
+
     // Current opcode. Meant to be set via fetch and used via decode_execute
     unsigned short curr_opcode;
 
@@ -49,7 +179,68 @@ namespace arch {
 
     bool updated_screen;
 
+    // Set while FX0A waits for a key press. Executing anything before a key is pressed only runs
+    // the same FX0A again.
+    bool waiting_for_key;
+
+    // Engine used by decode_execute, step and run. Can be changed at any point between
+    // instructions, which allows the engines to be compared against each other.
+    Dispatch dispatch;
+
+    // Engine new CPUs with this Access start with. Defaults to the build time choice of
+    // default_dispatch.
+    static inline Dispatch initial_dispatch = default_dispatch;
+
+    FusionCounters fusion_counters;
+
+#if defined(CHIP8_OPCODE_COUNTERS)
+    // Executions counted by every engine that goes through semantics: switch_table, threaded,
+    // opcode_table and ahead of time compiled code. Superinstructions and micro-op blocks are not
+    // counted, and builds with counters have no translated code, see Jit.
+    OpcodeCounters opcode_counters;
+#endif
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+    // Host time each handler took, timed around the same calls that opcode_counters counts. Blocks
+    // of translated code are not timed as entries of their own: builds with histograms have no
+    // translated code, so hot code is timed instruction by instruction too, see Jit.
+    HandlerLatencies handler_latencies;
+#endif
+
+#if defined(CHIP8_TRACE)
+    // Where every instruction that goes through semantics is recorded, nothing is while nullptr
+    TraceBuffer* trace = nullptr;
+#endif
+
+    // Machine cycles the COSMAC VIP interpreter would have taken for the instructions passed to
+    // count_cycles, see instruction_cycles
+    unsigned long long guest_cycles;
+
+    // Adds the cost of the instruction that just executed from address to guest_cycles and
+    // returns it. vf is the value VF held before it executed, which DXYN overwrites with its
+    // collision flag.
+    unsigned int count_cycles(unsigned short address, unsigned char vf) noexcept;
+
+    // As count_cycles for the first executed instructions of fused, as step_fused returned them.
+    // vf is the value VF held before the superinstruction executed.
+    unsigned int count_fused_cycles(const FusedInstruction& fused, size_t executed,
+                                    unsigned char vf) noexcept;
+
   private:
+    // Translated code keeps its own copy of the registers and syncs them around each run
+    friend class Jit;
+
+    // Compiled ahead of time code calls the handlers directly
+    friend class AotEngine;
+
+    // Micro-op blocks keep their own copy of the registers and timers and sync them around each run
+    friend class IrEngine;
+
+    // Lockstep lanes keep their registers and timers in arrays across lanes and sync them around
+    // every instruction they step one lane at a time
+    template <class>
+    friend class BasicLockstep;
+
     // Registers
     std::array<unsigned char, num_general_reg> general_reg;  // General purpose registers 16 8 bit
 
@@ -60,8 +251,217 @@ namespace arch {
     // RNG
     std::mt19937 gen;
     std::uniform_int_distribution<> rng;
+
+    Trap trap_record;  // First fault since the last clear_trap
+
+    [[nodiscard]] Status status() const noexcept {
+      return trapped() ? Status::trapped : Status::ok;
+    }
+
+    // Records a fault at pc unless an earlier one is still recorded
+    void raise(Fault fault, unsigned short pc, unsigned short opcode) noexcept {
+      if (!trapped()) {
+        trap_record = Trap{fault, pc, opcode};
+      }
+    }
+
+    // True if the size bytes starting at address are all in memory. Always true when Access wraps,
+    // so the checks compile away.
+    static constexpr bool in_memory(size_t address, size_t size) noexcept {
+      return Access::wraps || address + size <= mem_size;
+    }
+
+    // Records a fault in the instruction being executed, which fetch has already moved past
+    void raise(Fault fault) noexcept {
+      raise(fault, static_cast<unsigned short>(pc_reg - 2), curr_opcode);
+    }
+
+    // Throws and clears the recorded fault, if any
+    void throw_if_trapped();
+
+    // Reads the opcode at the program counter into curr_opcode and advances past it. Returns false
+    // after recording a fault if the opcode is not entirely in memory and Access does not wrap.
+    bool fetch_opcode(const Memory& mem) noexcept;
+
+    // Body of try_step without checking for an earlier trap
+    void step_untrapped(Memory& mem, Graphics& graphics, Keypad& keypad) noexcept;
+
+    // Returns the decoded instruction at the program counter and advances it, going through the
+    // predecoded cache of mem. scratch holds the instruction when it cannot be cached. An opcode
+    // that cannot be fetched records a fault and comes back as an invalid instruction.
+    const Instruction& fetch_decoded(Memory& mem, Instruction& scratch) noexcept {
+      const auto* cached = mem.get_decoded(pc_reg);
+      if (cached == nullptr) {
+        return fetch_decode_uncached(mem, scratch);
+      }
+      // A write over its own slot only clears the handler, the operands stay intact while it runs
+      curr_opcode = cached->opcode;
+      pc_reg += 2;
+      return *cached;
+    }
+
+    const Instruction& fetch_decode_uncached(Memory& mem, Instruction& scratch) noexcept;
+
+    // Direct threaded engine. Executes first then count - 1 more instructions fetched from mem.
+    void run_threaded(const Instruction& first, Memory& mem, Graphics& graphics, Keypad& keypad,
+                      size_t count) noexcept;
+
+    // Runs a superinstruction that fits in budget and returns the instructions it executed
+    size_t execute_fused(const FusedInstruction& fused, Memory& mem, Graphics& graphics,
+                         Keypad& keypad, size_t budget) noexcept;
+
+    // Shared by counted_loop and delay_wait, which only differ in how they set register x[0]
+    template <bool LoadDelayTimer>
+    size_t execute_fused_loop(const FusedInstruction& fused, size_t budget) noexcept;
+
+    // Handler of the opcode form Form, the semantics that opcode_specs binds to it. The handler
+    // table, op_fixed and the opcode table are generated from it and the threaded engine calls it
+    // from each label. Defined in cpu_handlers.h.
+    template <Op Form, class Operands>
+    static void semantics(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                          Keypad& keypad);
+
+    template <size_t... Forms>
+    static constexpr std::array<InstructionHandler, sizeof...(Forms)> make_handlers(
+        std::index_sequence<Forms...>) {
+      return {&semantics<static_cast<Op>(Forms), Instruction>...};
+    }
+
+    // Indexed by Op
+    static const std::array<InstructionHandler, num_ops> handlers;
+
+    // Handler with every operand of Opcode fixed at compile time. Defined in cpu_handlers.h and
+    // instantiated by the opcode table and by code generated by chip8_aot.
+    template <unsigned short Opcode>
+    static void op_fixed(CPU& cpu, const Instruction& instruction, Memory& mem, Graphics& graphics,
+                         Keypad& keypad);
+
+#if defined(CHIP8_OPCODE_TABLE)
+    // Executes curr_opcode through opcode_table
+    void execute_opcode_table(Memory& mem, Graphics& graphics, Keypad& keypad) noexcept;
+
+    // op_fixed for valid opcodes and op_invalid otherwise
+    template <unsigned short Opcode>
+    static constexpr InstructionHandler opcode_table_entry();
+
+    template <size_t... Opcodes>
+    static constexpr std::array<InstructionHandler, sizeof...(Opcodes)> make_opcode_table(
+        std::index_sequence<Opcodes...>);
+
+    // Indexed by the raw opcode. Invalid opcodes map straight to op_invalid.
+    static const std::array<InstructionHandler, 0x10000> opcode_table;
+#endif
+
+    // Instruction handlers, one per opcode form
+    template <class Operands>
+    static void op_00E0(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_00EE(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_1NNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_2NNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_3XNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_4XNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_5XY0(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_6XNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_7XNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY0(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY1(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY2(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY3(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY4(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY5(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY6(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XY7(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_8XYE(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_9XY0(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_ANNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_BNNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_CXNN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_DXYN(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_EX9E(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_EXA1(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX07(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX0A(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX15(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX18(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX1E(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX29(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX33(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX55(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_FX65(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
+    template <class Operands>
+    static void op_invalid(CPU& cpu, const Operands& instruction, Memory& mem, Graphics& graphics,
+                        Keypad& keypad);
   };
 
+  using CPU = BasicCPU<CheckedAccess>;
+
   class InvalidRegisterID : public std::exception {
   public:
     virtual const char* what() const noexcept {
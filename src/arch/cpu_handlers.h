@@ -0,0 +1,553 @@
+#pragma once
+
+// Definitions of the CPU instruction handlers. Besides the bounds policy of the CPU they are
+// templates over the operand source so that the same semantics serve both runtime decoded
+// Instruction and compile time FixedInstruction operands. Only needed by the translation units that
+// instantiate handlers.
+
+#include <chrono>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_00E0(CPU& cpu, const Operands&, Memory&, Graphics& graphics,
+                                     Keypad&) {
+  // Clears the screen
+  graphics.clear_screen();
+  cpu.updated_screen = true;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_00EE(CPU& cpu, const Operands&, Memory&, Graphics&, Keypad&) {
+  // Set program counter to top of stack. Decrease stack pointer by 1.
+  if (cpu.sp_reg == 0) {
+    cpu.raise(Fault::stack_underflow);
+    return;
+  }
+  cpu.pc_reg = cpu.stack[cpu.sp_reg];
+  cpu.sp_reg--;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_1NNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 1NNN. Jumps to address NNN
+  cpu.pc_reg = instruction.nnn;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_2NNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 2NNN. Increment stack pointer and store current program counter on stack. Stack
+  // pointer is then set to address NNN
+  if (cpu.sp_reg >= stack_size) {
+    cpu.raise(Fault::stack_overflow);
+    return;
+  }
+  cpu.sp_reg++;
+  cpu.stack[cpu.sp_reg] = cpu.pc_reg;
+  cpu.pc_reg = instruction.nnn;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_3XNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 3XNN. Skips the next instruction if value of register X equals NN
+  if (cpu.general_reg[instruction.x] == instruction.nn) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_4XNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 4XNN. Skips the next instruction if the value of register X does not equal NN
+  if (cpu.general_reg[instruction.x] != instruction.nn) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_5XY0(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 5XY0. Skips the next instruction of the value of register X equals the value of
+  // register Y.
+  if (cpu.general_reg[instruction.x] == cpu.general_reg[instruction.y]) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_6XNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 6XNN. Stores the value NN in the register X
+  cpu.general_reg[instruction.x] = instruction.nn;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_7XNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 7XNN. Adds the value of NN in the register X
+  cpu.general_reg[instruction.x] += instruction.nn;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY0(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY0. Stores the value of register Y in register X
+  cpu.general_reg[instruction.x] = cpu.general_reg[instruction.y];
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY1(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY1. Stores the result of register X bitwise OR register Y in register X
+  auto& reg = cpu.general_reg;
+  reg[instruction.x] = static_cast<unsigned char>(static_cast<int>(reg[instruction.x])
+                                                  | static_cast<int>(reg[instruction.y]));
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY2(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY2. Stores the result of register X bitwise AND register Y in register X
+  auto& reg = cpu.general_reg;
+  reg[instruction.x] = static_cast<unsigned char>(static_cast<int>(reg[instruction.x])
+                                                  & static_cast<int>(reg[instruction.y]));
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY3(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY3. Stores the result of register X bitwise XOR register Y in register X
+  auto& reg = cpu.general_reg;
+  reg[instruction.x] = static_cast<unsigned char>(static_cast<int>(reg[instruction.x])
+                                                  ^ static_cast<int>(reg[instruction.y]));
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY4(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY4. Adds the value in register Y to the value in register X. If there is an
+  // overflow, register F is set to 0x01. Else register F is set to 0x0.
+  auto& reg = cpu.general_reg;
+  const auto sum = static_cast<unsigned char>(reg[instruction.x] + reg[instruction.y]);
+
+  if (sum < reg[instruction.x]) {
+    reg[0xF] = 0x01;
+  } else {
+    reg[0xF] = 0x00;
+  }
+
+  reg[instruction.x] = sum;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY5(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY5. Subtracts the value of register Y from register X. Set register F to 0 if borrow
+  // occurs, otherwise set register F to 1.
+  auto& reg = cpu.general_reg;
+
+  if (reg[instruction.x] >= reg[instruction.y]) {
+    reg[0xF] = 0x01;
+  } else {
+    reg[0xF] = 0x00;
+  }
+
+  reg[instruction.x] -= reg[instruction.y];
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY6(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY6. Stores the value of register Y shifted right one bit in register X. Register F
+  // holds the least significant bit of register Y before the shift.
+  auto& reg = cpu.general_reg;
+
+  reg[0xF] = static_cast<unsigned char>(reg[instruction.y] & 0b00000001);
+
+  reg[instruction.x] = static_cast<unsigned char>(reg[instruction.y] >> 1);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XY7(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XY7. Stores the value of register Y subtracted by the value of register X in register
+  // X. If there is a borrow, register F is set to 0. Else register F is set to 1.
+  auto& reg = cpu.general_reg;
+  const auto diff = static_cast<unsigned char>(reg[instruction.y] - reg[instruction.x]);
+
+  if (reg[instruction.y] >= reg[instruction.x]) {
+    reg[0xF] = 0x01;
+  } else {
+    reg[0xF] = 0x00;
+  }
+
+  reg[instruction.x] = diff;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_8XYE(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 8XYE. Stores the value of register Y shifted left one bit in register X. Stores the
+  // most signficant bit of register Y before the shift in register F.
+  auto& reg = cpu.general_reg;
+
+  reg[0xF] = static_cast<unsigned char>((reg[instruction.y] & 0b10000000) >> 7);
+
+  reg[instruction.x] = static_cast<unsigned char>(reg[instruction.y] << 1);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_9XY0(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form 9XY0. Skips the next instruction if the value of register X does not equal the value
+  // of register Y.
+  if (cpu.general_reg[instruction.x] != cpu.general_reg[instruction.y]) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_ANNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form ANNN. Stores memory address NNN in index register
+  cpu.index_reg = instruction.nnn;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_BNNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form BNNN. Jump to address NNN + value in register 0
+  cpu.pc_reg = static_cast<unsigned short>(instruction.nnn + cpu.general_reg[0]);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_CXNN(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form CXNN. Generates a random number from 0 to 255 and masks with NN and stores in register
+  // X
+  const auto random_num = static_cast<unsigned>(cpu.rng(cpu.gen));
+  const auto mask = static_cast<unsigned>(instruction.nn);
+
+  cpu.general_reg[instruction.x] = static_cast<unsigned char>(random_num & mask);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_DXYN(CPU& cpu, const Operands& instruction, Memory& mem,
+                                     Graphics& graphics, Keypad&) {
+  // Of form DXYN. Draws a sprite at location (register X value, register Y value) using the sprite
+  // data that is a total of N bytes which stored starting at address of the value in register I
+  const auto height = instruction.n;
+  const auto x_coord = cpu.general_reg[instruction.x];
+  const auto y_coord = cpu.general_reg[instruction.y];
+
+  // Check the whole sprite once so that neither memory nor the screen need to check each access.
+  // The coordinates wrap so they are always on screen.
+  if (!in_memory(cpu.index_reg, height)) {
+    cpu.raise(Fault::invalid_address);
+    return;
+  }
+
+  auto collision_flag = false;
+
+  for (auto y = 0; y < height; y++) {
+    const auto row_byte = mem.get_value_unchecked(static_cast<unsigned short>(cpu.index_reg + y));
+    for (auto x = 0; x < 8; x++) {
+      const auto val = static_cast<bool>(row_byte & (0x80 >> x));
+      const auto result = graphics.draw_pixel_unchecked(
+          static_cast<size_t>((x_coord + x) % arch::graphics::screen_width),
+          static_cast<size_t>((y_coord + y) % arch::graphics::screen_height), val);
+      collision_flag = static_cast<bool>(collision_flag || result);
+    }
+  }
+
+  cpu.general_reg[0xF] = collision_flag;
+
+  cpu.updated_screen = true;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_EX9E(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad& keypad) {
+  // Of form EX9E. Skips the next instruction if the key number in register X is pressed. Keys
+  // outside of the keypad are never pressed.
+  const auto key = cpu.general_reg[instruction.x];
+  if (key < keypad::num_of_keys && keypad.is_pressed_unchecked(key)) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_EXA1(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad& keypad) {
+  // Of form EXA1. Skips the next instruction if the key number in register X is not pressed. Keys
+  // outside of the keypad never skip.
+  const auto key = cpu.general_reg[instruction.x];
+  if (key < keypad::num_of_keys && !keypad.is_pressed_unchecked(key)) {
+    cpu.pc_reg += 2;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX07(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form FX07. Store the current value of the delay timer in register X
+  cpu.general_reg[instruction.x] = cpu.delay_timer_reg;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX0A(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad& keypad) {
+  // Of form FX0A. Wait for key press and store result in register X. While waiting the program
+  // counter stays on this instruction and waiting_for_key is set so the caller can stop executing
+  // until a key arrives.
+  if (keypad.key_pressed) {
+    cpu.general_reg[instruction.x] = keypad.pressed_key;
+    cpu.waiting_for_key = false;
+  } else {
+    cpu.pc_reg -= 2;
+    cpu.waiting_for_key = true;
+  }
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX15(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form FX15. Set the delay timer to the value in register X
+  cpu.delay_timer_reg = cpu.general_reg[instruction.x];
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX18(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form FX18. Set the sound timer to the value in register X
+  cpu.sound_timer_reg = cpu.general_reg[instruction.x];
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX1E(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form FX1E. Adds the value in register X to register I
+  cpu.index_reg += cpu.general_reg[instruction.x];
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX29(CPU& cpu, const Operands& instruction, Memory&, Graphics&,
+                                     Keypad&) {
+  // Of form FX29. Set the value of register I to the address of the sprite that represents the
+  // hexadecimal digit stored in register X.
+  cpu.index_reg = (cpu.general_reg[instruction.x] & 0x0F) * 5;
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX33(CPU& cpu, const Operands& instruction, Memory& mem, Graphics&,
+                                     Keypad&) {
+  // Of form FX33. Set the value stored in register X in binary coded. The hundredth digit is placed
+  // at address stored in register I, the tenth digit is placed at 1 + address stored in register I
+  // and the ones digit is placed at 2 + address stored in register I.
+  const auto value = cpu.general_reg[instruction.x];
+
+  if (!in_memory(cpu.index_reg, 3)) {
+    cpu.raise(Fault::invalid_address);
+    return;
+  }
+
+  // Yay floor division
+  // truncates the last 2 digits
+  mem.set_value_unchecked(cpu.index_reg, value / 100);
+  // truncates the last digit and then truncates the first digit of result
+  mem.set_value_unchecked(cpu.index_reg + 1, (value / 10) % 10);
+  // truncates the first digit and then truncates the first digit of result
+  mem.set_value_unchecked(cpu.index_reg + 2, (value % 100) % 10);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX55(CPU& cpu, const Operands& instruction, Memory& mem, Graphics&,
+                                     Keypad&) {
+  // Of form FX55. Stores the values from register 0 to register X inclusive starting at the
+  // address in register I. Register I is then set to I + X + 1 after the operation.
+  const auto x = static_cast<size_t>(instruction.x);
+
+  if (!in_memory(cpu.index_reg, x + 1)) {
+    cpu.raise(Fault::invalid_address);
+    return;
+  }
+
+  for (auto reg = 0; reg <= x; reg++) {
+    mem.set_value_unchecked(cpu.index_reg + reg, cpu.general_reg[reg]);
+  }
+  cpu.index_reg = static_cast<unsigned short>(cpu.index_reg + x + 1);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_FX65(CPU& cpu, const Operands& instruction, Memory& mem, Graphics&,
+                                     Keypad&) {
+  // Of form FX65. Stores values in registers 0 to X inclusive with values in memory starting from
+  // the address in register I. Register I is then set to I + X + 1 after the operation.
+  const auto x = static_cast<size_t>(instruction.x);
+
+  if (!in_memory(cpu.index_reg, x + 1)) {
+    cpu.raise(Fault::invalid_address);
+    return;
+  }
+
+  for (auto reg = 0; reg <= x; reg++) {
+    cpu.general_reg[reg] = mem.get_value_unchecked(cpu.index_reg + reg);
+  }
+  cpu.index_reg = static_cast<unsigned short>(cpu.index_reg + x + 1);
+}
+
+template <class Access>
+template <class Operands>
+void arch::BasicCPU<Access>::op_invalid(CPU& cpu, const Operands&, Memory&, Graphics&, Keypad&) {
+  cpu.raise(Fault::invalid_instruction);
+}
+
+template <class Access>
+template <arch::Op Form, class Operands>
+void arch::BasicCPU<Access>::semantics(CPU& cpu, const Operands& instruction, Memory& mem,
+                                       Graphics& graphics, Keypad& keypad) {
+#if defined(CHIP8_OPCODE_COUNTERS) || defined(CHIP8_TRACE)
+  const auto next_pc = cpu.pc_reg;
+#endif
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  const auto start = std::chrono::steady_clock::now();
+#endif
+
+  if constexpr (Form == Op::op_00E0) {
+    op_00E0(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_00EE) {
+    op_00EE(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_1NNN) {
+    op_1NNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_2NNN) {
+    op_2NNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_3XNN) {
+    op_3XNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_4XNN) {
+    op_4XNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_5XY0) {
+    op_5XY0(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_6XNN) {
+    op_6XNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_7XNN) {
+    op_7XNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY0) {
+    op_8XY0(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY1) {
+    op_8XY1(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY2) {
+    op_8XY2(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY3) {
+    op_8XY3(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY4) {
+    op_8XY4(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY5) {
+    op_8XY5(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY6) {
+    op_8XY6(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XY7) {
+    op_8XY7(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_8XYE) {
+    op_8XYE(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_9XY0) {
+    op_9XY0(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_ANNN) {
+    op_ANNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_BNNN) {
+    op_BNNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_CXNN) {
+    op_CXNN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_DXYN) {
+    op_DXYN(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_EX9E) {
+    op_EX9E(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_EXA1) {
+    op_EXA1(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX07) {
+    op_FX07(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX0A) {
+    op_FX0A(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX15) {
+    op_FX15(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX18) {
+    op_FX18(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX1E) {
+    op_FX1E(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX29) {
+    op_FX29(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX33) {
+    op_FX33(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX55) {
+    op_FX55(cpu, instruction, mem, graphics, keypad);
+  } else if constexpr (Form == Op::op_FX65) {
+    op_FX65(cpu, instruction, mem, graphics, keypad);
+  } else {
+    op_invalid(cpu, instruction, mem, graphics, keypad);
+  }
+
+#if defined(CHIP8_TRACE)
+  if (cpu.trace != nullptr) {
+    const unsigned char reg = writes_vx(Form) ? instruction.x : no_register;
+    const unsigned char value = writes_vx(Form) ? cpu.general_reg[instruction.x] : 0;
+    cpu.trace->write(TraceRecord{static_cast<unsigned short>(next_pc - 2), instruction.opcode,
+                                 cpu.index_reg, reg, value, cpu.general_reg[0xF],
+                                 cpu.delay_timer_reg, cpu.sound_timer_reg, 0});
+  }
+#endif
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  cpu.handler_latencies[static_cast<size_t>(Form)].record(std::chrono::steady_clock::now() - start);
+#endif
+
+#if defined(CHIP8_OPCODE_COUNTERS)
+  // Skip forms only move the program counter when they skip
+  cpu.opcode_counters.count(Form, instruction.opcode, cpu.pc_reg != next_pc);
+#endif
+}
+
+template <class Access>
+template <unsigned short Opcode>
+void arch::BasicCPU<Access>::op_fixed(CPU& cpu, const Instruction&, Memory& mem,
+                                      Graphics& graphics, Keypad& keypad) {
+  semantics<decode_op(Opcode)>(cpu, FixedInstruction<Opcode>{}, mem, graphics, keypad);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "instruction.h"
+#include "opcode_spec.h"
+
+namespace arch {
+  // What guest time is measured in
+  enum class Timing : unsigned char {
+    instructions,  // Every instruction takes the same time, at a fixed instructions per second
+    vip_cycles,    // Every instruction takes the machine cycles the COSMAC VIP interpreter took
+  };
+
+  // The VIP runs its 1802 at 1.76 MHz, 8 clocks per machine cycle, which is 3668 machine cycles per
+  // 60 Hz frame. The 1861 display steals 8 of them for every one of its 128 lines by DMA, and the
+  // interpreter gets the rest.
+  constexpr unsigned int vip_cycles_per_frame = 3668;
+  constexpr unsigned int vip_display_cycles_per_frame = 128 * 8;
+
+  // Machine cycles per second left to the interpreter, the rate guest time advances at with
+  // Timing::vip_cycles
+  constexpr unsigned int vip_cycles_per_second
+      = (vip_cycles_per_frame - vip_display_cycles_per_frame) * 60;
+
+  // Machine cycles the VIP interpreter spends fetching an instruction and jumping to its routine
+  constexpr unsigned int vip_fetch_cycles = 40;
+
+  // Machine cycles of an opcode form, on top of vip_fetch_cycles
+  struct OpCost {
+    unsigned short cycles;       // Cost of the routine, or of its fixed part
+    unsigned short skip_cycles;  // Extra cost when a conditional skip is taken
+  };
+
+  // Approximate costs of the routines in the VIP interpreter. The operand dependent parts of DXYN,
+  // FX33, FX55 and FX65 are added by instruction_cycles.
+  constexpr OpCost vip_op_cost(Op op) noexcept {
+    switch (op) {
+      case Op::op_00E0:
+        return {680, 0};  // Clears the 256 bytes of display memory
+      case Op::op_00EE:
+        return {10, 0};
+      case Op::op_1NNN:
+        return {12, 0};
+      case Op::op_2NNN:
+        return {26, 0};
+      case Op::op_3XNN:
+      case Op::op_4XNN:
+        return {10, 4};
+      case Op::op_5XY0:
+      case Op::op_9XY0:
+        return {14, 4};
+      case Op::op_6XNN:
+        return {6, 0};
+      case Op::op_7XNN:
+        return {10, 0};
+      case Op::op_8XY0:
+      case Op::op_8XY1:
+      case Op::op_8XY2:
+      case Op::op_8XY3:
+      case Op::op_8XY4:
+      case Op::op_8XY5:
+      case Op::op_8XY6:
+      case Op::op_8XY7:
+      case Op::op_8XYE:
+        return {20, 0};
+      case Op::op_ANNN:
+        return {12, 0};
+      case Op::op_BNNN:
+        return {22, 0};
+      case Op::op_CXNN:
+        return {36, 0};
+      case Op::op_DXYN:
+        return {46, 0};
+      case Op::op_EX9E:
+      case Op::op_EXA1:
+        return {14, 4};
+      case Op::op_FX07:
+      case Op::op_FX15:
+      case Op::op_FX18:
+        return {10, 0};
+      case Op::op_FX0A:
+        return {18, 0};  // One poll of the keypad
+      case Op::op_FX1E:
+      case Op::op_FX29:
+        return {16, 0};
+      case Op::op_FX33:
+        return {40, 0};
+      case Op::op_FX55:
+      case Op::op_FX65:
+        return {14, 0};
+      case Op::op_invalid:
+        return {0, 0};
+    }
+    return {0, 0};
+  }
+
+  template <size_t... Forms>
+  constexpr std::array<OpCost, sizeof...(Forms)> make_vip_op_costs(std::index_sequence<Forms...>) {
+    return {vip_op_cost(static_cast<Op>(Forms))...};
+  }
+
+  // Indexed by Op
+  inline constexpr std::array<OpCost, num_ops> vip_op_costs
+      = make_vip_op_costs(std::make_index_sequence<num_ops>{});
+
+  // Machine cycles DXYN spends on each sprite row. A row at a multiple of 8 is one byte of
+  // display memory, anything else is shifted right one bit at a time and spans two.
+  constexpr unsigned int vip_draw_row_cycles(unsigned char x) noexcept {
+    const auto shift = x % 8u;
+    return shift == 0 ? 34 : 48 + 4 * shift;
+  }
+
+  // Machine cycles the VIP interpreter takes to execute opcode. vx is the value register X held
+  // before it executed and skipped is true if it skipped the next instruction.
+  constexpr unsigned int instruction_cycles(unsigned short opcode, unsigned char vx,
+                                            bool skipped) noexcept {
+    const auto op = decode_op(opcode);
+    const auto cost = vip_op_costs[static_cast<size_t>(op)];
+    auto cycles = vip_fetch_cycles + cost.cycles + (skipped ? cost.skip_cycles : 0u);
+
+    switch (op) {
+      case Op::op_DXYN:
+        cycles += (opcode & 0x000F) * vip_draw_row_cycles(vx);
+        break;
+      case Op::op_FX33:
+        // Each digit is found by repeated subtraction
+        cycles += 16 * (vx / 100 + vx / 10 % 10 + vx % 10);
+        break;
+      case Op::op_FX55:
+      case Op::op_FX65:
+        cycles += 14 * (((opcode & 0x0F00) >> 8) + 1u);
+        break;
+      default:
+        break;
+    }
+    return cycles;
+  }
+}  // namespace arch
@@ -0,0 +1,226 @@
+#include <array>
+#include <format>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+#include "cpu.h"
+#include "cpu_handlers.h"
+
+namespace {
+  // Must be kept in the same order as arch::Fusion
+  constexpr std::array<std::string_view, arch::num_fusions> fusion_names{
+      "pending", "none", "load_run", "counted_loop", "sprite_draw", "delay_wait"};
+}  // namespace
+
+std::string arch::fusion_report(const FusionCounters& counters) {
+  std::string report;
+  for (auto kind = static_cast<size_t>(Fusion::load_run); kind < num_fusions; kind++) {
+    const auto percent = counters.total_instructions == 0
+                             ? 0.0
+                             : 100.0 * static_cast<double>(counters.instructions[kind])
+                                   / static_cast<double>(counters.total_instructions);
+    report += std::format("{0}: {1} hits covering {2} instructions ({3:.2f}%)\n",
+                          fusion_names[kind], counters.hits[kind], counters.instructions[kind],
+                          percent);
+  }
+  return report;
+}
+
+template <class Access>
+arch::FusedInstruction arch::BasicCPU<Access>::fuse(const Memory& mem, unsigned short address) {
+  FusedInstruction fused{};
+  fused.kind = Fusion::none;
+
+  // Decode as many instructions as the longest sequence could need
+  std::array<Instruction, max_fused_length> window{};
+  size_t available = 0;
+  while (available < max_fused_length
+         && address + 2 * available + 1 <= static_cast<size_t>(max_mem_address)) {
+    const auto pc = static_cast<unsigned short>(address + 2 * available);
+    window[available] = decode(static_cast<unsigned short>(mem.get_value_unchecked(pc) << 8
+                                                           | mem.get_value_unchecked(pc + 1)));
+    available++;
+  }
+
+  const auto matches = [&](std::initializer_list<Op> ops) {
+    if (ops.size() > available) {
+      return false;
+    }
+    size_t i = 0;
+    for (auto op : ops) {
+      if (window[i++].op != op) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (matches({Op::op_6XNN, Op::op_6XNN})) {
+    fused.kind = Fusion::load_run;
+    while (fused.length < available && window[fused.length].op == Op::op_6XNN) {
+      fused.x[fused.length] = window[fused.length].x;
+      fused.nn[fused.length] = window[fused.length].nn;
+      fused.length++;
+    }
+  } else if (matches({Op::op_7XNN, Op::op_3XNN, Op::op_1NNN})
+             || matches({Op::op_FX07, Op::op_3XNN, Op::op_1NNN})) {
+    fused.kind = window[0].op == Op::op_7XNN ? Fusion::counted_loop : Fusion::delay_wait;
+    fused.length = 3;
+    fused.x[0] = window[0].x;
+    fused.nn[0] = window[0].nn;
+    fused.x[1] = window[1].x;
+    fused.nn[1] = window[1].nn;
+    fused.nnn = window[2].nnn;
+  } else if (matches({Op::op_ANNN, Op::op_DXYN})) {
+    fused.kind = Fusion::sprite_draw;
+    fused.length = 2;
+    fused.nnn = window[0].nnn;
+    fused.x[0] = window[1].x;
+    fused.x[1] = window[1].y;
+    fused.nn[0] = window[1].n;
+  }
+
+  if (fused.kind != Fusion::none) {
+    fused.last_opcode = window[fused.length - 1].opcode;
+  }
+  return fused;
+}
+
+template <class Access>
+size_t arch::BasicCPU<Access>::step_fused(Memory& mem, Graphics& graphics, Keypad& keypad,
+                                          size_t budget) noexcept {
+  const auto* fused = mem.get_fused(pc_reg);
+  if (fused != nullptr && fused->kind == Fusion::pending) {
+    mem.set_fused(pc_reg, fuse(mem, pc_reg));
+  }
+
+  size_t executed = 1;
+  if (fused == nullptr || fused->kind == Fusion::none || fused->length > budget) {
+    try_step(mem, graphics, keypad);
+  } else {
+    const auto kind = static_cast<size_t>(fused->kind);
+    executed = execute_fused(*fused, mem, graphics, keypad, budget);
+    fusion_counters.hits[kind]++;
+    fusion_counters.instructions[kind] += executed;
+  }
+
+  fusion_counters.total_instructions += executed;
+  return executed;
+}
+
+template <class Access>
+size_t arch::BasicCPU<Access>::execute_fused(const FusedInstruction& fused, Memory& mem,
+                                             Graphics& graphics, Keypad& keypad,
+                                             size_t budget) noexcept {
+  updated_screen = false;
+
+  switch (fused.kind) {
+    case Fusion::load_run:
+      for (size_t i = 0; i < fused.length; i++) {
+        general_reg[fused.x[i]] = fused.nn[i];
+      }
+      pc_reg = static_cast<unsigned short>(pc_reg + 2 * fused.length);
+      curr_opcode = fused.last_opcode;
+      return fused.length;
+    case Fusion::counted_loop:
+      return execute_fused_loop<false>(fused, budget);
+    case Fusion::delay_wait:
+      return execute_fused_loop<true>(fused, budget);
+    case Fusion::sprite_draw: {
+      // DXYN only reads its operands, so a partially filled Instruction is enough
+      Instruction draw{};
+      draw.x = fused.x[0];
+      draw.y = fused.x[1];
+      draw.n = fused.nn[0];
+      index_reg = fused.nnn;
+      pc_reg = static_cast<unsigned short>(pc_reg + 4);
+      curr_opcode = fused.last_opcode;
+      op_DXYN(*this, draw, mem, graphics, keypad);
+      return 2;
+    }
+    default:
+      // Never cached with a length that fits a budget
+      try_step(mem, graphics, keypad);
+      return 1;
+  }
+}
+
+template <class Access>
+template <bool LoadDelayTimer>
+size_t arch::BasicCPU<Access>::execute_fused_loop(const FusedInstruction& fused,
+                                                  size_t budget) noexcept {
+  // A loop that jumps back to its own start keeps going in here for as long as the budget allows
+  const auto start = pc_reg;
+  size_t executed = 0;
+
+  do {
+    if constexpr (LoadDelayTimer) {
+      general_reg[fused.x[0]] = delay_timer_reg;
+    } else {
+      general_reg[fused.x[0]] = static_cast<unsigned char>(general_reg[fused.x[0]] + fused.nn[0]);
+    }
+
+    if (general_reg[fused.x[1]] == fused.nn[1]) {
+      // 3XNN skips the jump
+      pc_reg = static_cast<unsigned short>(start + 6);
+      curr_opcode = static_cast<unsigned short>(0x3000 | fused.x[1] << 8 | fused.nn[1]);
+      return executed + 2;
+    }
+
+    executed += 3;
+    pc_reg = fused.nnn;
+  } while (fused.nnn == start && budget - executed >= 3);
+
+  curr_opcode = fused.last_opcode;
+  return executed;
+}
+
+template <class Access>
+unsigned int arch::BasicCPU<Access>::count_fused_cycles(const FusedInstruction& fused,
+                                                        size_t executed,
+                                                        unsigned char vf) noexcept {
+  unsigned int cycles = 0;
+  switch (fused.kind) {
+    case Fusion::load_run:
+      cycles = static_cast<unsigned int>(executed) * instruction_cycles(0x6000, 0, false);
+      break;
+    case Fusion::counted_loop:
+    case Fusion::delay_wait: {
+      // Every full iteration is 3 instructions, and one that leaves the loop skips the jump
+      const auto first = fused.kind == Fusion::counted_loop ? 0x7000 : 0xF007;
+      const auto iterations = static_cast<unsigned int>(executed / 3);
+      cycles = iterations
+               * (instruction_cycles(first, 0, false) + instruction_cycles(0x3000, 0, false)
+                  + instruction_cycles(0x1000, 0, false));
+      if (executed % 3 == 2) {
+        cycles += instruction_cycles(first, 0, false) + instruction_cycles(0x3000, 0, true);
+      }
+      break;
+    }
+    case Fusion::sprite_draw: {
+      // DXYN only overwrites VF
+      const auto vx = fused.x[0] == 0xF ? vf : general_reg[fused.x[0]];
+      cycles = instruction_cycles(0xA000, 0, false) + instruction_cycles(fused.last_opcode, vx, false);
+      break;
+    }
+    default:
+      break;
+  }
+  guest_cycles += cycles;
+  return cycles;
+}
+
+template arch::FusedInstruction arch::CPU::fuse(const Memory& mem, unsigned short address);
+template size_t arch::CPU::step_fused(Memory& mem, Graphics& graphics, Keypad& keypad,
+                                      size_t budget) noexcept;
+template unsigned int arch::CPU::count_fused_cycles(const FusedInstruction& fused, size_t executed,
+                                                    unsigned char vf) noexcept;
+
+template arch::FusedInstruction arch::BasicCPU<arch::WrappingAccess>::fuse(
+    const BasicMemory<WrappingAccess>& mem, unsigned short address);
+template size_t arch::BasicCPU<arch::WrappingAccess>::step_fused(
+    BasicMemory<WrappingAccess>& mem, BasicGraphics<WrappingAccess>& graphics, Keypad& keypad,
+    size_t budget) noexcept;
+template unsigned int arch::BasicCPU<arch::WrappingAccess>::count_fused_cycles(
+    const FusedInstruction& fused, size_t executed, unsigned char vf) noexcept;
@@ -1,35 +1,41 @@
 #include "graphics.h"
 
-arch::Graphics::Graphics() { clear_screen(); }
-
-void arch::Graphics::set_pixel(size_t x, size_t y, bool pixel) {
-  if (x >= graphics::screen_width || y >= graphics::screen_height) {
-    throw graphics::PixelCoordinateOutOfBounds();
-  } else {
-    const auto idx = y * graphics::screen_width + x;
-    display_pixels[idx] = pixel;
-  }
+template <class Access>
+arch::BasicGraphics<Access>::BasicGraphics() { clear_screen(); }
+
+template <class Access>
+void arch::BasicGraphics<Access>::set_pixel(size_t x, size_t y, bool pixel) {
+  const auto idx = row(y) * graphics::screen_width + column(x);
+  display_pixels[idx] = pixel;
 }
 
-bool arch::Graphics::get_pixel(size_t x, size_t y) const {
-  if (x >= graphics::screen_width || y >= graphics::screen_height) {
-    throw graphics::PixelCoordinateOutOfBounds();
-  } else {
-    const auto idx = y * graphics::screen_width + x;
-    return display_pixels[idx];
-  }
+template <class Access>
+bool arch::BasicGraphics<Access>::get_pixel(size_t x, size_t y) const {
+  const auto idx = row(y) * graphics::screen_width + column(x);
+  return display_pixels[idx];
 }
 
-void arch::Graphics::clear_screen() noexcept {
+template <class Access>
+void arch::BasicGraphics<Access>::clear_screen() noexcept {
   for (auto& pixel : display_pixels) {
     pixel = false;
   }
 }
 
-bool arch::Graphics::draw_pixel(size_t x, size_t y, bool value) {
-  const auto curr_pixel = get_pixel(x, y);
-  const auto new_pixel = (curr_pixel != value);
-  set_pixel(x, y, new_pixel);
+template <class Access>
+bool arch::BasicGraphics<Access>::draw_pixel(size_t x, size_t y, bool value) {
+  return draw_pixel_unchecked(column(x), row(y), value);
+}
 
-  return curr_pixel && (!new_pixel);
+template <class Access>
+size_t arch::BasicGraphics<Access>::column(size_t x) {
+  return Access::template index<graphics::PixelCoordinateOutOfBounds>(x, graphics::screen_width);
 }
+
+template <class Access>
+size_t arch::BasicGraphics<Access>::row(size_t y) {
+  return Access::template index<graphics::PixelCoordinateOutOfBounds>(y, graphics::screen_height);
+}
+
+template class arch::BasicGraphics<arch::CheckedAccess>;
+template class arch::BasicGraphics<arch::WrappingAccess>;
@@ -3,6 +3,8 @@
 #include <array>
 #include <stdexcept>
 
+#include "access.h"
+
 namespace arch {
   namespace graphics {
     constexpr size_t screen_width = 64;                            // Number of pixels wide
@@ -17,9 +19,12 @@ namespace arch {
     };
   }  // namespace graphics
 
-  class Graphics {
+  // Monochrome screen. Access decides what set_pixel, get_pixel and draw_pixel do with a
+  // coordinate off the screen, see CheckedAccess and WrappingAccess.
+  template <class Access>
+  class BasicGraphics {
   public:
-    Graphics();
+    BasicGraphics();
 
     void set_pixel(size_t x, size_t y, bool pixel);
 
@@ -29,7 +34,23 @@ namespace arch {
 
     bool draw_pixel(size_t x, size_t y, bool value);
 
+    // draw_pixel without the bounds check, for the CPU core which always wraps its coordinates.
+    // x must be less than screen_width and y less than screen_height.
+    bool draw_pixel_unchecked(size_t x, size_t y, bool value) noexcept {
+      auto& pixel = display_pixels[y * graphics::screen_width + x];
+      const auto curr_pixel = pixel;
+      pixel = (curr_pixel != value);
+
+      return curr_pixel && value;
+    }
+
   private:
+    // Coordinates after Access has been applied to them
+    static size_t column(size_t x);
+    static size_t row(size_t y);
+
     std::array<bool, graphics::total_pixels> display_pixels;
   };
+
+  using Graphics = BasicGraphics<CheckedAccess>;
 }  // namespace arch
@@ -0,0 +1,164 @@
+#include "idle.h"
+
+#include <algorithm>
+
+namespace {
+  // Decrements both timers by ticks, stopping at 0
+  template <class Access>
+  void tick_timers(arch::BasicCPU<Access>& cpu, size_t ticks) {
+    cpu.delay_timer_reg = ticks >= cpu.delay_timer_reg
+                              ? 0
+                              : static_cast<unsigned char>(cpu.delay_timer_reg - ticks);
+    cpu.sound_timer_reg = ticks >= cpu.sound_timer_reg
+                              ? 0
+                              : static_cast<unsigned char>(cpu.sound_timer_reg - ticks);
+  }
+}  // namespace
+
+template <class Access>
+arch::IdleLoop arch::detect_idle_loop(const BasicMemory<Access>& mem, unsigned short address) {
+  IdleLoop loop{};
+  loop.wait = IdleWait::none;
+
+  if ((address & 0x1) != 0) {
+    return loop;
+  }
+
+  // Anything past the end of memory decodes as an invalid instruction and matches nothing
+  const auto decode_at = [&](size_t index) {
+    const auto pc = address + 2 * index;
+    if (pc + 1 > max_mem_address) {
+      return BasicCPU<Access>::decode(0x0000);
+    }
+    const auto high = mem.get_value_unchecked(static_cast<unsigned short>(pc));
+    const auto low = mem.get_value_unchecked(static_cast<unsigned short>(pc + 1));
+    return BasicCPU<Access>::decode(static_cast<unsigned short>(high << 8 | low));
+  };
+
+  const auto first = decode_at(0);
+  const auto second = decode_at(1);
+
+  if ((first.op == Op::op_EX9E || first.op == Op::op_EXA1) && second.op == Op::op_1NNN
+      && second.nnn == address) {
+    loop.wait = first.op == Op::op_EX9E ? IdleWait::key_press : IdleWait::key_release;
+    loop.length = 2;
+    loop.x = first.x;
+    loop.last_opcode = second.opcode;
+    loop.cycles = static_cast<unsigned short>(instruction_cycles(first.opcode, 0, false)
+                                              + instruction_cycles(second.opcode, 0, false));
+    return loop;
+  }
+
+  if (first.op != Op::op_FX07
+      || (second.op != Op::op_3XNN && second.op != Op::op_4XNN)
+      || second.x != first.x) {
+    return loop;
+  }
+
+  const auto third = decode_at(2);
+  if (third.op == Op::op_1NNN && third.nnn == address) {
+    loop.wait = IdleWait::delay_timer;
+    loop.length = 3;
+    loop.x = first.x;
+    loop.nn = second.nn;
+    loop.exit_on_equal = second.op == Op::op_3XNN;
+    loop.last_opcode = third.opcode;
+    loop.cycles = static_cast<unsigned short>(instruction_cycles(first.opcode, 0, false)
+                                              + instruction_cycles(second.opcode, 0, false)
+                                              + instruction_cycles(third.opcode, 0, false));
+  }
+  return loop;
+}
+
+template <class Access>
+arch::IdleSkip arch::skip_idle_loop(BasicCPU<Access>& cpu, const BasicMemory<Access>& mem,
+                                    const Keypad& keypad, size_t max_cycles, TimerUnit& timers,
+                                    bool stop_on_tick) {
+  const auto loop = detect_idle_loop(mem, cpu.pc_reg);
+  IdleSkip skip{0, loop.wait, 0};
+
+  // Guest time of one iteration in the units of timers
+  const size_t iteration_time = timers.timing() == Timing::vip_cycles ? loop.cycles : loop.length;
+  const auto until_tick = [&] {
+    return (timers.next_timer_event() + iteration_time - 1) / iteration_time;
+  };
+
+  const auto skip_iterations = [&](size_t iterations) {
+    const auto ticks = timers.advance(iterations * iteration_time);
+    tick_timers(cpu, ticks);
+    skip.cycles += iterations * loop.length;
+    skip.ticks += ticks;
+    cpu.guest_cycles += iterations * loop.cycles;
+  };
+  const auto iterations_left = [&] {
+    if (stop_on_tick && skip.ticks > 0) {
+      return size_t{0};
+    }
+    const auto left = (max_cycles - skip.cycles) / loop.length;
+    return stop_on_tick ? std::min(left, until_tick()) : left;
+  };
+
+  switch (loop.wait) {
+    case IdleWait::none:
+      return skip;
+    case IdleWait::delay_timer:
+      while (iterations_left() > 0) {
+        const auto value = cpu.delay_timer_reg;
+        if ((value == loop.nn) == loop.exit_on_equal) {
+          break;
+        }
+        cpu.set_general_reg(loop.x, value);
+        if (value == 0) {
+          // The timer has stopped so the loop can never exit on its own
+          skip_iterations(iterations_left());
+        } else {
+          // Every iteration that starts before the next tick reads the same value, the tick lands
+          // in the last of them
+          skip_iterations(std::min(until_tick(), iterations_left()));
+        }
+      }
+      break;
+    case IdleWait::key_press:
+    case IdleWait::key_release: {
+      // Keys outside of the keypad are never pressed and never skip
+      const auto key = cpu.get_general_reg(loop.x);
+      const auto valid = key < keypad::num_of_keys;
+      const auto pressed = valid && keypad.is_pressed_unchecked(key);
+      const auto exits = loop.wait == IdleWait::key_press ? pressed : valid && !pressed;
+      if (!exits) {
+        skip_iterations(iterations_left());
+      }
+      break;
+    }
+  }
+
+  if (skip.cycles > 0) {
+    cpu.curr_opcode = loop.last_opcode;
+    cpu.updated_screen = false;
+  }
+  return skip;
+}
+
+template <class Access>
+arch::IdleSkip arch::skip_idle_loop(BasicCPU<Access>& cpu, const BasicMemory<Access>& mem,
+                                    const Keypad& keypad, size_t max_cycles) {
+  TimerUnit timers(timer_frequency);
+  return skip_idle_loop(cpu, mem, keypad, max_cycles, timers);
+}
+
+template arch::IdleLoop arch::detect_idle_loop(const Memory& mem, unsigned short address);
+template arch::IdleLoop arch::detect_idle_loop(const BasicMemory<WrappingAccess>& mem,
+                                               unsigned short address);
+
+template arch::IdleSkip arch::skip_idle_loop(CPU& cpu, const Memory& mem, const Keypad& keypad,
+                                             size_t max_cycles, TimerUnit& timers,
+                                             bool stop_on_tick);
+template arch::IdleSkip arch::skip_idle_loop(BasicCPU<WrappingAccess>& cpu,
+                                             const BasicMemory<WrappingAccess>& mem,
+                                             const Keypad& keypad, size_t max_cycles,
+                                             TimerUnit& timers, bool stop_on_tick);
+template arch::IdleSkip arch::skip_idle_loop(CPU& cpu, const Memory& mem, const Keypad& keypad,
+                                             size_t max_cycles);
+template arch::IdleSkip arch::skip_idle_loop(BasicCPU<WrappingAccess>& cpu,
+                                             const BasicMemory<WrappingAccess>& mem,
+                                             const Keypad& keypad, size_t max_cycles);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cpu.h"
+#include "keypad.h"
+#include "memory.h"
+#include "timers.h"
+
+namespace arch {
+  // What an idle polling loop is waiting on
+  enum class IdleWait : unsigned char {
+    none,         // Not an idle loop
+    delay_timer,  // FX07, 3XNN or 4XNN, 1NNN back to the FX07
+    key_press,    // EX9E, 1NNN back to the EX9E
+    key_release,  // EXA1, 1NNN back to the EXA1
+  };
+
+  // A loop that has no side effect other than rewriting the register it polls, so running it again
+  // only changes state once the delay timer or the keypad does.
+  struct IdleLoop {
+    IdleWait wait;               // What the loop waits on
+    unsigned char length;        // Instructions in one iteration
+    unsigned char x;             // Register that is polled or holds the key
+    unsigned char nn;            // Value compared against for delay timer loops
+    bool exit_on_equal;          // 3XNN leaves the loop when register X equals nn, 4XNN when not
+    unsigned short last_opcode;  // Opcode of the jump back
+    unsigned short cycles;       // VIP machine cycles of one iteration, see instruction_cycles
+  };
+
+  // Result of skip_idle_loop
+  struct IdleSkip {
+    size_t cycles;  // Cycles skipped, 0 if the program counter was not at an idle loop
+    IdleWait wait;  // What the loop at the program counter waits on
+    size_t ticks;   // Timer ticks in the cycles skipped
+  };
+
+  // Returns the idle loop starting at address, which has wait IdleWait::none if there is none
+  template <class Access>
+  [[nodiscard]] IdleLoop detect_idle_loop(const BasicMemory<Access>& mem, unsigned short address);
+
+  // If the program counter of cpu is at the start of an idle loop, advances the machine by whole
+  // iterations of the loop, up to max_cycles, without executing them. Stops at the iteration in
+  // which the loop could exit, so the instructions that see the change still run normally.
+  // Guest time advances through timers by every cycle skipped and the delay and sound timers of
+  // cpu tick accordingly, the same as Chip8::emulate_cycle does. The machine cycles of the skipped
+  // iterations are added to the guest_cycles of cpu. With stop_on_tick it also stops at the end of
+  // the iteration the timers first tick in.
+  template <class Access>
+  IdleSkip skip_idle_loop(BasicCPU<Access>& cpu, const BasicMemory<Access>& mem,
+                          const Keypad& keypad, size_t max_cycles, TimerUnit& timers,
+                          bool stop_on_tick = false);
+
+  // As above with the timers ticking once per cycle, which is a rate of timer_frequency
+  // instructions per second
+  template <class Access>
+  IdleSkip skip_idle_loop(BasicCPU<Access>& cpu, const BasicMemory<Access>& mem,
+                          const Keypad& keypad, size_t max_cycles);
+}  // namespace arch
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "access.h"
+
+namespace arch {
+  template <class Access>
+  class BasicCPU;
+  template <class Access>
+  class BasicMemory;
+  template <class Access>
+  class BasicGraphics;
+  class Keypad;
+
+  template <class Access>
+  struct BasicInstruction;
+
+  // Every opcode form the CPU implements, see opcode_specs for how each is encoded. Used by
+  // dispatch engines that index their own tables instead of calling through the handler pointer.
+  enum class Op : unsigned char {
+    op_00E0,
+    op_00EE,
+    op_1NNN,
+    op_2NNN,
+    op_3XNN,
+    op_4XNN,
+    op_5XY0,
+    op_6XNN,
+    op_7XNN,
+    op_8XY0,
+    op_8XY1,
+    op_8XY2,
+    op_8XY3,
+    op_8XY4,
+    op_8XY5,
+    op_8XY6,
+    op_8XY7,
+    op_8XYE,
+    op_9XY0,
+    op_ANNN,
+    op_BNNN,
+    op_CXNN,
+    op_DXYN,
+    op_EX9E,
+    op_EXA1,
+    op_FX07,
+    op_FX0A,
+    op_FX15,
+    op_FX18,
+    op_FX1E,
+    op_FX29,
+    op_FX33,
+    op_FX55,
+    op_FX65,
+    op_invalid,
+  };
+
+  constexpr size_t num_ops = static_cast<size_t>(Op::op_invalid) + 1;  // Number of opcode forms
+
+  // Executes a single decoded instruction against the machine state.
+  template <class Access>
+  using InstructionHandler
+      = void (*)(BasicCPU<Access>& cpu, const BasicInstruction<Access>& instruction,
+                 BasicMemory<Access>& mem, BasicGraphics<Access>& graphics, Keypad& keypad);
+
+  // An opcode that has already been decoded. The handler that implements the opcode is resolved
+  // and all operand fields are extracted up front so that executing it again does not need to
+  // re-parse the nibbles of the opcode.
+  template <class Access>
+  struct BasicInstruction {
+    InstructionHandler<Access> handler;  // nullptr marks an instruction that has not been decoded
+    unsigned short opcode;               // Raw opcode the instruction was decoded from
+    unsigned short nnn;                  // Lowest 12 bits, an address
+    unsigned char x;                     // Second highest nibble, a register ID
+    unsigned char y;                     // Second lowest nibble, a register ID
+    unsigned char n;                     // Lowest nibble
+    unsigned char nn;                    // Lowest 8 bits
+    Op op;                               // Opcode form that handler implements
+  };
+
+  using Instruction = BasicInstruction<CheckedAccess>;
+
+  constexpr size_t max_fused_length = 8;  // Most guest instructions covered by one superinstruction
+
+  // Instruction sequences that are run as a single superinstruction
+  enum class Fusion : unsigned char {
+    pending,       // The address has not been analysed yet
+    none,          // Nothing starting at the address can be fused
+    load_run,      // Two or more 6XNN in a row
+    counted_loop,  // 7XNN, 3XNN, 1NNN
+    sprite_draw,   // ANNN, DXYN
+    delay_wait,    // FX07, 3XNN, 1NNN
+  };
+
+  constexpr size_t num_fusions = static_cast<size_t>(Fusion::delay_wait) + 1;  // Number of kinds
+
+  // A superinstruction found by fusing the instructions starting at an address. Fields that a kind
+  // does not list are unused.
+  //   load_run:     x[i] and nn[i] of every 6XNN
+  //   counted_loop: x[0] and nn[0] of 7XNN, x[1] and nn[1] of 3XNN, nnn of 1NNN
+  //   sprite_draw:  nnn of ANNN, x[0] and x[1] as X and Y of DXYN, nn[0] as N of DXYN
+  //   delay_wait:   x[0] of FX07, x[1] and nn[1] of 3XNN, nnn of 1NNN
+  struct FusedInstruction {
+    Fusion kind;                                     // Fusion::pending until analysed
+    unsigned char length;                            // Guest instructions in the sequence
+    unsigned short nnn;                              // Address operand
+    unsigned short last_opcode;                      // Opcode of the final instruction
+    std::array<unsigned char, max_fused_length> x;   // Register operands
+    std::array<unsigned char, max_fused_length> nn;  // Byte operands
+  };
+
+  // Operand fields of Opcode known at compile time. Has the same members as Instruction so that
+  // handlers written against one can be instantiated with the other, which bakes the operands into
+  // the generated code.
+  template <unsigned short Opcode>
+  struct FixedInstruction {
+    static constexpr unsigned short opcode = Opcode;
+    static constexpr auto nnn = static_cast<unsigned short>(Opcode & 0x0FFF);
+    static constexpr auto x = static_cast<unsigned char>((Opcode & 0x0F00) >> 8);
+    static constexpr auto y = static_cast<unsigned char>((Opcode & 0x00F0) >> 4);
+    static constexpr auto n = static_cast<unsigned char>(Opcode & 0x000F);
+    static constexpr auto nn = static_cast<unsigned char>(Opcode & 0x00FF);
+  };
+}  // namespace arch
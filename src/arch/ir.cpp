@@ -0,0 +1,478 @@
+#include "ir.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace {
+  constexpr unsigned char flag_reg = 0xF;  // VF
+
+  // Value of a micro-op other than load and store. operand returns the value of a temporary and
+  // is only called for the temporaries the micro-op reads.
+  template <class Operand>
+  constexpr unsigned short evaluate(const arch::Uop& uop, Operand operand) {
+    switch (uop.kind) {
+      case arch::UopKind::set:
+        return uop.imm;
+      case arch::UopKind::add:
+        return (operand(uop.a) + operand(uop.b)) & 0xFF;
+      case arch::UopKind::add_imm:
+        return (operand(uop.a) + uop.imm) & 0xFF;
+      case arch::UopKind::sub:
+        return (operand(uop.a) - operand(uop.b)) & 0xFF;
+      case arch::UopKind::bit_or:
+        return operand(uop.a) | operand(uop.b);
+      case arch::UopKind::bit_and:
+        return operand(uop.a) & operand(uop.b);
+      case arch::UopKind::bit_xor:
+        return operand(uop.a) ^ operand(uop.b);
+      case arch::UopKind::shr:
+        return operand(uop.a) >> 1;
+      case arch::UopKind::shl:
+        return (operand(uop.a) << 1) & 0xFF;
+      case arch::UopKind::carry:
+        return operand(uop.a) + operand(uop.b) > 0xFF ? 1 : 0;
+      case arch::UopKind::no_borrow:
+        return operand(uop.a) >= operand(uop.b) ? 1 : 0;
+      case arch::UopKind::low_bit:
+        return operand(uop.a) & 0x1;
+      case arch::UopKind::high_bit:
+        return operand(uop.a) >> 7;
+      case arch::UopKind::add_wide:
+        return (operand(uop.a) + operand(uop.b)) & 0xFFFF;
+      case arch::UopKind::font:
+        return (operand(uop.a) & 0x0F) * 5;
+      default:
+        return 0;
+    }
+  }
+
+  // Temporaries read by uop, the second is only meaningful when count is 2
+  struct Reads {
+    size_t count;
+    std::array<unsigned char, 2> temps;
+  };
+
+  constexpr Reads reads(const arch::Uop& uop) {
+    switch (uop.kind) {
+      case arch::UopKind::load:
+      case arch::UopKind::set:
+        return {0, {}};
+      case arch::UopKind::store:
+      case arch::UopKind::add_imm:
+      case arch::UopKind::shr:
+      case arch::UopKind::shl:
+      case arch::UopKind::low_bit:
+      case arch::UopKind::high_bit:
+      case arch::UopKind::font:
+        return {1, {uop.a}};
+      default:
+        return {2, {uop.a, uop.b}};
+    }
+  }
+
+  constexpr bool ends_in_skip(arch::IrExit exit) { return exit != arch::IrExit::jump; }
+}  // namespace
+
+template <class Access>
+arch::IrBlock arch::lower_block(const BasicMemory<Access>& mem, unsigned short address) {
+  IrBlock block{};
+  block.exit = IrExit::jump;
+
+  const auto emit = [&](UopKind kind, unsigned char a = 0, unsigned char b = 0,
+                        unsigned short imm = 0) {
+    const auto dst = static_cast<unsigned char>(block.temps++);
+    block.uops.push_back(Uop{kind, dst, a, b, imm});
+    return dst;
+  };
+  const auto load = [&](unsigned char reg) { return emit(UopKind::load, reg); };
+  const auto store = [&](unsigned char reg, unsigned char value) {
+    block.uops.push_back(Uop{UopKind::store, reg, value, 0, 0});
+  };
+  const auto skip = [&](IrExit exit, unsigned char a, unsigned char b) {
+    block.exit = exit;
+    block.a = a;
+    block.b = b;
+  };
+
+  auto pc = address;
+  auto ends = false;
+  while (!ends && block.length < ir_max_block_length && (pc & 0x1) == 0 && pc < max_mem_address) {
+    const auto opcode = static_cast<unsigned short>(mem.get_value_unchecked(pc) << 8
+                                                    | mem.get_value_unchecked(pc + 1));
+    const auto instruction = BasicCPU<Access>::decode(opcode);
+    const auto x = instruction.x;
+    const auto y = instruction.y;
+    ends = true;
+
+    // Stores happen in the same order as in the handlers, so operands that are VF read the flag
+    // the handler would have seen
+    switch (instruction.op) {
+      case Op::op_1NNN:
+        block.target = instruction.nnn;
+        break;
+      case Op::op_3XNN:
+        skip(IrExit::skip_eq, load(x), emit(UopKind::set, 0, 0, instruction.nn));
+        break;
+      case Op::op_4XNN:
+        skip(IrExit::skip_ne, load(x), emit(UopKind::set, 0, 0, instruction.nn));
+        break;
+      case Op::op_5XY0:
+        skip(IrExit::skip_eq, load(x), load(y));
+        break;
+      case Op::op_9XY0:
+        skip(IrExit::skip_ne, load(x), load(y));
+        break;
+      case Op::op_6XNN:
+        store(x, emit(UopKind::set, 0, 0, instruction.nn));
+        ends = false;
+        break;
+      case Op::op_7XNN:
+        store(x, emit(UopKind::add_imm, load(x), 0, instruction.nn));
+        ends = false;
+        break;
+      case Op::op_8XY0:
+        store(x, load(y));
+        ends = false;
+        break;
+      case Op::op_8XY1:
+        store(x, emit(UopKind::bit_or, load(x), load(y)));
+        ends = false;
+        break;
+      case Op::op_8XY2:
+        store(x, emit(UopKind::bit_and, load(x), load(y)));
+        ends = false;
+        break;
+      case Op::op_8XY3:
+        store(x, emit(UopKind::bit_xor, load(x), load(y)));
+        ends = false;
+        break;
+      case Op::op_8XY4: {
+        const auto vx = load(x);
+        const auto vy = load(y);
+        const auto sum = emit(UopKind::add, vx, vy);
+        store(flag_reg, emit(UopKind::carry, vx, vy));
+        store(x, sum);
+        ends = false;
+        break;
+      }
+      case Op::op_8XY5:
+        store(flag_reg, emit(UopKind::no_borrow, load(x), load(y)));
+        store(x, emit(UopKind::sub, load(x), load(y)));
+        ends = false;
+        break;
+      case Op::op_8XY6:
+        store(flag_reg, emit(UopKind::low_bit, load(y)));
+        store(x, emit(UopKind::shr, load(y)));
+        ends = false;
+        break;
+      case Op::op_8XY7: {
+        const auto vx = load(x);
+        const auto vy = load(y);
+        const auto diff = emit(UopKind::sub, vy, vx);
+        store(flag_reg, emit(UopKind::no_borrow, vy, vx));
+        store(x, diff);
+        ends = false;
+        break;
+      }
+      case Op::op_8XYE:
+        store(flag_reg, emit(UopKind::high_bit, load(y)));
+        store(x, emit(UopKind::shl, load(y)));
+        ends = false;
+        break;
+      case Op::op_ANNN:
+        store(ir_index_reg, emit(UopKind::set, 0, 0, instruction.nnn));
+        ends = false;
+        break;
+      case Op::op_FX07:
+        store(x, load(ir_delay_timer));
+        ends = false;
+        break;
+      case Op::op_FX15:
+        store(ir_delay_timer, load(x));
+        ends = false;
+        break;
+      case Op::op_FX18:
+        store(ir_sound_timer, load(x));
+        ends = false;
+        break;
+      case Op::op_FX1E:
+        store(ir_index_reg, emit(UopKind::add_wide, load(ir_index_reg), load(x)));
+        ends = false;
+        break;
+      case Op::op_FX29:
+        store(ir_index_reg, emit(UopKind::font, load(x)));
+        ends = false;
+        break;
+      default:
+        // Left to the interpreter, the block ends before it
+        block.target = pc;
+        return block;
+    }
+
+    block.length++;
+    block.last_opcode = opcode;
+    pc += 2;
+  }
+
+  // Skips are relative to the instruction after them, and blocks cut short carry on there
+  if (block.exit != IrExit::jump || !ends) {
+    block.target = pc;
+  }
+  return block;
+}
+
+void arch::remove_redundant_loads(IrBlock& block) {
+  // Temporary holding the current value of each guest register, if the block has one yet
+  std::array<std::optional<unsigned char>, ir_guest_regs> holder{};
+  std::vector<unsigned char> alias(block.temps);
+  for (size_t temp = 0; temp < alias.size(); temp++) {
+    alias[temp] = static_cast<unsigned char>(temp);
+  }
+
+  std::vector<Uop> kept;
+  for (auto uop : block.uops) {
+    const auto operands = reads(uop);
+    if (operands.count > 0) {
+      uop.a = alias[uop.a];
+    }
+    if (operands.count > 1) {
+      uop.b = alias[uop.b];
+    }
+
+    if (uop.kind == UopKind::load) {
+      if (holder[uop.a].has_value()) {
+        alias[uop.dst] = *holder[uop.a];
+        continue;
+      }
+      holder[uop.a] = uop.dst;
+    } else if (uop.kind == UopKind::store) {
+      holder[uop.dst] = uop.a;
+    }
+    kept.push_back(uop);
+  }
+
+  if (ends_in_skip(block.exit)) {
+    block.a = alias[block.a];
+    block.b = alias[block.b];
+  }
+  block.uops = std::move(kept);
+}
+
+void arch::propagate_constants(IrBlock& block) {
+  std::vector<std::optional<unsigned short>> known(block.temps);
+  const auto is_known = [&](unsigned char temp) { return known[temp].has_value(); };
+
+  for (auto& uop : block.uops) {
+    if (uop.kind == UopKind::load || uop.kind == UopKind::store) {
+      continue;
+    }
+
+    const auto operands = reads(uop);
+    if ((operands.count < 1 || is_known(uop.a)) && (operands.count < 2 || is_known(uop.b))) {
+      const auto value = evaluate(uop, [&](unsigned char temp) { return *known[temp]; });
+      uop = Uop{UopKind::set, uop.dst, 0, 0, value};
+      known[uop.dst] = value;
+    }
+  }
+
+  if (ends_in_skip(block.exit) && is_known(block.a) && is_known(block.b)) {
+    const auto equal = *known[block.a] == *known[block.b];
+    if (equal == (block.exit == IrExit::skip_eq)) {
+      block.target += 2;
+    }
+    block.exit = IrExit::jump;
+  }
+}
+
+void arch::eliminate_dead_stores(IrBlock& block) {
+  // Every guest register is visible once the block exits
+  std::array<bool, ir_guest_regs> guest_live{};
+  guest_live.fill(true);
+  std::vector<bool> temp_live(block.temps, false);
+  if (ends_in_skip(block.exit)) {
+    temp_live[block.a] = true;
+    temp_live[block.b] = true;
+  }
+
+  std::vector<Uop> kept;
+  for (auto uop = block.uops.rbegin(); uop != block.uops.rend(); uop++) {
+    if (uop->kind == UopKind::store) {
+      if (!guest_live[uop->dst]) {
+        continue;
+      }
+      guest_live[uop->dst] = false;
+    } else {
+      if (!temp_live[uop->dst]) {
+        continue;
+      }
+      if (uop->kind == UopKind::load) {
+        guest_live[uop->a] = true;
+      }
+    }
+
+    const auto operands = reads(*uop);
+    for (size_t i = 0; i < operands.count; i++) {
+      temp_live[operands.temps[i]] = true;
+    }
+    kept.push_back(*uop);
+  }
+
+  std::reverse(kept.begin(), kept.end());
+  block.uops = std::move(kept);
+}
+
+void arch::optimize(IrBlock& block) {
+  remove_redundant_loads(block);
+  propagate_constants(block);
+  eliminate_dead_stores(block);
+}
+
+arch::IrEngine::IrEngine() : guest{}, slots(decoded_slots), ir_counters{} {}
+
+template <class Access>
+size_t arch::IrEngine::run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                           BasicGraphics<Access>& graphics, Keypad& keypad, size_t count) {
+  load_guest(cpu);
+
+  size_t executed = 0;
+  size_t lowered = 0;
+  auto screen_changed = false;
+  auto last_opcode = cpu.curr_opcode;
+
+  while (executed < count && !cpu.trapped()) {
+    const auto pc = cpu.pc_reg;
+    Slot* slot = nullptr;
+    if (pc <= max_mem_address && (pc & 0x1) == 0) {
+      slot = &slots[pc >> 1];
+      if (!slot->translated) {
+        slot->block = lower_block(mem, pc);
+        ir_counters.instructions += slot->block.length;
+        ir_counters.lowered += slot->block.uops.size();
+        optimize(slot->block);
+        ir_counters.optimized += slot->block.uops.size();
+        slot->translated = true;
+      }
+    }
+
+    const size_t length = slot == nullptr ? 0 : slot->block.length;
+    if (length > 0 && length <= count - executed) {
+      cpu.pc_reg = execute(slot->block, guest);
+      last_opcode = slot->block.last_opcode;
+      executed += length;
+      lowered += length;
+      continue;
+    }
+
+    // Fall back to the interpreter for a single instruction
+    store_guest(cpu);
+    const auto index_before = cpu.index_reg;
+    cpu.try_step(mem, graphics, keypad);
+    executed++;
+    screen_changed = screen_changed || cpu.updated_screen;
+    last_opcode = cpu.curr_opcode;
+
+    // Drop blocks of any code the instruction wrote over
+    invalidate_stores(last_opcode, index_before);
+    load_guest(cpu);
+  }
+
+  store_guest(cpu);
+  cpu.curr_opcode = last_opcode;
+  cpu.updated_screen = screen_changed;
+  return lowered;
+}
+
+unsigned short arch::IrEngine::execute(const IrBlock& block,
+                                       std::array<unsigned short, ir_guest_regs>& guest) noexcept {
+  std::array<unsigned short, 256> temps;
+  const auto temp = [&](unsigned char index) { return temps[index]; };
+
+  for (const auto& uop : block.uops) {
+    switch (uop.kind) {
+      case UopKind::load:
+        temps[uop.dst] = guest[uop.a];
+        break;
+      case UopKind::store:
+        guest[uop.dst] = temps[uop.a];
+        break;
+      default:
+        temps[uop.dst] = evaluate(uop, temp);
+        break;
+    }
+  }
+
+  switch (block.exit) {
+    case IrExit::skip_eq:
+      return temps[block.a] == temps[block.b] ? block.target + 2 : block.target;
+    case IrExit::skip_ne:
+      return temps[block.a] != temps[block.b] ? block.target + 2 : block.target;
+    default:
+      return block.target;
+  }
+}
+
+void arch::IrEngine::invalidate(unsigned short address) noexcept {
+  if (address > max_mem_address) {
+    return;
+  }
+
+  // Only blocks starting at most a full block length before address can cover it
+  const size_t last_slot = address >> 1;
+  const size_t first_slot = last_slot >= ir_max_block_length ? last_slot - ir_max_block_length + 1
+                                                             : 0;
+  for (auto index = first_slot; index <= last_slot; index++) {
+    auto& slot = slots[index];
+    const size_t length = slot.block.length == 0 ? 1 : slot.block.length;
+    if (index + length > last_slot) {
+      slot.translated = false;
+    }
+  }
+}
+
+void arch::IrEngine::flush() noexcept {
+  for (auto& slot : slots) {
+    slot.translated = false;
+  }
+}
+
+void arch::IrEngine::invalidate_stores(unsigned short opcode, unsigned short index) noexcept {
+  size_t written = 0;
+  if ((opcode & 0xF0FF) == 0xF033) {
+    written = 3;
+  } else if ((opcode & 0xF0FF) == 0xF055) {
+    written = ((opcode & 0x0F00) >> 8) + 1;
+  }
+
+  for (size_t i = 0; i < written; i++) {
+    invalidate(static_cast<unsigned short>(index + i));
+  }
+}
+
+template <class Access>
+void arch::IrEngine::load_guest(const BasicCPU<Access>& cpu) noexcept {
+  std::copy(cpu.general_reg.begin(), cpu.general_reg.end(), guest.begin());
+  guest[ir_index_reg] = cpu.index_reg;
+  guest[ir_delay_timer] = cpu.delay_timer_reg;
+  guest[ir_sound_timer] = cpu.sound_timer_reg;
+}
+
+template <class Access>
+void arch::IrEngine::store_guest(BasicCPU<Access>& cpu) const noexcept {
+  for (size_t reg = 0; reg < num_general_reg; reg++) {
+    cpu.general_reg[reg] = static_cast<unsigned char>(guest[reg]);
+  }
+  cpu.index_reg = guest[ir_index_reg];
+  cpu.delay_timer_reg = static_cast<unsigned char>(guest[ir_delay_timer]);
+  cpu.sound_timer_reg = static_cast<unsigned char>(guest[ir_sound_timer]);
+}
+
+template arch::IrBlock arch::lower_block(const Memory& mem, unsigned short address);
+template arch::IrBlock arch::lower_block(const BasicMemory<WrappingAccess>& mem,
+                                         unsigned short address);
+
+template size_t arch::IrEngine::run(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad,
+                                    size_t count);
+template size_t arch::IrEngine::run(BasicCPU<WrappingAccess>& cpu,
+                                    BasicMemory<WrappingAccess>& mem,
+                                    BasicGraphics<WrappingAccess>& graphics, Keypad& keypad,
+                                    size_t count);
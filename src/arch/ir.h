@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace arch {
+  constexpr size_t ir_max_block_length = 32;  // Most guest instructions lowered into one block
+
+  // Guest state that micro-ops load from and store to, numbered after the general registers
+  constexpr unsigned char ir_index_reg = 16;    // I
+  constexpr unsigned char ir_delay_timer = 17;  // Delay timer
+  constexpr unsigned char ir_sound_timer = 18;  // Sound timer
+  constexpr size_t ir_guest_regs = 19;          // V0 to VF, I and both timers
+
+  // Micro-op kinds. Guest state is only touched by load and store, everything else reads and
+  // writes temporaries, each of which is written exactly once in a block. Results of the 8 bit ops
+  // are masked to a byte.
+  enum class UopKind : unsigned char {
+    load,       // t[dst] = guest[a]
+    store,      // guest[dst] = t[a]
+    set,        // t[dst] = imm
+    add,        // t[dst] = t[a] + t[b]
+    add_imm,    // t[dst] = t[a] + imm
+    sub,        // t[dst] = t[a] - t[b]
+    bit_or,     // t[dst] = t[a] | t[b]
+    bit_and,    // t[dst] = t[a] & t[b]
+    bit_xor,    // t[dst] = t[a] ^ t[b]
+    shr,        // t[dst] = t[a] >> 1
+    shl,        // t[dst] = t[a] << 1
+    carry,      // t[dst] = 1 if t[a] + t[b] overflows a byte, otherwise 0
+    no_borrow,  // t[dst] = 1 if t[a] >= t[b], otherwise 0
+    low_bit,    // t[dst] = t[a] & 1
+    high_bit,   // t[dst] = t[a] >> 7
+    add_wide,   // t[dst] = t[a] + t[b] masked to 16 bits, for the index register
+    font,       // t[dst] = (t[a] & 0xF) * 5
+  };
+
+  struct Uop {
+    UopKind kind;
+    unsigned char dst;   // Temporary written, or the guest register of a store
+    unsigned char a;     // First temporary read, or the guest register of a load
+    unsigned char b;     // Second temporary read
+    unsigned short imm;  // Immediate operand
+  };
+
+  // How a block picks the program counter it leaves with
+  enum class IrExit : unsigned char {
+    jump,     // target
+    skip_eq,  // target + 2 if t[a] == t[b], otherwise target
+    skip_ne,  // target + 2 if t[a] != t[b], otherwise target
+  };
+
+  // Register only guest instructions lowered into micro-ops. Blocks end at a jump or skip, or
+  // before the first instruction that touches anything but the registers and timers, which is left
+  // to the interpreter.
+  struct IrBlock {
+    std::vector<Uop> uops;
+    IrExit exit;
+    unsigned char a;             // Temporaries compared by a skip
+    unsigned char b;
+    unsigned short target;       // See IrExit
+    unsigned short length;       // Guest instructions in the block, 0 if there are none
+    unsigned short last_opcode;  // Opcode of the final instruction in the block
+    unsigned short temps;        // Temporaries used
+  };
+
+  // Lowers the block starting at address
+  template <class Access>
+  [[nodiscard]] IrBlock lower_block(const BasicMemory<Access>& mem, unsigned short address);
+
+  // Optimization passes. Each keeps the guest state at the end of the block the same.
+
+  // Replaces loads of a guest register that the block already loaded or stored with the
+  // temporary holding the value
+  void remove_redundant_loads(IrBlock& block);
+
+  // Evaluates micro-ops whose operands are all known at translation time, and turns skips on known
+  // values into jumps
+  void propagate_constants(IrBlock& block);
+
+  // Drops stores that a later store to the same guest register overwrites before anything reads
+  // it, such as the VF flag of 8XY4 followed by 8XY5, and then every micro-op whose result is
+  // unused
+  void eliminate_dead_stores(IrBlock& block);
+
+  // Runs every pass in order
+  void optimize(IrBlock& block);
+
+  // Micro-ops in the blocks translated so far
+  struct IrCounters {
+    unsigned long long instructions;  // Guest instructions lowered
+    unsigned long long lowered;       // Micro-ops straight out of lower_block
+    unsigned long long optimized;     // Micro-ops left after optimize
+  };
+
+  // Runs guest code as optimized micro-op blocks through a small interpreter, falling back to the
+  // CPU for every instruction lower_block leaves out. Blocks are cached per address and dropped
+  // when FX33 or FX55 write over them.
+  class IrEngine {
+  public:
+    IrEngine();
+
+    // Runs count instructions starting at the program counter of cpu and returns how many were
+    // executed as micro-ops. Blocks are only entered when they fit in the remaining count so that
+    // exactly count instructions are executed. updated_screen is set if any instruction updated
+    // the screen. Stops early if an interpreted instruction traps, see CPU::trap.
+    template <class Access>
+    size_t run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem, BasicGraphics<Access>& graphics,
+               Keypad& keypad, size_t count);
+
+    // Drops any block that covers address. Writes made by FX33 and FX55 while running are handled
+    // automatically, this is for writes made to mem from outside of run.
+    void invalidate(unsigned short address) noexcept;
+
+    // Drops every block
+    void flush() noexcept;
+
+    [[nodiscard]] const IrCounters& counters() const noexcept { return ir_counters; }
+
+    // Executes the micro-ops of block against guest and returns the program counter it leaves with
+    static unsigned short execute(const IrBlock& block,
+                                  std::array<unsigned short, ir_guest_regs>& guest) noexcept;
+
+  private:
+    struct Slot {
+      bool translated;  // block holds the translation of this address
+      IrBlock block;
+    };
+
+    // Drops any block written over by opcode when it was executed with the index register at
+    // index. Only FX33 and FX55 write to memory, any other opcode does nothing.
+    void invalidate_stores(unsigned short opcode, unsigned short index) noexcept;
+
+    template <class Access>
+    void load_guest(const BasicCPU<Access>& cpu) noexcept;
+
+    template <class Access>
+    void store_guest(BasicCPU<Access>& cpu) const noexcept;
+
+    std::array<unsigned short, ir_guest_regs> guest;
+
+    // Translations indexed by starting address / 2
+    std::vector<Slot> slots;
+
+    IrCounters ir_counters;
+  };
+}  // namespace arch
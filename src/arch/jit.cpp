@@ -0,0 +1,398 @@
+#include "jit.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#if defined(CHIP8_JIT_AVAILABLE)
+#  include <sys/mman.h>
+#endif
+
+namespace {
+  // Offsets of the context fields, all addressed as [rdi + disp8]
+  constexpr auto index_offset = static_cast<unsigned char>(offsetof(arch::JitContext, index_reg));
+  constexpr auto pc_offset = static_cast<unsigned char>(offsetof(arch::JitContext, pc_reg));
+  constexpr auto retired_offset = static_cast<unsigned char>(offsetof(arch::JitContext, retired));
+  static_assert(retired_offset < 0x80, "Context fields must be reachable with an 8 bit offset");
+
+  constexpr unsigned char flag_reg = 0xF;  // VF
+
+  // ModRM bytes for [rdi + disp8] with al or cl in the reg field
+  constexpr unsigned char modrm_al = 0x47;
+  constexpr unsigned char modrm_cl = 0x4F;
+
+  constexpr unsigned char lo(unsigned short value) { return static_cast<unsigned char>(value); }
+
+  constexpr unsigned char hi(unsigned short value) {
+    return static_cast<unsigned char>(value >> 8);
+  }
+}  // namespace
+
+arch::Jit::Jit() : context{}, blocks{}, code_buffer(nullptr), code_used(0) {
+#if defined(CHIP8_JIT_AVAILABLE)
+  void* buffer = mmap(nullptr, jit_code_size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+  // Without executable memory every instruction is simply interpreted
+  if (buffer != MAP_FAILED) {
+    code_buffer = static_cast<unsigned char*>(buffer);
+  }
+#endif
+}
+
+arch::Jit::~Jit() {
+#if defined(CHIP8_JIT_AVAILABLE)
+  if (code_buffer != nullptr) {
+    munmap(code_buffer, jit_code_size);
+  }
+#endif
+}
+
+template <class Access>
+size_t arch::Jit::run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                      BasicGraphics<Access>& graphics, Keypad& keypad, size_t count) {
+  if (code_buffer == nullptr) {
+    auto screen_changed = false;
+    size_t translated = 0;
+    for (size_t executed = 0; executed < count && !cpu.trapped(); executed++) {
+      run_block(cpu, mem, graphics, keypad, 1, std::numeric_limits<unsigned long long>::max(),
+                translated);
+      screen_changed = screen_changed || cpu.updated_screen;
+    }
+    cpu.updated_screen = screen_changed;
+    return 0;
+  }
+
+  load_context(cpu);
+  context.retired = 0;
+
+  size_t executed = 0;
+  auto screen_changed = false;
+  auto last_opcode = cpu.curr_opcode;
+
+  while (executed < count && !cpu.trapped()) {
+    executed += execute_block(cpu, mem, graphics, keypad, count - executed,
+                              std::numeric_limits<unsigned long long>::max(), screen_changed,
+                              last_opcode);
+  }
+
+  store_context(cpu);
+  cpu.curr_opcode = last_opcode;
+  cpu.updated_screen = screen_changed;
+
+  return static_cast<size_t>(context.retired);
+}
+
+template <class Access>
+size_t arch::Jit::run_block(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                            BasicGraphics<Access>& graphics, Keypad& keypad, size_t count,
+                            unsigned long long cycles, size_t& translated) {
+  translated = 0;
+  if (count == 0 || cpu.trapped()) {
+    return 0;
+  }
+
+  if (code_buffer == nullptr) {
+    const auto pc = cpu.pc_reg;
+    const auto vf = cpu.general_reg[0xF];
+    cpu.try_step(mem, graphics, keypad);
+    cpu.count_cycles(pc, vf);
+    return 1;
+  }
+
+  load_context(cpu);
+  context.retired = 0;
+
+  auto screen_changed = false;
+  auto last_opcode = cpu.curr_opcode;
+  const auto executed
+      = execute_block(cpu, mem, graphics, keypad, count, cycles, screen_changed, last_opcode);
+
+  store_context(cpu);
+  cpu.curr_opcode = last_opcode;
+  cpu.updated_screen = screen_changed;
+
+  translated = static_cast<size_t>(context.retired);
+  return executed;
+}
+
+void arch::Jit::invalidate_stores(unsigned short opcode, unsigned short index) noexcept {
+  size_t written = 0;
+  if ((opcode & 0xF0FF) == 0xF033) {
+    written = 3;
+  } else if ((opcode & 0xF0FF) == 0xF055) {
+    written = ((opcode & 0x0F00) >> 8) + 1;
+  }
+
+  // Writes past the end of memory wrap around to the start under WrappingAccess, and trap before
+  // writing anything under CheckedAccess
+  for (size_t i = 0; i < written; i++) {
+    invalidate(static_cast<unsigned short>((index + i) & max_mem_address));
+  }
+}
+
+template <class Access>
+size_t arch::Jit::execute_block(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                                BasicGraphics<Access>& graphics, Keypad& keypad, size_t count,
+                                unsigned long long cycles, bool& screen_changed,
+                                unsigned short& last_opcode) {
+  const auto pc = context.pc_reg;
+  const Block* block = nullptr;
+  if (pc <= max_mem_address && (pc & 0x1) == 0) {
+    block = &blocks[pc >> 1];
+    if (block->code == nullptr) {
+      block = block->interpret ? nullptr : translate(pc, mem);
+    }
+  }
+
+  if (block != nullptr && block->length <= count && block->cycles + block->skip_cycles <= cycles) {
+    block->code(&context);
+    last_opcode = block->last_opcode;
+    // Only a skip at the end of the block can move the program counter 4 past it
+    const auto skipped = context.pc_reg == static_cast<unsigned short>(pc + 2 * block->length + 2);
+    cpu.guest_cycles += block->cycles + (skipped ? block->skip_cycles : 0);
+    return block->length;
+  }
+
+  // Fall back to the interpreter for a single instruction
+  store_context(cpu);
+  const auto index_before = cpu.index_reg;
+  const auto vf = cpu.general_reg[0xF];
+  cpu.try_step(mem, graphics, keypad);
+  cpu.count_cycles(pc, vf);
+  screen_changed = screen_changed || cpu.updated_screen;
+  last_opcode = cpu.curr_opcode;
+
+  // Drop translations of any code the instruction wrote over
+  invalidate_stores(last_opcode, index_before);
+
+  load_context(cpu);
+  return 1;
+}
+
+void arch::Jit::invalidate(unsigned short address) noexcept {
+  if (address > max_mem_address) {
+    return;
+  }
+
+  // Only blocks starting at most a full block length before address can cover it
+  const size_t last_slot = address >> 1;
+  const size_t first_slot = last_slot >= jit_max_block_length ? last_slot - jit_max_block_length + 1
+                                                              : 0;
+  for (auto slot = first_slot; slot <= last_slot; slot++) {
+    auto& block = blocks[slot];
+    const size_t length = block.length == 0 ? 1 : block.length;
+    if (slot + length > last_slot) {
+      block = Block{};
+    }
+  }
+}
+
+void arch::Jit::flush() noexcept {
+  blocks.fill(Block{});
+  code_used = 0;
+}
+
+template <class Access>
+const arch::Jit::Block* arch::Jit::translate(unsigned short address,
+                                             const BasicMemory<Access>& mem) {
+#if defined(CHIP8_JIT_AVAILABLE)
+  pending.clear();
+
+  unsigned short length = 0;
+  unsigned short last_opcode = 0;
+  unsigned int cycles = 0;
+  auto ends_block = false;
+  auto pc = address;
+
+  while (length < jit_max_block_length && pc < max_mem_address && !ends_block) {
+    const auto opcode = static_cast<unsigned short>(mem.get_value_unchecked(pc) << 8
+                                                    | mem.get_value_unchecked(pc + 1));
+    const auto mark = pending.size();
+    if (!emit_instruction(opcode, static_cast<unsigned short>(pc + 2), ends_block)) {
+      pending.resize(mark);
+      break;
+    }
+    last_opcode = opcode;
+    // Translated forms have no operand dependent cost
+    cycles += instruction_cycles(opcode, 0, false);
+    length++;
+    pc += 2;
+  }
+
+  auto& block = blocks[address >> 1];
+  if (length == 0) {
+    block.interpret = true;
+    return nullptr;
+  }
+
+  if (!ends_block) {
+    // mov word [rdi + pc], next pc
+    emit({0x66, 0xC7, modrm_al, pc_offset, lo(pc), hi(pc)});
+  }
+  // add qword [rdi + retired], length
+  emit({0x48, 0x81, modrm_al, retired_offset, lo(length), hi(length), 0x00, 0x00});
+  // ret
+  emit({0xC3});
+
+  if (code_used + pending.size() > jit_code_size) {
+    flush();
+  }
+
+  if (mprotect(code_buffer, jit_code_size, PROT_READ | PROT_WRITE) != 0) {
+    block.interpret = true;
+    return nullptr;
+  }
+  auto* code = code_buffer + code_used;
+  std::memcpy(code, pending.data(), pending.size());
+  code_used += pending.size();
+  mprotect(code_buffer, jit_code_size, PROT_READ | PROT_EXEC);
+
+  block.code = reinterpret_cast<BlockFunction>(code);
+  block.length = length;
+  block.last_opcode = last_opcode;
+  block.cycles = cycles;
+  block.skip_cycles = vip_op_costs[static_cast<size_t>(decode_op(last_opcode))].skip_cycles;
+  return &block;
+#else
+  static_cast<void>(address);
+  static_cast<void>(mem);
+  return nullptr;
+#endif
+}
+
+void arch::Jit::emit(std::initializer_list<unsigned char> bytes) {
+  pending.insert(pending.end(), bytes.begin(), bytes.end());
+}
+
+bool arch::Jit::emit_instruction(unsigned short opcode, unsigned short next_pc, bool& ends_block) {
+  const auto x = static_cast<unsigned char>((opcode & 0x0F00) >> 8);
+  const auto y = static_cast<unsigned char>((opcode & 0x00F0) >> 4);
+  const auto nn = static_cast<unsigned char>(opcode & 0x00FF);
+  const auto nnn = static_cast<unsigned short>(opcode & 0x0FFF);
+  const auto skip_pc = static_cast<unsigned short>(next_pc + 2);
+
+  // Each translation follows the order of reads and writes of the interpreter handler so that the
+  // results match even when X or Y is register F.
+  switch (decode_op(opcode)) {
+    case Op::op_1NNN:
+      // mov word [rdi + pc], nnn
+      emit({0x66, 0xC7, modrm_al, pc_offset, lo(nnn), hi(nnn)});
+      ends_block = true;
+      return true;
+    case Op::op_3XNN:
+    case Op::op_4XNN:
+      // mov word [rdi + pc], next; cmp byte [rdi + x], nn; jne/je +6; mov word [rdi + pc], skip
+      emit({0x66, 0xC7, modrm_al, pc_offset, lo(next_pc), hi(next_pc)});
+      emit({0x80, 0x7F, x, nn});
+      emit({static_cast<unsigned char>(decode_op(opcode) == Op::op_3XNN ? 0x75 : 0x74), 0x06});
+      emit({0x66, 0xC7, modrm_al, pc_offset, lo(skip_pc), hi(skip_pc)});
+      ends_block = true;
+      return true;
+    case Op::op_5XY0:
+    case Op::op_9XY0:
+      // mov word [rdi + pc], next; mov al, [rdi + x]; cmp al, [rdi + y]; jne/je +6;
+      // mov word [rdi + pc], skip
+      emit({0x66, 0xC7, modrm_al, pc_offset, lo(next_pc), hi(next_pc)});
+      emit({0x8A, modrm_al, x, 0x3A, modrm_al, y});
+      emit({static_cast<unsigned char>(decode_op(opcode) == Op::op_5XY0 ? 0x75 : 0x74), 0x06});
+      emit({0x66, 0xC7, modrm_al, pc_offset, lo(skip_pc), hi(skip_pc)});
+      ends_block = true;
+      return true;
+    case Op::op_6XNN:
+      // mov byte [rdi + x], nn
+      emit({0xC6, modrm_al, x, nn});
+      return true;
+    case Op::op_7XNN:
+      // add byte [rdi + x], nn
+      emit({0x80, modrm_al, x, nn});
+      return true;
+    case Op::op_8XY0:
+      // mov al, [rdi + y]; mov [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x88, modrm_al, x});
+      return true;
+    case Op::op_8XY1:
+      // mov al, [rdi + y]; or [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x08, modrm_al, x});
+      return true;
+    case Op::op_8XY2:
+      // mov al, [rdi + y]; and [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x20, modrm_al, x});
+      return true;
+    case Op::op_8XY3:
+      // mov al, [rdi + y]; xor [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x30, modrm_al, x});
+      return true;
+    case Op::op_8XY4:
+      // mov al, [rdi + x]; add al, [rdi + y]; setc cl; mov [rdi + F], cl; mov [rdi + x], al
+      emit({0x8A, modrm_al, x, 0x02, modrm_al, y, 0x0F, 0x92, 0xC1});
+      emit({0x88, modrm_cl, flag_reg, 0x88, modrm_al, x});
+      return true;
+    case Op::op_8XY5:
+      // mov al, [rdi + x]; cmp al, [rdi + y]; setae cl; mov [rdi + F], cl;
+      // mov al, [rdi + x]; sub al, [rdi + y]; mov [rdi + x], al
+      emit({0x8A, modrm_al, x, 0x3A, modrm_al, y, 0x0F, 0x93, 0xC1, 0x88, modrm_cl, flag_reg});
+      emit({0x8A, modrm_al, x, 0x2A, modrm_al, y, 0x88, modrm_al, x});
+      return true;
+    case Op::op_8XY6:
+      // mov al, [rdi + y]; and al, 1; mov [rdi + F], al; mov al, [rdi + y]; shr al, 1;
+      // mov [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x24, 0x01, 0x88, modrm_al, flag_reg});
+      emit({0x8A, modrm_al, y, 0xD0, 0xE8, 0x88, modrm_al, x});
+      return true;
+    case Op::op_8XY7:
+      // mov al, [rdi + y]; sub al, [rdi + x]; setae cl; mov [rdi + F], cl; mov [rdi + x], al
+      emit({0x8A, modrm_al, y, 0x2A, modrm_al, x, 0x0F, 0x93, 0xC1});
+      emit({0x88, modrm_cl, flag_reg, 0x88, modrm_al, x});
+      return true;
+    case Op::op_8XYE:
+      // mov al, [rdi + y]; shr al, 7; mov [rdi + F], al; mov al, [rdi + y]; add al, al;
+      // mov [rdi + x], al
+      emit({0x8A, modrm_al, y, 0xC0, 0xE8, 0x07, 0x88, modrm_al, flag_reg});
+      emit({0x8A, modrm_al, y, 0x00, 0xC0, 0x88, modrm_al, x});
+      return true;
+    case Op::op_ANNN:
+      // mov word [rdi + index], nnn
+      emit({0x66, 0xC7, modrm_al, index_offset, lo(nnn), hi(nnn)});
+      return true;
+    case Op::op_FX1E:
+      // movzx eax, byte [rdi + x]; add [rdi + index], ax
+      emit({0x0F, 0xB6, modrm_al, x, 0x66, 0x01, modrm_al, index_offset});
+      return true;
+    case Op::op_FX29:
+      // movzx eax, byte [rdi + x]; and eax, 0xF; lea eax, [rax + rax * 4]; mov [rdi + index], ax
+      emit({0x0F, 0xB6, modrm_al, x, 0x83, 0xE0, 0x0F, 0x8D, 0x04, 0x80});
+      emit({0x66, 0x89, modrm_al, index_offset});
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <class Access>
+void arch::Jit::load_context(const BasicCPU<Access>& cpu) noexcept {
+  context.general_reg = cpu.general_reg;
+  context.index_reg = cpu.index_reg;
+  context.pc_reg = cpu.pc_reg;
+}
+
+template <class Access>
+void arch::Jit::store_context(BasicCPU<Access>& cpu) const noexcept {
+  cpu.general_reg = context.general_reg;
+  cpu.index_reg = context.index_reg;
+  cpu.pc_reg = context.pc_reg;
+}
+
+template size_t arch::Jit::run(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad,
+                               size_t count);
+template size_t arch::Jit::run_block(CPU& cpu, Memory& mem, Graphics& graphics, Keypad& keypad,
+                                     size_t count, unsigned long long cycles,
+                                     size_t& translated);
+
+template size_t arch::Jit::run(BasicCPU<WrappingAccess>& cpu, BasicMemory<WrappingAccess>& mem,
+                               BasicGraphics<WrappingAccess>& graphics, Keypad& keypad,
+                               size_t count);
+template size_t arch::Jit::run_block(BasicCPU<WrappingAccess>& cpu,
+                                     BasicMemory<WrappingAccess>& mem,
+                                     BasicGraphics<WrappingAccess>& graphics, Keypad& keypad,
+                                     size_t count, unsigned long long cycles,
+                                     size_t& translated);
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <initializer_list>
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+// Translated code never goes through BasicCPU::semantics, so builds that trace, count or time
+// every instruction there interpret everything instead
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(CHIP8_TRACE) \
+    && !defined(CHIP8_OPCODE_COUNTERS) && !defined(CHIP8_LATENCY_HISTOGRAMS)
+#  define CHIP8_JIT_AVAILABLE
+#endif
+
+namespace arch {
+  constexpr size_t jit_max_block_length = 64;    // Most instructions translated into one block
+  constexpr size_t jit_code_size = 1024 * 1024;  // Bytes of executable memory for translations
+
+  // State translated code operates on. Kept separate from CPU so that the generated code can
+  // address every field at a fixed offset from the pointer it is handed.
+  struct JitContext {
+    std::array<unsigned char, num_general_reg> general_reg;  // Offset 0
+    unsigned short index_reg;                                // Offset 16
+    unsigned short pc_reg;                                   // Offset 18
+    unsigned long long retired;  // Offset 24. Instructions executed by translated code
+  };
+
+  // Dynamic recompiler that translates guest basic blocks into x86-64 code. A block ends at a jump,
+  // a skip or at the first instruction that cannot be translated. Instructions that need the stack,
+  // the timers, the keypad, the screen or that write to memory (such as 2NNN, FX07, FX0A, DXYN and
+  // FX55) are left to the interpreter. On other platforms, and in builds that need every
+  // instruction to go through the interpreter such as CHIP8_TRACE, CHIP8_OPCODE_COUNTERS and
+  // CHIP8_LATENCY_HISTOGRAMS, every instruction is interpreted.
+  // Translations only touch registers, so one Jit serves CPUs of either bounds policy.
+  class Jit {
+  public:
+    Jit();
+
+    ~Jit();
+
+    // Owns executable memory so should not be cloned
+    Jit(const Jit&) = delete;
+
+    Jit& operator=(const Jit&) = delete;
+
+    // Runs count instructions starting at the program counter of cpu and returns how many were
+    // executed by translated code. Blocks are only entered when they fit in the remaining count so
+    // that exactly count instructions are executed. updated_screen is set if any instruction
+    // updated the screen. Stops early if an interpreted instruction traps, see CPU::trap. The VIP
+    // machine cycles of every instruction are added to guest_cycles as count_cycles does.
+    template <class Access>
+    size_t run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem, BasicGraphics<Access>& graphics,
+               Keypad& keypad, size_t count);
+
+    // Runs the single block at the program counter of cpu if it fits in both count instructions and
+    // cycles VIP machine cycles, otherwise interprets one instruction. Returns how many instructions
+    // were executed, and sets translated to how many of them were executed by translated code.
+    // Their machine cycles are added to guest_cycles. Does nothing while cpu is trapped.
+    template <class Access>
+    size_t run_block(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                     BasicGraphics<Access>& graphics, Keypad& keypad, size_t count,
+                     unsigned long long cycles, size_t& translated);
+
+    // Drops any translation that covers address. Writes made by FX33 and FX55 while running are
+    // handled automatically, this is for writes made to mem from outside of run.
+    void invalidate(unsigned short address) noexcept;
+
+    // Drops any translation written over by opcode when it was executed with the index register at
+    // index. Only FX33 and FX55 write to memory, any other opcode does nothing.
+    void invalidate_stores(unsigned short opcode, unsigned short index) noexcept;
+
+    // Drops every translation
+    void flush() noexcept;
+
+    [[nodiscard]] static constexpr bool available() noexcept {
+#if defined(CHIP8_JIT_AVAILABLE)
+      return true;
+#else
+      return false;
+#endif
+    }
+
+  private:
+    using BlockFunction = void (*)(JitContext* context);
+
+    struct Block {
+      BlockFunction code;          // nullptr if no translation exists
+      unsigned short length;       // Number of guest instructions in the block
+      unsigned short last_opcode;  // Opcode of the final instruction in the block
+      bool interpret;              // First instruction cannot be translated
+      unsigned int cycles;         // VIP machine cycles of the block if it does not skip at the end
+      unsigned int skip_cycles;    // Extra machine cycles when the final instruction skips
+    };
+
+    // Executes the block at the program counter of the context, or a single instruction through
+    // cpu if there is no block that fits in count and cycles. The context must be loaded.
+    template <class Access>
+    size_t execute_block(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                         BasicGraphics<Access>& graphics, Keypad& keypad, size_t count,
+                         unsigned long long cycles, bool& screen_changed,
+                         unsigned short& last_opcode);
+
+    // Translates the block starting at address. Returns nullptr if not even the first instruction
+    // can be translated.
+    template <class Access>
+    const Block* translate(unsigned short address, const BasicMemory<Access>& mem);
+
+    void emit(std::initializer_list<unsigned char> bytes);
+
+    // Returns true if opcode was translated, false if it must be interpreted
+    bool emit_instruction(unsigned short opcode, unsigned short next_pc, bool& ends_block);
+
+    template <class Access>
+    void load_context(const BasicCPU<Access>& cpu) noexcept;
+
+    template <class Access>
+    void store_context(BasicCPU<Access>& cpu) const noexcept;
+
+    JitContext context;
+
+    // Translations indexed by starting address / 2
+    std::array<Block, decoded_slots> blocks;
+
+    // Executable memory, translations are appended to it until full
+    unsigned char* code_buffer;
+    size_t code_used;
+
+    // Code of the block being translated
+    std::vector<unsigned char> pending;
+  };
+}  // namespace arch
@@ -1,6 +1,10 @@
 #include "keypad.h"
 
-arch::Keypad::Keypad() { keys_state.fill(false); }
+arch::Keypad::Keypad() {
+  keys_state.fill(false);
+  key_pressed = false;
+  pressed_key = 0;
+}
 
 void arch::Keypad::press_key(unsigned char key_num) {
   if (key_num >= arch::keypad::num_of_keys) {
@@ -25,6 +29,6 @@ bool arch::Keypad::is_pressed(unsigned char key_num) const {
   if (key_num >= arch::keypad::num_of_keys) {
     throw arch::keypad::InvalidKey();
   } else {
-    return keys_state[key_num];
+    return is_pressed_unchecked(key_num);
   }
 }
@@ -22,6 +22,11 @@ namespace arch {
 
     [[nodiscard]] bool is_pressed(unsigned char key_num) const;
 
+    // is_pressed without the range check. key_num must be less than num_of_keys.
+    [[nodiscard]] bool is_pressed_unchecked(unsigned char key_num) const noexcept {
+      return keys_state[key_num];
+    }
+
     bool key_pressed;
 
     unsigned char pressed_key;
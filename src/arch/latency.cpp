@@ -0,0 +1,51 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+#include "opcode_spec.h"
+
+std::chrono::nanoseconds arch::LatencyHistogram::percentile(double fraction) const noexcept {
+  if (total == 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  // Rank of the latency sought, counting from 1
+  const auto rank = std::max(1ULL, static_cast<unsigned long long>(
+                                       std::ceil(fraction * static_cast<double>(total))));
+  unsigned long long seen = 0;
+  for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      return std::chrono::nanoseconds(std::min(bucket_end(bucket), max_ns));
+    }
+  }
+  return max();
+}
+
+std::string arch::latency_line(std::string_view name, const LatencyHistogram& histogram) {
+  return std::format(
+      "{0:<10} {1:>12} samples  p50 {2:>8} ns  p99 {3:>8} ns  p99.9 {4:>8} ns  max {5:>8} ns\n",
+      name, histogram.count(), histogram.percentile(0.5).count(),
+      histogram.percentile(0.99).count(), histogram.percentile(0.999).count(),
+      histogram.max().count());
+}
+
+std::string arch::handler_latency_report(const HandlerLatencies& latencies) {
+  std::vector<Op> forms;
+  for (size_t op = 0; op < num_ops; op++) {
+    if (latencies[op].count() != 0) {
+      forms.push_back(static_cast<Op>(op));
+    }
+  }
+  std::stable_sort(forms.begin(), forms.end(), [&](Op a, Op b) {
+    return latencies[static_cast<size_t>(a)].percentile(0.999)
+           > latencies[static_cast<size_t>(b)].percentile(0.999);
+  });
+
+  std::string report;
+  for (const auto op : forms) {
+    report += latency_line(form_name(op), latencies[static_cast<size_t>(op)]);
+  }
+  return report;
+}
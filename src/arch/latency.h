@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "instruction.h"
+
+namespace arch {
+  // Histogram of host latencies in nanoseconds with logarithmic buckets. Every power of two is
+  // split into sub_buckets buckets, so a percentile is never off by more than 1/8 of the
+  // value while a full range histogram stays at a few KiB and recording is a handful of
+  // instructions.
+  class LatencyHistogram {
+  public:
+    static constexpr size_t sub_bucket_bits = 3;
+    static constexpr size_t sub_buckets = size_t{1} << sub_bucket_bits;
+
+    void record(std::chrono::nanoseconds latency) noexcept {
+      const auto ns = latency.count() < 0 ? 0ULL : static_cast<unsigned long long>(latency.count());
+      buckets[bucket_of(ns)]++;
+      total++;
+      max_ns = ns > max_ns ? ns : max_ns;
+    }
+
+    // Latencies recorded
+    [[nodiscard]] unsigned long long count() const noexcept { return total; }
+
+    // Smallest latency that fraction of the recorded latencies are at or below, rounded up to the
+    // end of its bucket. Zero when nothing was recorded.
+    [[nodiscard]] std::chrono::nanoseconds percentile(double fraction) const noexcept;
+
+    [[nodiscard]] std::chrono::nanoseconds max() const noexcept {
+      return std::chrono::nanoseconds(max_ns);
+    }
+
+    // Index of the bucket holding ns. Values below sub_buckets get a bucket each.
+    static constexpr size_t bucket_of(unsigned long long ns) noexcept {
+      if (ns < sub_buckets) {
+        return static_cast<size_t>(ns);
+      }
+      const auto exponent = static_cast<size_t>(std::bit_width(ns)) - 1;
+      const auto sub_bucket = (ns >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+      return (exponent - sub_bucket_bits + 1) * sub_buckets + static_cast<size_t>(sub_bucket);
+    }
+
+    // Largest value that falls in bucket
+    static constexpr unsigned long long bucket_end(size_t bucket) noexcept {
+      if (bucket < sub_buckets) {
+        return bucket;
+      }
+      const auto shift = bucket / sub_buckets - 1;
+      const auto first = (sub_buckets + bucket % sub_buckets) << shift;
+      return first + (1ULL << shift) - 1;
+    }
+
+    // Enough for every 64 bit value
+    static constexpr size_t num_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+  private:
+    std::vector<unsigned long long> buckets = std::vector<unsigned long long>(num_buckets);
+    unsigned long long total = 0;
+    unsigned long long max_ns = 0;
+  };
+
+  // One line summary of histogram: count, p50, p99, p99.9 and max
+  [[nodiscard]] std::string latency_line(std::string_view name, const LatencyHistogram& histogram);
+
+  // Host time spent in the handler of each opcode form, indexed by Op
+  using HandlerLatencies = std::array<LatencyHistogram, num_ops>;
+
+  // latency_line of every opcode form that executed, slowest p99.9 first
+  [[nodiscard]] std::string handler_latency_report(const HandlerLatencies& latencies);
+}  // namespace arch
@@ -0,0 +1,347 @@
+#include "lockstep.h"
+
+#include <limits>
+
+#include "opcode_spec.h"
+
+namespace {
+  // Lanes from lanes up to stride never run, so every lane loop can run whole vectors
+  constexpr size_t round_up_lanes(size_t lanes) noexcept {
+    return (lanes + arch::lockstep_lane_multiple - 1) / arch::lockstep_lane_multiple
+           * arch::lockstep_lane_multiple;
+  }
+
+  template <class Access>
+  unsigned short opcode_at(const arch::BasicMemory<Access>& mem, unsigned short address) noexcept {
+    return static_cast<unsigned short>(mem.get_value_unchecked(address) << 8
+                                       | mem.get_value_unchecked(address + 1));
+  }
+}  // namespace
+
+template <class Access>
+arch::BasicLockstep<Access>::BasicLockstep(const Memory& image, size_t lanes)
+    : lane_count(lanes),
+      stride(round_up_lanes(lanes)),
+      regs(num_general_reg * stride),
+      index(stride),
+      pc(stride, pc_start_value),
+      delay(stride),
+      sound(stride),
+      remaining(stride),
+      running(stride),
+      group(stride),
+      group_wide(stride),
+      written(mem_size),
+      states(lanes, LaneState{CPU{}, image, Graphics{}, Keypad{}}) {
+  for (size_t lane = 0; lane < lane_count; lane++) {
+    running[lane] = 1;
+  }
+}
+
+template <class Access>
+void arch::BasicLockstep<Access>::run(size_t count) {
+  // Budgets are kept in 32 bits so that they fit as many lanes in a vector as the other arrays
+  constexpr size_t max_chunk = std::numeric_limits<unsigned int>::max();
+  for (; count > max_chunk; count -= max_chunk) {
+    run_chunk(static_cast<unsigned int>(max_chunk));
+  }
+  run_chunk(static_cast<unsigned int>(count));
+}
+
+template <class Access>
+void arch::BasicLockstep<Access>::run_chunk(unsigned int count) {
+  // Lane loops go through locals, which the compiler knows nothing else writes to
+  const auto n = stride;
+  const auto* pcs = pc.data();
+  auto* left = remaining.data();
+  auto* in = group.data();
+  auto* in_wide = group_wide.data();
+
+  for (size_t lane = 0; lane < n; lane++) {
+    left[lane] = running[lane] != 0 ? count : 0;
+  }
+
+  // Every lane before the first one with instructions left has finished, so the search for the
+  // next group never has to look behind it
+  for (size_t first = 0;;) {
+    while (first < lane_count && left[first] == 0) {
+      first++;
+    }
+    if (first == lane_count) {
+      return;
+    }
+
+    const auto target = pcs[first];
+    size_t members = 0;
+    for (size_t lane = 0; lane < n; lane++) {
+      const auto member = static_cast<unsigned char>(pcs[lane] == target && left[lane] != 0);
+      in[lane] = member;
+      in_wide[lane] = member;
+      members += member;
+    }
+
+    // An opcode past the end of memory traps or wraps, which the CPU takes care of
+    if (target >= max_mem_address) {
+      step_group(first);
+      continue;
+    }
+
+    const auto opcode = opcode_at(states[first].mem, target);
+    if (written[target] || written[target + 1U]) {
+      for (size_t lane = first; lane < lane_count; lane++) {
+        if (in[lane] != 0 && opcode_at(states[lane].mem, target) != opcode) {
+          in[lane] = 0;
+          in_wide[lane] = 0;
+          members--;
+        }
+      }
+    }
+
+    if (execute_group(opcode)) {
+      for (size_t lane = 0; lane < n; lane++) {
+        left[lane] -= in[lane];
+      }
+      lockstep_counters.vector_steps++;
+      lockstep_counters.vector_instructions += members;
+    } else {
+      step_group(first);
+    }
+  }
+}
+
+template <class Access>
+void arch::BasicLockstep<Access>::step_group(size_t first) noexcept {
+  for (size_t lane = first; lane < lane_count; lane++) {
+    if (group[lane] != 0) {
+      step_lane(lane);
+    }
+  }
+}
+
+template <class Access>
+void arch::BasicLockstep<Access>::tick_timers() noexcept {
+  const auto n = stride;
+  auto* delays = delay.data();
+  auto* sounds = sound.data();
+  for (size_t lane = 0; lane < n; lane++) {
+    delays[lane] = static_cast<unsigned char>(delays[lane] != 0 ? delays[lane] - 1 : 0);
+    sounds[lane] = static_cast<unsigned char>(sounds[lane] != 0 ? sounds[lane] - 1 : 0);
+  }
+}
+
+template <class Access>
+bool arch::BasicLockstep<Access>::execute_group(unsigned short opcode) noexcept {
+  const auto op = decode_op(opcode);
+  const auto x = static_cast<size_t>((opcode >> 8) & 0xF);
+  const auto y = static_cast<size_t>((opcode >> 4) & 0xF);
+  const auto nn = static_cast<unsigned char>(opcode & 0xFF);
+  const auto nnn = static_cast<unsigned short>(opcode & 0xFFF);
+
+  // Every loop below runs over all stride lanes and keeps the old value of the lanes outside the
+  // group, which compilers vectorize into compares and blends
+  const auto* in = group.data();
+  const auto* in_wide = group_wide.data();
+  auto* vx = regs.data() + x * stride;
+  const auto* vy = regs.data() + y * stride;
+  auto* vf = regs.data() + 0xF * stride;
+  auto* i_reg = index.data();
+  auto* pc_reg = pc.data();
+  auto* delays = delay.data();
+  auto* sounds = sound.data();
+  const auto n = stride;
+
+  // Flag writing forms read VX and VY before writing VF, which the CPU does not do when either of
+  // them is VF, so those are left to it
+  const auto flag_safe = x != 0xF && y != 0xF;
+
+  switch (op) {
+    case Op::op_1NNN:
+      for (size_t i = 0; i < n; i++) {
+        pc_reg[i] = in_wide[i] != 0 ? nnn : pc_reg[i];
+      }
+      return true;
+    case Op::op_3XNN:
+      for (size_t i = 0; i < n; i++) {
+        pc_reg[i] += static_cast<unsigned short>(in_wide[i] * (vx[i] == nn ? 4 : 2));
+      }
+      return true;
+    case Op::op_4XNN:
+      for (size_t i = 0; i < n; i++) {
+        pc_reg[i] += static_cast<unsigned short>(in_wide[i] * (vx[i] != nn ? 4 : 2));
+      }
+      return true;
+    case Op::op_5XY0:
+      for (size_t i = 0; i < n; i++) {
+        pc_reg[i] += static_cast<unsigned short>(in_wide[i] * (vx[i] == vy[i] ? 4 : 2));
+      }
+      return true;
+    case Op::op_9XY0:
+      for (size_t i = 0; i < n; i++) {
+        pc_reg[i] += static_cast<unsigned short>(in_wide[i] * (vx[i] != vy[i] ? 4 : 2));
+      }
+      return true;
+    case Op::op_6XNN:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? nn : vx[i];
+      }
+      break;
+    case Op::op_7XNN:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(vx[i] + nn) : vx[i];
+      }
+      break;
+    case Op::op_8XY0:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? vy[i] : vx[i];
+      }
+      break;
+    case Op::op_8XY1:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(vx[i] | vy[i]) : vx[i];
+      }
+      break;
+    case Op::op_8XY2:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(vx[i] & vy[i]) : vx[i];
+      }
+      break;
+    case Op::op_8XY3:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(vx[i] ^ vy[i]) : vx[i];
+      }
+      break;
+    case Op::op_8XY4:
+      if (!flag_safe) {
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        const auto a = vx[i];
+        const auto sum = static_cast<unsigned char>(a + vy[i]);
+        vf[i] = in[i] != 0 ? static_cast<unsigned char>(sum < a) : vf[i];
+        vx[i] = in[i] != 0 ? sum : a;
+      }
+      break;
+    case Op::op_8XY5:
+      if (!flag_safe) {
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        const auto a = vx[i];
+        const auto b = vy[i];
+        vf[i] = in[i] != 0 ? static_cast<unsigned char>(a >= b) : vf[i];
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(a - b) : a;
+      }
+      break;
+    case Op::op_8XY6:
+      if (!flag_safe) {
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        const auto b = vy[i];
+        vf[i] = in[i] != 0 ? static_cast<unsigned char>(b & 1) : vf[i];
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(b >> 1) : vx[i];
+      }
+      break;
+    case Op::op_8XY7:
+      if (!flag_safe) {
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        const auto a = vx[i];
+        const auto b = vy[i];
+        vf[i] = in[i] != 0 ? static_cast<unsigned char>(b >= a) : vf[i];
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(b - a) : a;
+      }
+      break;
+    case Op::op_8XYE:
+      if (!flag_safe) {
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        const auto b = vy[i];
+        vf[i] = in[i] != 0 ? static_cast<unsigned char>(b >> 7) : vf[i];
+        vx[i] = in[i] != 0 ? static_cast<unsigned char>(b << 1) : vx[i];
+      }
+      break;
+    case Op::op_ANNN:
+      for (size_t i = 0; i < n; i++) {
+        i_reg[i] = in_wide[i] != 0 ? nnn : i_reg[i];
+      }
+      break;
+    case Op::op_FX07:
+      for (size_t i = 0; i < n; i++) {
+        vx[i] = in[i] != 0 ? delays[i] : vx[i];
+      }
+      break;
+    case Op::op_FX15:
+      for (size_t i = 0; i < n; i++) {
+        delays[i] = in[i] != 0 ? vx[i] : delays[i];
+      }
+      break;
+    case Op::op_FX18:
+      for (size_t i = 0; i < n; i++) {
+        sounds[i] = in[i] != 0 ? vx[i] : sounds[i];
+      }
+      break;
+    case Op::op_FX1E:
+      for (size_t i = 0; i < n; i++) {
+        i_reg[i] = in_wide[i] != 0 ? static_cast<unsigned short>(i_reg[i] + vx[i]) : i_reg[i];
+      }
+      break;
+    case Op::op_FX29:
+      for (size_t i = 0; i < n; i++) {
+        i_reg[i] = in_wide[i] != 0 ? static_cast<unsigned short>((vx[i] & 0xF) * 5) : i_reg[i];
+      }
+      break;
+    default:
+      return false;
+  }
+
+  // Past the instruction, which the jump and the skips above did themselves
+  for (size_t i = 0; i < n; i++) {
+    pc_reg[i] += static_cast<unsigned short>(in_wide[i] * 2);
+  }
+  return true;
+}
+
+template <class Access>
+void arch::BasicLockstep<Access>::step_lane(size_t lane) noexcept {
+  auto& state = states[lane];
+  auto& cpu = state.cpu;
+  for (size_t reg = 0; reg < num_general_reg; reg++) {
+    cpu.general_reg[reg] = regs[reg * stride + lane];
+  }
+  cpu.index_reg = index[lane];
+  cpu.pc_reg = pc[lane];
+  cpu.delay_timer_reg = delay[lane];
+  cpu.sound_timer_reg = sound[lane];
+
+  cpu.try_step(state.mem, state.graphics, state.keypad);
+
+  // FX33 and FX55 are the only instructions that write memory, from I onwards
+  const auto op = decode_op(cpu.curr_opcode);
+  if (op == Op::op_FX33 || op == Op::op_FX55) {
+    const auto last = op == Op::op_FX33 ? 2U : (cpu.curr_opcode >> 8) & 0xFU;
+    for (size_t offset = 0; offset <= last; offset++) {
+      written[(index[lane] + offset) & max_mem_address] = true;
+    }
+  }
+
+  for (size_t reg = 0; reg < num_general_reg; reg++) {
+    regs[reg * stride + lane] = cpu.general_reg[reg];
+  }
+  index[lane] = cpu.index_reg;
+  pc[lane] = cpu.pc_reg;
+  delay[lane] = cpu.delay_timer_reg;
+  sound[lane] = cpu.sound_timer_reg;
+
+  lockstep_counters.scalar_instructions++;
+  remaining[lane]--;
+  if (cpu.trapped()) {
+    running[lane] = 0;
+    remaining[lane] = 0;
+  }
+}
+
+template class arch::BasicLockstep<arch::CheckedAccess>;
+template class arch::BasicLockstep<arch::WrappingAccess>;
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+#include "trap.h"
+
+namespace arch {
+  // Lanes are stored in multiples of this, the number of byte lanes in an AVX2 register, so that
+  // every lane loop runs whole vectors. Lanes past the requested count never run.
+  constexpr size_t lockstep_lane_multiple = 32;
+
+  // What BasicLockstep::run did
+  struct LockstepCounters {
+    unsigned long long vector_steps;         // Instructions issued to a group of lanes at once
+    unsigned long long vector_instructions;  // Lane instructions those steps executed
+    unsigned long long scalar_instructions;  // Lane instructions stepped one lane at a time
+  };
+
+  // Many copies of one machine run in lockstep, for workloads that run hundreds of instances of
+  // the same ROM. V0 to VF, I, the program counter and both timers are kept in structure of arrays
+  // layout, one array per register across every lane.
+  //
+  // Each step takes the lanes that share the program counter and opcode of the first lane that
+  // still has instructions to run. If the opcode only touches those registers it is executed for
+  // the whole group at once, by loops over the lane arrays that mask out every other lane and that
+  // compilers turn into SSE or AVX2 code. Everything else (the screen, memory, the keypad, the
+  // stack and CXNN) is stepped one lane at a time through a BasicCPU that holds the rest of the
+  // state of the lane, so lanes that diverge keep running exactly as they would on their own. The
+  // more lanes share a program counter and the wider the vectors, the more instructions a step
+  // covers.
+  //
+  // Guest time is counted in instructions, see Timing::instructions. Instructions executed as a
+  // group bypass CPU::semantics, so they are not counted, timed or traced.
+  template <class Access>
+  class BasicLockstep {
+  public:
+    using CPU = BasicCPU<Access>;
+    using Memory = BasicMemory<Access>;
+    using Graphics = BasicGraphics<Access>;
+
+    // lanes machines, each booted with a copy of image as memory
+    BasicLockstep(const Memory& image, size_t lanes);
+
+    [[nodiscard]] size_t lanes() const noexcept { return lane_count; }
+
+    // Runs count instructions on every lane. A lane that traps stops there, see trap.
+    void run(size_t count);
+
+    // Decrements the delay and sound timers of every lane once, as the 60 Hz timer tick does
+    void tick_timers() noexcept;
+
+    [[nodiscard]] unsigned char general_reg(size_t lane, size_t reg) const noexcept {
+      return regs[reg * stride + lane];
+    }
+
+    [[nodiscard]] unsigned short index_reg(size_t lane) const noexcept { return index[lane]; }
+
+    [[nodiscard]] unsigned short pc_reg(size_t lane) const noexcept { return pc[lane]; }
+
+    [[nodiscard]] unsigned char delay_timer(size_t lane) const noexcept { return delay[lane]; }
+
+    [[nodiscard]] unsigned char sound_timer(size_t lane) const noexcept { return sound[lane]; }
+
+    // The fault that stopped lane, Fault::none while it is running
+    [[nodiscard]] const Trap& trap(size_t lane) const noexcept { return states[lane].cpu.trap(); }
+
+    // True while FX0A on lane is waiting for a key press
+    [[nodiscard]] bool waiting_for_key(size_t lane) const noexcept {
+      return states[lane].cpu.waiting_for_key;
+    }
+
+    [[nodiscard]] const Memory& memory(size_t lane) const noexcept { return states[lane].mem; }
+
+    [[nodiscard]] const Graphics& graphics(size_t lane) const noexcept {
+      return states[lane].graphics;
+    }
+
+    // Keys of lane, which its EX9E, EXA1 and FX0A read
+    [[nodiscard]] Keypad& keypad(size_t lane) noexcept { return states[lane].keypad; }
+
+    // Restarts the random numbers CXNN draws on lane from seed, see CPU::seed_rng. Every lane
+    // starts with the same numbers.
+    void seed_rng(size_t lane, unsigned int seed) { states[lane].cpu.seed_rng(seed); }
+
+    [[nodiscard]] const LockstepCounters& counters() const noexcept { return lockstep_counters; }
+
+  private:
+    // Everything of a lane that is not kept in the lane arrays
+    struct LaneState {
+      CPU cpu;  // Stack, random numbers, trap and FX0A state. Its registers are only valid while
+                // the lane is stepped on its own.
+      Memory mem;
+      Graphics graphics;
+      Keypad keypad;
+    };
+
+    // Runs count instructions on every lane that has not trapped
+    void run_chunk(unsigned int count);
+
+    // Steps every lane of group from first onwards through step_lane
+    void step_group(size_t first) noexcept;
+
+    // Executes opcode for every lane in group and returns true, or returns false without doing
+    // anything if it needs more than the lane arrays
+    bool execute_group(unsigned short opcode) noexcept;
+
+    // Executes the next instruction of lane through its CPU
+    void step_lane(size_t lane) noexcept;
+
+    size_t lane_count;
+    size_t stride;  // lane_count rounded up to lockstep_lane_multiple
+
+    // Lane arrays, stride entries each. V0 to VF are one array after another.
+    std::vector<unsigned char> regs;
+    std::vector<unsigned short> index;
+    std::vector<unsigned short> pc;
+    std::vector<unsigned char> delay;
+    std::vector<unsigned char> sound;
+
+    std::vector<unsigned int> remaining;  // Instructions left to run in the current run
+    std::vector<unsigned char> running;   // 1 until the lane traps, 0 for padding lanes
+
+    // Lanes taking part in the current step, as 0 or 1 in the width of the arrays they mask
+    std::vector<unsigned char> group;
+    std::vector<unsigned short> group_wide;
+
+    // Addresses any lane has written to. Opcodes at other addresses are the same in every lane, so
+    // a group only needs its opcode compared lane by lane where code may have been overwritten.
+    std::vector<bool> written;
+
+    std::vector<LaneState> states;
+
+    LockstepCounters lockstep_counters{};
+  };
+
+  using Lockstep = BasicLockstep<CheckedAccess>;
+}  // namespace arch
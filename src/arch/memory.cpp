@@ -1,17 +1,32 @@
 #include "memory.h"
 
-unsigned char arch::Memory::get_value(unsigned short address) const {
-  if (address > max_mem_address) {
-    throw InvalidMemoryAddress();
-  } else {
-    return mem[address];
+template <class Access>
+unsigned char arch::BasicMemory<Access>::get_value(unsigned short address) const {
+  return mem[Access::template index<InvalidMemoryAddress>(address, mem_size)];
+}
+
+template <class Access>
+void arch::BasicMemory<Access>::set_value(unsigned short address, unsigned char value) {
+  set_value_unchecked(
+      static_cast<unsigned short>(Access::template index<InvalidMemoryAddress>(address, mem_size)),
+      value);
+}
+
+template <class Access>
+void arch::BasicMemory<Access>::set_decoded(unsigned short address,
+                                            const Instruction& instruction) noexcept {
+  if (address <= max_mem_address && (address & 0x1) == 0) {
+    decoded[address >> 1] = instruction;
   }
 }
 
-void arch::Memory::set_value(unsigned short address, unsigned char value) {
-  if (address > max_mem_address) {
-    throw InvalidMemoryAddress();
-  } else {
-    mem[address] = value;
+template <class Access>
+void arch::BasicMemory<Access>::set_fused(unsigned short address,
+                                          const FusedInstruction& fused_instruction) noexcept {
+  if (address <= max_mem_address && (address & 0x1) == 0) {
+    fused[address >> 1] = fused_instruction;
   }
-}
\ No newline at end of file
+}
+
+template class arch::BasicMemory<arch::CheckedAccess>;
+template class arch::BasicMemory<arch::WrappingAccess>;
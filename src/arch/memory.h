@@ -5,28 +5,109 @@
 #include <stdexcept>
 #include <string>
 
+#include "access.h"
+#include "instruction.h"
+
 namespace arch {
   constexpr size_t mem_size = 4096;                 // Total RAM size in bytes
   constexpr size_t max_mem_address = mem_size - 1;  // Max address value
+  constexpr size_t decoded_slots = mem_size / 2;    // Number of 2 byte aligned instruction slots
+
+  class InvalidMemoryAddress : public std::exception {
+  public:
+    virtual const char* what() const noexcept {
+      // Formatted once rather than every time one is thrown
+      static const std::string what_msg
+          = std::format("Invalid address given. Must be between 0 and {0}", max_mem_address);
+      return what_msg.c_str();
+    }
+  };
 
-  class Memory {
+  // RAM of the machine. Access decides what get_value and set_value do with an address past
+  // max_mem_address, see CheckedAccess and WrappingAccess.
+  template <class Access>
+  class BasicMemory {
   public:
-    Memory() = default;
+    using Instruction = BasicInstruction<Access>;
+
+    BasicMemory() = default;
 
     [[nodiscard]] unsigned char get_value(unsigned short address) const;
 
     void set_value(unsigned short address, unsigned char value);
 
+    // Versions of get_value and set_value for the CPU core, which checks its addresses once per
+    // instruction and reports a bad one as a trap instead of throwing. address must be at most
+    // max_mem_address unless Access wraps, in which case it is wrapped without a check.
+
+    [[nodiscard]] unsigned char get_value_unchecked(unsigned short address) const noexcept {
+      return mem[wrap(address)];
+    }
+
+    void set_value_unchecked(unsigned short address, unsigned char value) noexcept {
+      const auto index = wrap(address);
+      mem[index] = value;
+      // The byte may have been part of code, drop the stale decoding
+      decoded[index >> 1].handler = nullptr;
+
+      // Any sequence starting up to max_fused_length - 1 slots earlier may include the byte
+      const size_t last_slot = index >> 1;
+      const size_t first_slot
+          = last_slot >= max_fused_length ? last_slot - max_fused_length + 1 : 0;
+      for (auto slot = first_slot; slot <= last_slot; slot++) {
+        fused[slot].kind = Fusion::pending;
+      }
+    }
+
+    // Predecoded instruction cache. Only even addresses are cached as that is where instructions
+    // are normally aligned. Any write through set_value invalidates the slot that the written byte
+    // belongs to, so a cached instruction always matches the bytes currently in memory.
+
+    // Returns the cached instruction at address or nullptr if the address is odd, out of range or
+    // has not been decoded since it was last written to.
+    [[nodiscard]] const Instruction* get_decoded(unsigned short address) const noexcept {
+      if (address > max_mem_address || (address & 0x1) != 0) {
+        return nullptr;
+      }
+      const auto& slot = decoded[address >> 1];
+      return slot.handler == nullptr ? nullptr : &slot;
+    }
+
+    // Caches instruction for address. Odd or out of range addresses are ignored.
+    void set_decoded(unsigned short address, const Instruction& instruction) noexcept;
+
+    // Superinstruction cache, kept the same way as the predecoded cache. A write through set_value
+    // resets every slot whose sequence could cover the written byte back to Fusion::pending.
+
+    // Returns the superinstruction at address or nullptr if the address is odd or out of range
+    [[nodiscard]] const FusedInstruction* get_fused(unsigned short address) const noexcept {
+      if (address > max_mem_address || (address & 0x1) != 0) {
+        return nullptr;
+      }
+      return &fused[address >> 1];
+    }
+
+    // Caches fused_instruction for address. Odd or out of range addresses are ignored.
+    void set_fused(unsigned short address, const FusedInstruction& fused_instruction) noexcept;
+
   private:
+    static constexpr size_t wrap(unsigned short address) noexcept {
+      if constexpr (Access::wraps) {
+        return Access::template index<InvalidMemoryAddress>(address, mem_size);
+      } else {
+        return address;
+      }
+    }
+
     // Each index holds one byte of data for a total of 4KB RAM size
-    std::array<unsigned char, mem_size> mem;
-  };
+    std::array<unsigned char, mem_size> mem{};
 
-  class InvalidMemoryAddress : public std::exception {
-    std::string what_msg
-        = std::format("Invalid address given. Must be between 0 and {0}", max_mem_address);
+    // Each index holds the decoded instruction starting at address index * 2
+    std::array<Instruction, decoded_slots> decoded{};
 
-  public:
-    virtual const char* what() const noexcept { return what_msg.c_str(); }
+    // Each index holds the superinstruction starting at address index * 2
+    std::array<FusedInstruction, decoded_slots> fused{};
   };
+
+  using Memory = BasicMemory<CheckedAccess>;
 }  // namespace arch
@@ -0,0 +1,151 @@
+#include "opcode_spec.h"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+#include "cpu.h"
+
+namespace {
+  const arch::OpcodeSpec* find_spec(unsigned short opcode) noexcept {
+    const auto op = arch::decode_op(opcode);
+    return op == arch::Op::op_invalid ? nullptr : &arch::opcode_specs[static_cast<size_t>(op)];
+  }
+
+  // Expands the operand syntax of spec with the fields of opcode
+  std::string format_operands(const arch::OpcodeSpec& spec, unsigned short opcode) {
+    std::string out;
+    const auto operands = spec.operands;
+    for (size_t i = 0; i < operands.size(); i++) {
+      if (operands.substr(i, 3) == "nnn") {
+        out += std::format("0x{0:03X}", opcode & 0x0FFF);
+        i += 2;
+      } else if (operands.substr(i, 2) == "nn") {
+        out += std::format("0x{0:02X}", opcode & 0x00FF);
+        i += 1;
+      } else if (operands[i] == 'n') {
+        out += std::format("0x{0:X}", opcode & 0x000F);
+      } else if (operands[i] == 'x') {
+        out += std::format("{0:X}", (opcode & 0x0F00) >> 8);
+      } else if (operands[i] == 'y') {
+        out += std::format("{0:X}", (opcode & 0x00F0) >> 4);
+      } else {
+        out += operands[i];
+      }
+    }
+    return out;
+  }
+
+  double percent(unsigned long long part, unsigned long long whole) noexcept {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+  }
+}  // namespace
+
+std::string arch::form_name(Op op) {
+  if (op == Op::op_invalid) {
+    return "invalid";
+  }
+  const auto& spec = opcode_specs[static_cast<size_t>(op)];
+  std::string name;
+  for (auto shift = 12; shift >= 0; shift -= 4) {
+    if ((spec.mask >> shift & 0xF) != 0) {
+      name += std::format("{0:X}", spec.pattern >> shift & 0xF);
+    } else if (shift == 8 && (spec.fields & field_x) != 0) {
+      name += 'X';
+    } else if (shift == 4 && (spec.fields & field_y) != 0) {
+      name += 'Y';
+    } else {
+      name += 'N';
+    }
+  }
+  return name;
+}
+
+std::string arch::disassemble(unsigned short opcode) {
+  const auto* spec = find_spec(opcode);
+  if (spec == nullptr) {
+    return std::format("DW 0x{0:04X}", opcode);
+  }
+  if (spec->operands.empty()) {
+    return std::string(spec->mnemonic);
+  }
+  return std::format("{0} {1}", spec->mnemonic, format_operands(*spec, opcode));
+}
+
+std::string arch::opcode_report(const OpcodeCounters& counters) {
+  unsigned long long total = 0;
+  std::vector<Op> forms;
+  for (size_t op = 0; op < num_ops; op++) {
+    total += counters.forms[op];
+    if (counters.forms[op] != 0) {
+      forms.push_back(static_cast<Op>(op));
+    }
+  }
+  std::stable_sort(forms.begin(), forms.end(), [&](Op a, Op b) {
+    return counters.forms[static_cast<size_t>(a)] > counters.forms[static_cast<size_t>(b)];
+  });
+
+  auto report = std::format("{0} instructions\n\nOpcode forms:\n", total);
+  for (const auto op : forms) {
+    const auto count = counters.forms[static_cast<size_t>(op)];
+    report += std::format("  {0:<8} {1:>14} {2:>7.2f}%\n", form_name(op), count,
+                          percent(count, total));
+  }
+
+  report += "\nSkips:\n";
+  for (const auto op : forms) {
+    if (!is_skip(op)) {
+      continue;
+    }
+    const auto count = counters.forms[static_cast<size_t>(op)];
+    const auto taken = counters.skips_taken[static_cast<size_t>(op)];
+    report += std::format("  {0:<8} {1:>14} taken {2:>14} not taken {3:>7.2f}% taken\n",
+                          form_name(op), taken, count - taken, percent(taken, count));
+  }
+
+  std::vector<unsigned short> opcodes;
+  for (size_t opcode = 0; opcode < counters.opcodes.size(); opcode++) {
+    if (counters.opcodes[opcode] != 0) {
+      opcodes.push_back(static_cast<unsigned short>(opcode));
+    }
+  }
+  std::stable_sort(opcodes.begin(), opcodes.end(), [&](unsigned short a, unsigned short b) {
+    return counters.opcodes[a] > counters.opcodes[b];
+  });
+
+  report += "\nOpcodes:\n";
+  for (const auto opcode : opcodes) {
+    report += std::format("  {0:04X}  {1:<16} {2:>14} {3:>7.2f}%\n", opcode, disassemble(opcode),
+                          counters.opcodes[opcode], percent(counters.opcodes[opcode], total));
+  }
+  return report;
+}
+
+template <class Access>
+std::string arch::trace_line(const BasicCPU<Access>& cpu, unsigned short address,
+                             unsigned short opcode) {
+  auto line = std::format("{0:04X}  {1:04X}  {2:<16}", address, opcode, disassemble(opcode));
+
+  const auto* spec = find_spec(opcode);
+  const auto fields = spec == nullptr ? 0 : spec->fields;
+  if ((fields & field_x) != 0) {
+    const auto x = (opcode & 0x0F00) >> 8;
+    line += std::format(" V{0:X}={1:02X}", x, cpu.get_general_reg(x));
+  }
+  if ((fields & field_y) != 0) {
+    const auto y = (opcode & 0x00F0) >> 4;
+    line += std::format(" V{0:X}={1:02X}", y, cpu.get_general_reg(y));
+  }
+  if ((fields & field_i) != 0) {
+    line += std::format(" I={0:03X}", cpu.index_reg);
+  }
+
+  // Drop the padding of instructions without register operands
+  line.erase(line.find_last_not_of(' ') + 1);
+  return line;
+}
+
+template std::string arch::trace_line(const CPU& cpu, unsigned short address,
+                                      unsigned short opcode);
+template std::string arch::trace_line(const BasicCPU<WrappingAccess>& cpu, unsigned short address,
+                                      unsigned short opcode);
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "instruction.h"
+
+namespace arch {
+  // Operand fields of an opcode form, combined with |
+  enum OperandField : unsigned char {
+    field_x = 1 << 0,    // Register X
+    field_y = 1 << 1,    // Register Y
+    field_n = 1 << 2,    // Lowest nibble
+    field_nn = 1 << 3,   // Lowest byte
+    field_nnn = 1 << 4,  // Address
+    field_i = 1 << 5,    // Not encoded, the form reads or writes the index register
+  };
+
+  // Declarative description of an opcode form. The opcode table below is the single source that
+  // decoding, the handler table, the disassembler and the tracer are generated from, the
+  // semantics being the handler bound to op, see BasicCPU::semantics.
+  struct OpcodeSpec {
+    Op op;
+    unsigned short pattern;     // An opcode is of this form if opcode & mask equals pattern
+    unsigned short mask;        // Bits that identify the form
+    unsigned char fields;       // OperandField values the form uses
+    std::string_view mnemonic;  // Assembly mnemonic
+
+    // Operand syntax. x and y are replaced with the register number and n, nn and nnn with the
+    // field value, everything else is copied as is.
+    std::string_view operands;
+  };
+
+  // Every valid opcode form, in the same order as Op. Op::op_invalid has no entry, it is whatever
+  // matches none of them.
+  inline constexpr std::array<OpcodeSpec, num_ops - 1> opcode_specs{{
+      {Op::op_00E0, 0x00E0, 0xFFFF, 0, "CLS", ""},
+      {Op::op_00EE, 0x00EE, 0xFFFF, 0, "RET", ""},
+      {Op::op_1NNN, 0x1000, 0xF000, field_nnn, "JP", "nnn"},
+      {Op::op_2NNN, 0x2000, 0xF000, field_nnn, "CALL", "nnn"},
+      {Op::op_3XNN, 0x3000, 0xF000, field_x | field_nn, "SE", "Vx, nn"},
+      {Op::op_4XNN, 0x4000, 0xF000, field_x | field_nn, "SNE", "Vx, nn"},
+      {Op::op_5XY0, 0x5000, 0xF00F, field_x | field_y, "SE", "Vx, Vy"},
+      {Op::op_6XNN, 0x6000, 0xF000, field_x | field_nn, "LD", "Vx, nn"},
+      {Op::op_7XNN, 0x7000, 0xF000, field_x | field_nn, "ADD", "Vx, nn"},
+      {Op::op_8XY0, 0x8000, 0xF00F, field_x | field_y, "LD", "Vx, Vy"},
+      {Op::op_8XY1, 0x8001, 0xF00F, field_x | field_y, "OR", "Vx, Vy"},
+      {Op::op_8XY2, 0x8002, 0xF00F, field_x | field_y, "AND", "Vx, Vy"},
+      {Op::op_8XY3, 0x8003, 0xF00F, field_x | field_y, "XOR", "Vx, Vy"},
+      {Op::op_8XY4, 0x8004, 0xF00F, field_x | field_y, "ADD", "Vx, Vy"},
+      {Op::op_8XY5, 0x8005, 0xF00F, field_x | field_y, "SUB", "Vx, Vy"},
+      {Op::op_8XY6, 0x8006, 0xF00F, field_x | field_y, "SHR", "Vx, Vy"},
+      {Op::op_8XY7, 0x8007, 0xF00F, field_x | field_y, "SUBN", "Vx, Vy"},
+      {Op::op_8XYE, 0x800E, 0xF00F, field_x | field_y, "SHL", "Vx, Vy"},
+      {Op::op_9XY0, 0x9000, 0xF00F, field_x | field_y, "SNE", "Vx, Vy"},
+      {Op::op_ANNN, 0xA000, 0xF000, field_nnn | field_i, "LD", "I, nnn"},
+      {Op::op_BNNN, 0xB000, 0xF000, field_nnn, "JP", "V0, nnn"},
+      {Op::op_CXNN, 0xC000, 0xF000, field_x | field_nn, "RND", "Vx, nn"},
+      {Op::op_DXYN, 0xD000, 0xF000, field_x | field_y | field_n | field_i, "DRW", "Vx, Vy, n"},
+      {Op::op_EX9E, 0xE09E, 0xF0FF, field_x, "SKP", "Vx"},
+      {Op::op_EXA1, 0xE0A1, 0xF0FF, field_x, "SKNP", "Vx"},
+      {Op::op_FX07, 0xF007, 0xF0FF, field_x, "LD", "Vx, DT"},
+      {Op::op_FX0A, 0xF00A, 0xF0FF, field_x, "LD", "Vx, K"},
+      {Op::op_FX15, 0xF015, 0xF0FF, field_x, "LD", "DT, Vx"},
+      {Op::op_FX18, 0xF018, 0xF0FF, field_x, "LD", "ST, Vx"},
+      {Op::op_FX1E, 0xF01E, 0xF0FF, field_x | field_i, "ADD", "I, Vx"},
+      {Op::op_FX29, 0xF029, 0xF0FF, field_x | field_i, "LD", "F, Vx"},
+      {Op::op_FX33, 0xF033, 0xF0FF, field_x | field_i, "LD", "B, Vx"},
+      {Op::op_FX55, 0xF055, 0xF0FF, field_x | field_i, "LD", "[I], Vx"},
+      {Op::op_FX65, 0xF065, 0xF0FF, field_x | field_i, "LD", "Vx, [I]"},
+  }};
+
+  // True if no opcode matches more than one form. Two forms overlap when their patterns agree on
+  // every bit both masks identify.
+  constexpr bool opcode_specs_disjoint() noexcept {
+    for (size_t i = 0; i < opcode_specs.size(); i++) {
+      for (size_t j = i + 1; j < opcode_specs.size(); j++) {
+        const auto shared = opcode_specs[i].mask & opcode_specs[j].mask;
+        if (((opcode_specs[i].pattern ^ opcode_specs[j].pattern) & shared) == 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  constexpr bool opcode_specs_ordered() noexcept {
+    for (size_t i = 0; i < opcode_specs.size(); i++) {
+      if (static_cast<size_t>(opcode_specs[i].op) != i
+          || (opcode_specs[i].pattern & ~opcode_specs[i].mask) != 0
+          || (i > 0 && opcode_specs[i].pattern >> 12 < opcode_specs[i - 1].pattern >> 12)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static_assert(opcode_specs_disjoint(), "Opcode forms must not overlap");
+  static_assert(opcode_specs_ordered(), "Opcode forms must be in Op order and grouped by nibble");
+
+  // Entries of opcode_specs whose pattern has the highest nibble of the index, as [first, last)
+  struct OpcodeSpecRange {
+    unsigned char first;
+    unsigned char last;
+  };
+
+  constexpr std::array<OpcodeSpecRange, 16> make_opcode_spec_ranges() noexcept {
+    std::array<OpcodeSpecRange, 16> ranges{};
+    for (size_t nibble = 0; nibble < ranges.size(); nibble++) {
+      auto first = opcode_specs.size();
+      auto last = opcode_specs.size();
+      for (size_t i = 0; i < opcode_specs.size(); i++) {
+        if (static_cast<size_t>(opcode_specs[i].pattern >> 12) == nibble) {
+          first = first == opcode_specs.size() ? i : first;
+          last = i + 1;
+        }
+      }
+      ranges[nibble] = {static_cast<unsigned char>(first), static_cast<unsigned char>(last)};
+    }
+    return ranges;
+  }
+
+  inline constexpr std::array<OpcodeSpecRange, 16> opcode_spec_ranges = make_opcode_spec_ranges();
+
+  // Finds the opcode form of opcode by matching it against the forms sharing its highest nibble
+  constexpr Op decode_op(unsigned short opcode) noexcept {
+    const auto range = opcode_spec_ranges[opcode >> 12];
+    for (auto i = range.first; i < range.last; i++) {
+      if ((opcode & opcode_specs[i].mask) == opcode_specs[i].pattern) {
+        return opcode_specs[i].op;
+      }
+    }
+    return Op::op_invalid;
+  }
+
+  // Form of op as it is usually written, such as "8XY4". Nibbles the form identifies are digits, the
+  // rest are named after the operand field they hold. Op::op_invalid is "invalid".
+  [[nodiscard]] std::string form_name(Op op);
+
+  // Assembly for opcode in the usual CHIP-8 syntax, such as "ADD V0, V1". Invalid opcodes come back
+  // as a DW directive holding the raw opcode.
+  [[nodiscard]] std::string disassemble(unsigned short opcode);
+
+  // One line of an execution trace: address, raw opcode, disassembly and the value of every
+  // register the opcode form reads or writes, taken from cpu. Meant to be called before the
+  // instruction at address executes.
+  template <class Access>
+  [[nodiscard]] std::string trace_line(const BasicCPU<Access>& cpu, unsigned short address,
+                                       unsigned short opcode);
+}  // namespace arch
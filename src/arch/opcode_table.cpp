@@ -0,0 +1,47 @@
+#include "cpu.h"
+#include "cpu_handlers.h"
+
+// Only built with the CHIP8_OPCODE_TABLE option. Instantiates op_fixed for each of the valid
+// opcodes and each bounds policy, which takes a few minutes to compile and adds a few megabytes of
+// code.
+
+namespace {
+  // Shared by every table entry as they take their operands from the template argument instead
+  template <class Access>
+  const arch::BasicInstruction<Access> unused_instruction{};
+}  // namespace
+
+template <class Access>
+template <unsigned short Opcode>
+constexpr arch::InstructionHandler<Access> arch::BasicCPU<Access>::opcode_table_entry() {
+  // Invalid encodings all share one handler rather than each getting an instantiation
+  if constexpr (decode_op(Opcode) == Op::op_invalid) {
+    return &op_invalid<Instruction>;
+  } else {
+    return &op_fixed<Opcode>;
+  }
+}
+
+template <class Access>
+template <size_t... Opcodes>
+constexpr std::array<arch::InstructionHandler<Access>, sizeof...(Opcodes)>
+arch::BasicCPU<Access>::make_opcode_table(std::index_sequence<Opcodes...>) {
+  return {opcode_table_entry<static_cast<unsigned short>(Opcodes)>()...};
+}
+
+template <class Access>
+const std::array<arch::InstructionHandler<Access>, 0x10000> arch::BasicCPU<Access>::opcode_table
+    = make_opcode_table(std::make_index_sequence<0x10000>{});
+
+template <class Access>
+void arch::BasicCPU<Access>::execute_opcode_table(Memory& mem, Graphics& graphics,
+                                                  Keypad& keypad) noexcept {
+  updated_screen = false;
+  opcode_table[curr_opcode](*this, unused_instruction<Access>, mem, graphics, keypad);
+}
+
+template void arch::CPU::execute_opcode_table(Memory& mem, Graphics& graphics,
+                                              Keypad& keypad) noexcept;
+template void arch::BasicCPU<arch::WrappingAccess>::execute_opcode_table(
+    BasicMemory<WrappingAccess>& mem, BasicGraphics<WrappingAccess>& graphics,
+    Keypad& keypad) noexcept;
@@ -0,0 +1,118 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <format>
+
+#include "cpu.h"
+#include "opcode_spec.h"
+
+namespace {
+  template <class Access>
+  unsigned short opcode_at(const arch::BasicMemory<Access>& mem, size_t address) noexcept {
+    const auto left_most = static_cast<unsigned>(mem.get_value_unchecked(address));
+    const auto right_most
+        = static_cast<unsigned>(mem.get_value_unchecked((address + 1) & arch::max_mem_address));
+    return static_cast<unsigned short>(left_most << 8 | right_most);
+  }
+
+  // Forms after which execution does not simply continue with the next instruction
+  constexpr bool ends_block(arch::Op op) noexcept {
+    return op == arch::Op::op_00EE || op == arch::Op::op_1NNN || op == arch::Op::op_2NNN
+           || op == arch::Op::op_BNNN || arch::is_skip(op);
+  }
+
+  double percent(unsigned long long part, unsigned long long whole) noexcept {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+  }
+}  // namespace
+
+void arch::Profiler::set_sample_period(unsigned int units) noexcept {
+  period = std::max(units, 1U);
+  reset();
+}
+
+void arch::Profiler::reset() noexcept {
+  pending = 0;
+  std::fill(counts.begin(), counts.end(), 0);
+  total = 0;
+}
+
+template <class Access>
+std::vector<arch::ProfileBlock> arch::profile_blocks(const Profiler& profiler,
+                                                     const BasicMemory<Access>& mem) {
+  const auto& samples = profiler.samples();
+
+  // Addresses that a profiled instruction can transfer control to
+  std::vector<bool> leaders(mem_size);
+  for (size_t address = 0; address < mem_size; address++) {
+    if (samples[address] == 0) {
+      continue;
+    }
+    const auto opcode = opcode_at(mem, address);
+    const auto op = decode_op(opcode);
+    if (op == Op::op_1NNN || op == Op::op_2NNN) {
+      leaders[opcode & 0x0FFF] = true;
+    } else if (is_skip(op)) {
+      leaders[(address + 4) & max_mem_address] = true;
+    }
+  }
+
+  std::vector<ProfileBlock> blocks;
+  auto open = false;  // The last block can still be extended
+  for (size_t address = 0; address < mem_size; address++) {
+    if (samples[address] == 0) {
+      continue;
+    }
+    if (open && !leaders[address] && address == blocks.back().last + 2U) {
+      blocks.back().last = static_cast<unsigned short>(address);
+      blocks.back().samples += samples[address];
+    } else {
+      blocks.push_back({static_cast<unsigned short>(address), static_cast<unsigned short>(address),
+                        samples[address]});
+    }
+    open = !ends_block(decode_op(opcode_at(mem, address)));
+  }
+
+  std::stable_sort(blocks.begin(), blocks.end(), [](const ProfileBlock& a, const ProfileBlock& b) {
+    return a.samples > b.samples;
+  });
+  return blocks;
+}
+
+template <class Access>
+std::string arch::profile_report(const Profiler& profiler, const BasicMemory<Access>& mem,
+                                 size_t max_blocks) {
+  const auto total = profiler.total_samples();
+  auto report
+      = profiler.sample_period() == 1
+            ? std::format("{0} units of guest time, counted exactly\n", total)
+            : std::format("{0} samples, one every {1} units of guest time\n", total,
+                          profiler.sample_period());
+
+  const auto blocks = profile_blocks(profiler, mem);
+  for (size_t i = 0; i < blocks.size() && i < max_blocks; i++) {
+    const auto& block = blocks[i];
+    report += std::format("\n{0:>7.2f}%  block {1:04X}-{2:04X}\n", percent(block.samples, total),
+                          block.first, block.last);
+    for (size_t address = block.first; address <= block.last; address += 2) {
+      const auto opcode = opcode_at(mem, address);
+      report += std::format("{0:>7.2f}%  {1:04X}  {2:04X}  {3}\n",
+                            percent(profiler.samples()[address], total), address, opcode,
+                            disassemble(opcode));
+    }
+  }
+  if (blocks.size() > max_blocks) {
+    report += std::format("\n{0} colder blocks not shown\n", blocks.size() - max_blocks);
+  }
+  return report;
+}
+
+template std::vector<arch::ProfileBlock> arch::profile_blocks(const Profiler& profiler,
+                                                              const Memory& mem);
+template std::vector<arch::ProfileBlock> arch::profile_blocks(
+    const Profiler& profiler, const BasicMemory<WrappingAccess>& mem);
+template std::string arch::profile_report(const Profiler& profiler, const Memory& mem,
+                                          size_t max_blocks);
+template std::string arch::profile_report(const Profiler& profiler,
+                                          const BasicMemory<WrappingAccess>& mem,
+                                          size_t max_blocks);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+
+namespace arch {
+  // Guest level profiler. Attributes guest time to the address of the instruction that spent it, in
+  // the units of TimerUnit: instructions, or VIP machine cycles with Timing::vip_cycles. With a
+  // sample period of 1 every unit is counted exactly, otherwise the program counter is sampled once
+  // every sample_period units, which smooths out to the same shape for long runs.
+  class Profiler {
+  public:
+    // A period of 0 counts as 1
+    explicit Profiler(unsigned int sample_period = 1) : period(std::max(sample_period, 1U)) {}
+
+    // Records that the instruction at address took time units of guest time
+    void record(unsigned short address, size_t time) noexcept {
+      pending += time;
+      if (pending >= period) {
+        const auto taken = pending / period;
+        pending -= taken * period;
+        counts[address & max_mem_address] += taken;
+        total += taken;
+      }
+    }
+
+    // Changes the units of guest time between samples, 1 for exact counts. Starts a fresh profile.
+    void set_sample_period(unsigned int units) noexcept;
+
+    [[nodiscard]] unsigned int sample_period() const noexcept { return period; }
+
+    // Drops every sample
+    void reset() noexcept;
+
+    // Samples taken at each address, indexed by address
+    [[nodiscard]] const std::vector<unsigned long long>& samples() const noexcept { return counts; }
+
+    [[nodiscard]] unsigned long long total_samples() const noexcept { return total; }
+
+  private:
+    unsigned int period;
+    size_t pending = 0;  // Units recorded since the last sample
+    std::vector<unsigned long long> counts = std::vector<unsigned long long>(mem_size);
+    unsigned long long total = 0;
+  };
+
+  // A run of profiled instructions that execute one after the other, entered only at the first and
+  // left only after the last
+  struct ProfileBlock {
+    unsigned short first;        // Address of the first instruction
+    unsigned short last;         // Address of the last instruction
+    unsigned long long samples;  // Samples of every instruction in the block
+  };
+
+  // Groups the profiled addresses of profiler into basic blocks using the code in mem, hottest
+  // first. A block ends after a jump, call, return or skip, and a new one starts at any address
+  // that a profiled jump, call or skip can land on, or that does not follow the previous profiled
+  // instruction.
+  template <class Access>
+  [[nodiscard]] std::vector<ProfileBlock> profile_blocks(const Profiler& profiler,
+                                                         const BasicMemory<Access>& mem);
+
+  // Hotspot report: the max_blocks hottest basic blocks with the share of guest time of each and
+  // of every instruction in it, disassembled from mem
+  template <class Access>
+  [[nodiscard]] std::string profile_report(const Profiler& profiler, const BasicMemory<Access>& mem,
+                                           size_t max_blocks = 20);
+}  // namespace arch
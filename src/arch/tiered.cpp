@@ -0,0 +1,177 @@
+#include "tiered.h"
+
+#include <limits>
+
+namespace {
+  // True if the instruction at address reads the delay timer or the keypad, which every idle loop
+  // starts with
+  template <class Access>
+  bool polls(const arch::BasicMemory<Access>& mem, unsigned short address) noexcept {
+    if (address >= arch::max_mem_address) {
+      return false;
+    }
+    const auto high = mem.get_value_unchecked(address) & 0xF0;
+    const auto low = mem.get_value_unchecked(static_cast<unsigned short>(address + 1));
+    return (high == 0xF0 && low == 0x07) || (high == 0xE0 && (low == 0x9E || low == 0xA1));
+  }
+}  // namespace
+
+arch::TieredEngine::TieredEngine(unsigned int hot_threshold)
+    : hot_threshold(hot_threshold), heat{}, tiers{}, tier_counters{} {}
+
+template <class Access>
+arch::Status arch::TieredEngine::run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                                     BasicGraphics<Access>& graphics, Keypad& keypad,
+                                     size_t count) {
+  auto screen_changed = false;
+  size_t executed = 0;
+
+  while (executed < count && !cpu.trapped()) {
+    executed += step(cpu, mem, graphics, keypad, count - executed,
+                     std::numeric_limits<unsigned long long>::max());
+    screen_changed = screen_changed || cpu.updated_screen;
+  }
+
+  cpu.updated_screen = screen_changed;
+  return cpu.trapped() ? Status::trapped : Status::ok;
+}
+
+template <class Access>
+size_t arch::TieredEngine::run_batch(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                                     BasicGraphics<Access>& graphics, Keypad& keypad,
+                                     const BatchLimits& limits) {
+  const auto start_cycles = cpu.guest_cycles;
+  auto screen_changed = false;
+  size_t executed = 0;
+
+  while (executed < limits.count && !cpu.trapped()) {
+    const auto spent = cpu.guest_cycles - start_cycles;
+    if (spent >= limits.cycles) {
+      break;
+    }
+
+    // Without a cycle limit the remaining budget stays unlimited, which lets step fuse
+    const auto cycles = limits.cycles == std::numeric_limits<unsigned long long>::max()
+                            ? limits.cycles
+                            : limits.cycles - spent;
+    executed += step(cpu, mem, graphics, keypad, limits.count - executed, cycles);
+
+    if (cpu.updated_screen) {
+      screen_changed = true;
+      if (limits.stop_on_draw) {
+        break;
+      }
+    }
+
+    if (cpu.waiting_for_key) {
+      break;
+    }
+
+    if (limits.stop_on_poll && (cpu.curr_opcode & 0xF000) == 0x1000 && polls(mem, cpu.pc_reg)) {
+      break;
+    }
+  }
+
+  cpu.updated_screen = screen_changed;
+  return executed;
+}
+
+template <class Access>
+size_t arch::TieredEngine::step(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                                BasicGraphics<Access>& graphics, Keypad& keypad, size_t count,
+                                unsigned long long cycles) {
+  const auto pc = cpu.pc_reg;
+  const auto tier = forced_tier.value_or(tier_of(pc));
+  const auto index_before = cpu.index_reg;
+  const auto vf = cpu.get_general_reg(0xF);
+  size_t executed = 1;
+
+  switch (tier) {
+    case Tier::interpreter:
+      if (cpu.try_fetch(mem) == Status::ok) {
+        cpu.try_decode_execute(mem, graphics, keypad);
+      }
+      cpu.count_cycles(pc, vf);
+      // Stores made outside of the JIT must still drop the translations they overwrite
+      jit.invalidate_stores(cpu.curr_opcode, index_before);
+      tier_counters.interpreter++;
+      break;
+    case Tier::predecoded:
+      // Superinstructions run whole loops at once, so they are only used without a cycle limit
+      if (cpu.dispatch == Dispatch::fused && cycles == std::numeric_limits<unsigned long long>::max()) {
+        executed = cpu.step_fused(mem, graphics, keypad, count);
+        // Nothing fused writes memory, so the slot still holds what ran unless it fell back to
+        // try_step
+        const auto* fused = mem.get_fused(pc);
+        if (fused != nullptr && fused->kind != Fusion::pending && fused->kind != Fusion::none
+            && fused->length <= count) {
+          cpu.count_fused_cycles(*fused, executed, vf);
+        } else {
+          cpu.count_cycles(pc, vf);
+        }
+      } else {
+        cpu.try_step(mem, graphics, keypad);
+        cpu.count_cycles(pc, vf);
+      }
+      jit.invalidate_stores(cpu.curr_opcode, index_before);
+      tier_counters.predecoded += executed;
+      break;
+    case Tier::translated: {
+      size_t translated = 0;
+      executed = jit.run_block(cpu, mem, graphics, keypad, count, cycles, translated);
+      // Instructions the JIT cannot translate were stepped through the predecoded cache
+      tier_counters.translated += translated;
+      tier_counters.predecoded += executed - translated;
+      break;
+    }
+  }
+
+  if (!forced_tier.has_value()) {
+    heat_up(pc, tier);
+  }
+  return executed;
+}
+
+arch::Tier arch::TieredEngine::tier_of(unsigned short address) const {
+  if (address > max_mem_address || (address & 0x1) != 0) {
+    return Tier::interpreter;
+  }
+  return tiers[address >> 1];
+}
+
+void arch::TieredEngine::reset() noexcept {
+  heat.fill(0);
+  tiers.fill(Tier::interpreter);
+  tier_counters = TierCounters{};
+  jit.flush();
+}
+
+void arch::TieredEngine::heat_up(unsigned short address, Tier tier) noexcept {
+  if (tier == Tier::translated || address > max_mem_address || (address & 0x1) != 0) {
+    return;
+  }
+
+  // Without a JIT for this platform the predecoded tier is as fast as it gets
+  if (tier == Tier::predecoded && !Jit::available()) {
+    return;
+  }
+
+  const size_t slot = address >> 1;
+  if (++heat[slot] >= hot_threshold) {
+    heat[slot] = 0;
+    tiers[slot] = tier == Tier::interpreter ? Tier::predecoded : Tier::translated;
+  }
+}
+
+template arch::Status arch::TieredEngine::run(CPU& cpu, Memory& mem, Graphics& graphics,
+                                              Keypad& keypad, size_t count);
+template arch::Status arch::TieredEngine::run(BasicCPU<WrappingAccess>& cpu,
+                                              BasicMemory<WrappingAccess>& mem,
+                                              BasicGraphics<WrappingAccess>& graphics,
+                                              Keypad& keypad, size_t count);
+template size_t arch::TieredEngine::run_batch(CPU& cpu, Memory& mem, Graphics& graphics,
+                                              Keypad& keypad, const BatchLimits& limits);
+template size_t arch::TieredEngine::run_batch(BasicCPU<WrappingAccess>& cpu,
+                                              BasicMemory<WrappingAccess>& mem,
+                                              BasicGraphics<WrappingAccess>& graphics,
+                                              Keypad& keypad, const BatchLimits& limits);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "jit.h"
+#include "keypad.h"
+#include "memory.h"
+#include "trap.h"
+
+namespace arch {
+  constexpr unsigned int default_hot_threshold = 64;  // Executions before an address is promoted
+
+  // Execution tiers from cheapest to start up to fastest once warm
+  enum class Tier : unsigned char {
+    interpreter,  // try_fetch and try_decode_execute, nothing is cached
+    predecoded,   // try_step through the predecoded cache of Memory, or step_fused when the CPU
+                  // uses Dispatch::fused and there is no cycle limit
+    translated,   // Blocks translated by Jit, falls back to try_step for what it cannot translate
+  };
+
+  // Number of instructions executed in each tier
+  struct TierCounters {
+    unsigned long long interpreter;
+    unsigned long long predecoded;
+    unsigned long long translated;
+  };
+
+  // When TieredEngine::run_batch returns. It also returns after any instruction that traps or that
+  // leaves FX0A waiting for a key.
+  struct BatchLimits {
+    size_t count;               // Most instructions to execute
+    unsigned long long cycles;  // Return once this many VIP machine cycles have been executed
+    bool stop_on_draw;          // Return after an instruction that updates the screen
+    bool stop_on_poll;          // Return after a jump to FX07, EX9E or EXA1, see detect_idle_loop
+  };
+
+  // Runs guest code starting in the plain interpreter and promotes addresses to faster tiers as
+  // they get hot. Every address starts in Tier::interpreter, moves to Tier::predecoded after
+  // hot_threshold executions and to Tier::translated after hot_threshold more, so short runs never
+  // pay for decoding or translating code that only executes a few times.
+  class TieredEngine {
+  public:
+    explicit TieredEngine(unsigned int hot_threshold = default_hot_threshold);
+
+    // Runs count instructions starting at the program counter of cpu. updated_screen is set if any
+    // of the instructions updated the screen. Stops early with Status::trapped if an instruction
+    // traps, see CPU::trap. The VIP machine cycles of every instruction are added to guest_cycles
+    // as count_cycles does.
+    template <class Access>
+    Status run(BasicCPU<Access>& cpu, BasicMemory<Access>& mem, BasicGraphics<Access>& graphics,
+               Keypad& keypad, size_t count);
+
+    // As run, but returns as soon as any of limits is reached and returns the number of
+    // instructions executed. Translated blocks are only entered when they end within the limits,
+    // so a batch ends on the same instruction it would if every instruction was stepped on its own.
+    template <class Access>
+    size_t run_batch(BasicCPU<Access>& cpu, BasicMemory<Access>& mem,
+                     BasicGraphics<Access>& graphics, Keypad& keypad, const BatchLimits& limits);
+
+    // Tier the instruction at address currently executes in, ignoring forced_tier
+    [[nodiscard]] Tier tier_of(unsigned short address) const;
+
+    [[nodiscard]] const TierCounters& counters() const noexcept { return tier_counters; }
+
+    // Drops all heat, translations and counters so every address starts over in the interpreter
+    void reset() noexcept;
+
+    // Executions an address needs in a tier before it is promoted to the next
+    unsigned int hot_threshold;
+
+    // When set every instruction runs in this tier regardless of heat. Meant for testing.
+    std::optional<Tier> forced_tier;
+
+  private:
+    // Executes the instruction at the program counter of cpu in its tier, or the whole block there
+    // if it is translated and fits in count instructions and cycles machine cycles. Returns the
+    // number of instructions executed.
+    template <class Access>
+    size_t step(BasicCPU<Access>& cpu, BasicMemory<Access>& mem, BasicGraphics<Access>& graphics,
+                Keypad& keypad, size_t count, unsigned long long cycles);
+
+    // Counts an execution of address in tier and promotes it if it crossed the threshold
+    void heat_up(unsigned short address, Tier tier) noexcept;
+
+    // Per address state, indexed by address / 2
+    std::array<unsigned int, decoded_slots> heat;
+    std::array<Tier, decoded_slots> tiers;
+
+    TierCounters tier_counters;
+
+    Jit jit;
+  };
+}  // namespace arch
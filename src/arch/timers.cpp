@@ -0,0 +1,19 @@
+#include "timers.h"
+
+arch::TimerUnit::TimerUnit(unsigned int ips) noexcept : mode(Timing::instructions) {
+  set_instructions_per_second(ips);
+}
+
+void arch::TimerUnit::set_instructions_per_second(unsigned int ips) noexcept {
+  this->ips = ips == 0 ? 1 : ips;
+  if (mode == Timing::instructions) {
+    rate = this->ips;
+    phase = 0;
+  }
+}
+
+void arch::TimerUnit::set_timing(Timing timing) noexcept {
+  mode = timing;
+  rate = timing == Timing::vip_cycles ? vip_cycles_per_second : ips;
+  phase = 0;
+}
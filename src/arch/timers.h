@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+#include "cycles.h"
+
+namespace arch {
+  constexpr unsigned int timer_frequency = 60;                   // Timer ticks per second
+  constexpr unsigned int default_instructions_per_second = 700;  // Emulated CPU speed
+
+  // Emulated time for the delay and sound timers. Guest time advances in units at a configurable
+  // rate, and the timers tick every 1 / timer_frequency seconds of it, no matter how fast the host
+  // runs the instructions. Fractions of a tick period carry over exactly, so 700 instructions per
+  // second ticks 60 times every 700 instructions. With Timing::instructions a unit is one
+  // instruction, with Timing::vip_cycles it is one VIP machine cycle, see instruction_cycles.
+  class TimerUnit {
+  public:
+    // ips of 0 is treated as 1
+    explicit TimerUnit(unsigned int ips = default_instructions_per_second) noexcept;
+
+    // Changes the rate of Timing::instructions, starting a fresh tick period if it is in use
+    void set_instructions_per_second(unsigned int ips) noexcept;
+
+    [[nodiscard]] unsigned int instructions_per_second() const noexcept { return ips; }
+
+    // Changes what a unit is, starting a fresh tick period. Timing::vip_cycles advances at
+    // vip_cycles_per_second.
+    void set_timing(Timing timing) noexcept;
+
+    [[nodiscard]] Timing timing() const noexcept { return mode; }
+
+    // Units left until the timers next tick, at least 1. The tick happens once the last of them
+    // has passed, so a batch of exactly this many instructions ends on the tick.
+    [[nodiscard]] size_t next_timer_event() const noexcept {
+      return (rate - phase + timer_frequency - 1) / timer_frequency;
+    }
+
+    // Advances guest time by units and returns how many times the timers tick in it
+    size_t advance(size_t units) noexcept {
+      const auto elapsed = phase + units * timer_frequency;
+      phase = static_cast<unsigned int>(elapsed % rate);
+      return elapsed / rate;
+    }
+
+    // advance(1) without the division, for loops that execute one instruction at a time
+    size_t step() noexcept {
+      size_t ticks = 0;
+      for (phase += timer_frequency; phase >= rate; phase -= rate) {
+        ticks++;
+      }
+      return ticks;
+    }
+
+  private:
+    unsigned int ips;  // Rate of Timing::instructions
+    Timing mode;
+    unsigned int rate;  // Units per second
+
+    // Guest time since the last tick. Each unit adds timer_frequency and the timers tick every
+    // rate, so it stays below rate.
+    unsigned int phase;
+  };
+}  // namespace arch
@@ -0,0 +1,69 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+#include "opcode_spec.h"
+
+arch::TraceBuffer::TraceBuffer(size_t capacity)
+    : words(std::bit_ceil(std::max<size_t>(capacity, 1)) * record_words),
+      mask(words.size() / record_words - 1) {}
+
+arch::TraceSnapshot arch::TraceBuffer::snapshot() const {
+  const auto end = written();
+  const auto count = std::min<unsigned long long>(end, capacity());
+  TraceSnapshot snapshot{end - count, {}};
+  snapshot.records.reserve(static_cast<size_t>(count));
+  for (auto cycle = snapshot.first_cycle; cycle < end; cycle++) {
+    std::array<unsigned int, record_words> values{};
+    const auto* slot = &words[(cycle & mask) * record_words];
+    for (size_t i = 0; i < record_words; i++) {
+      values[i] = slot[i].load(std::memory_order_relaxed);
+    }
+    TraceRecord record{};
+    std::memcpy(&record, values.data(), sizeof(record));
+    snapshot.records.push_back(record);
+  }
+
+  // Every record the writer started while the copy was made replaced the one capacity cycles older,
+  // so copies of those may be torn and are dropped
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const auto started_after = started.load(std::memory_order_relaxed);
+  const auto first_intact = started_after > capacity() ? started_after - capacity() : 0;
+  if (first_intact > snapshot.first_cycle) {
+    const auto dropped = std::min<unsigned long long>(first_intact - snapshot.first_cycle, count);
+    snapshot.records.erase(snapshot.records.begin(),
+                           snapshot.records.begin() + static_cast<std::ptrdiff_t>(dropped));
+    snapshot.first_cycle += dropped;
+  }
+  return snapshot;
+}
+
+bool arch::TraceBuffer::dump(const std::string& path) const {
+  const auto trace = snapshot();
+  const TraceFileHeader header{trace_magic, trace_version, sizeof(TraceRecord), trace.first_cycle,
+                               trace.records.size()};
+
+  std::ofstream file(path, std::fstream::binary | std::fstream::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(trace.records.data()),
+             static_cast<std::streamsize>(trace.records.size() * sizeof(TraceRecord)));
+  return static_cast<bool>(file);
+}
+
+std::string arch::trace_record_line(unsigned long long cycle, const TraceRecord& record) {
+  auto line = std::format("{0:>12}  {1:04X}  {2:04X}  {3:<16}", cycle, record.pc, record.opcode,
+                          disassemble(record.opcode));
+  if (record.reg != no_register) {
+    line += std::format(" V{0:X}={1:02X}", record.reg, record.value);
+  }
+  line += std::format(" VF={0:02X} I={1:03X}", record.vf, record.index);
+  if ((record.flags & trace_timers_changed) != 0) {
+    line += std::format(" DT={0:02X} ST={1:02X}", record.delay, record.sound);
+  }
+  return line;
+}
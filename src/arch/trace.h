@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "instruction.h"
+
+namespace arch {
+  constexpr unsigned char no_register = 0xFF;  // TraceRecord::reg of instructions that write none
+
+  // Bits of TraceRecord::flags
+  enum TraceFlag : unsigned char {
+    trace_timers_changed = 1 << 0,  // delay and sound differ from the record before
+  };
+
+  // One executed instruction, with the state it left behind. Kept to 12 bytes so that millions fit
+  // in a few tens of MiB and writing one is a couple of stores.
+  struct TraceRecord {
+    unsigned short pc;      // Address the instruction was fetched from
+    unsigned short opcode;  // Raw opcode
+    unsigned short index;   // Index register after the instruction
+    unsigned char reg;      // Register X if the instruction writes it, no_register otherwise
+    unsigned char value;    // Value of reg after the instruction
+    unsigned char vf;       // VF after the instruction, which many instructions write as a flag
+    unsigned char delay;    // Delay timer after the instruction
+    unsigned char sound;    // Sound timer after the instruction
+    unsigned char flags;    // TraceFlag values
+  };
+
+  static_assert(sizeof(TraceRecord) == 12, "Trace records are written to files as they are");
+
+  // Start of a trace file, followed by count TraceRecords oldest first. Both are written in the
+  // byte order of the host that wrote them.
+  struct TraceFileHeader {
+    std::array<char, 8> magic;       // trace_magic
+    unsigned int version;            // trace_version
+    unsigned int record_size;        // sizeof(TraceRecord)
+    unsigned long long first_cycle;  // Cycle of the first record, counted from when tracing began
+    unsigned long long count;        // Records in the file
+  };
+
+  inline constexpr std::array<char, 8> trace_magic{'C', 'H', '8', 'T', 'R', 'A', 'C', 'E'};
+  constexpr unsigned int trace_version = 1;
+
+  // Records the ring buffer can hold by default, 12 MiB worth
+  constexpr size_t default_trace_capacity = size_t{1} << 20;
+
+  // True for the forms that write register X, which are the ones whose record holds it. FX65 writes
+  // every register up to X and only the last one is recorded.
+  constexpr bool writes_vx(Op op) noexcept {
+    return op == Op::op_6XNN || op == Op::op_7XNN
+           || (op >= Op::op_8XY0 && op <= Op::op_8XYE) || op == Op::op_CXNN || op == Op::op_FX07
+           || op == Op::op_FX0A || op == Op::op_FX65;
+  }
+
+  // Consecutive records taken out of a TraceBuffer
+  struct TraceSnapshot {
+    unsigned long long first_cycle;    // Cycle of records[0]
+    std::vector<TraceRecord> records;  // Oldest first
+  };
+
+  // Fixed size ring buffer of the most recent TraceRecords. There is a single writer, the CPU,
+  // which never waits: the oldest record is overwritten once the buffer is full. Other threads can
+  // take a snapshot or dump it at any time without locking. Records are kept as relaxed atomic
+  // words, and a snapshot drops any record the writer may have overwritten while it was copied.
+  class TraceBuffer {
+  public:
+    // capacity is rounded up to a power of two
+    explicit TraceBuffer(size_t capacity = default_trace_capacity);
+
+    void write(const TraceRecord& record) noexcept {
+      const auto position = head.load(std::memory_order_relaxed);
+      auto stored = record;
+      if (position == 0 || last_delay != record.delay || last_sound != record.sound) {
+        stored.flags |= trace_timers_changed;
+      }
+      last_delay = record.delay;
+      last_sound = record.sound;
+
+      std::array<unsigned int, record_words> values{};
+      std::memcpy(values.data(), &stored, sizeof(stored));
+      // A reader that sees any of the words below also sees that this record was started, see
+      // snapshot
+      started.store(position + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      auto* slot = &words[(position & mask) * record_words];
+      for (size_t i = 0; i < record_words; i++) {
+        slot[i].store(values[i], std::memory_order_relaxed);
+      }
+      head.store(position + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] size_t capacity() const noexcept { return mask + 1; }
+
+    // Records written since the buffer was created, which is also the cycle of the next one
+    [[nodiscard]] unsigned long long written() const noexcept {
+      return head.load(std::memory_order_acquire);
+    }
+
+    // The records still in the buffer, oldest first
+    [[nodiscard]] TraceSnapshot snapshot() const;
+
+    // Writes the snapshot to path as a trace file. Returns false if the file could not be written.
+    bool dump(const std::string& path) const;
+
+  private:
+    static constexpr size_t record_words = sizeof(TraceRecord) / sizeof(unsigned int);
+    static_assert(record_words * sizeof(unsigned int) == sizeof(TraceRecord));
+
+    std::vector<std::atomic<unsigned int>> words;  // record_words per record
+    size_t mask;
+    std::atomic<unsigned long long> head{0};     // Count of records written
+    std::atomic<unsigned long long> started{0};  // Count of records the writer began writing
+
+    // Timers of the last record written, only touched by the writer
+    unsigned char last_delay = 0;
+    unsigned char last_sound = 0;
+  };
+
+  // Human readable form of the record of cycle: cycle, address, opcode, disassembly and the state
+  // it left behind
+  [[nodiscard]] std::string trace_record_line(unsigned long long cycle, const TraceRecord& record);
+}  // namespace arch
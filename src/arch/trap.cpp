@@ -0,0 +1,32 @@
+#include "trap.h"
+
+#include "cpu.h"
+#include "memory.h"
+
+std::string_view arch::fault_name(Fault fault) noexcept {
+  switch (fault) {
+    case Fault::none:
+      return "none";
+    case Fault::invalid_instruction:
+      return "invalid instruction";
+    case Fault::invalid_address:
+      return "invalid address";
+    case Fault::stack_overflow:
+      return "stack overflow";
+    case Fault::stack_underflow:
+      return "stack underflow";
+  }
+  return "unknown";
+}
+
+void arch::throw_trap(const Trap& trap) {
+  switch (trap.fault) {
+    case Fault::invalid_address:
+      throw InvalidMemoryAddress();
+    case Fault::stack_overflow:
+    case Fault::stack_underflow:
+      throw InvalidStackPointerValue();
+    default:
+      throw InvalidInstruction();
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+
+namespace arch {
+  // Faults the CPU core can run into while executing guest code
+  enum class Fault : unsigned char {
+    none,                 // Nothing has gone wrong
+    invalid_instruction,  // Opcode does not encode any instruction
+    invalid_address,      // Fetch or a memory access went past max_mem_address
+    stack_overflow,       // 2NNN with every stack slot already in use
+    stack_underflow,      // 00EE with nothing on the stack to return to
+  };
+
+  // Record of the first fault the CPU ran into. Reported in place of throwing so that the execution
+  // loops never have to unwind.
+  struct Trap {
+    Fault fault;            // Fault::none while the CPU has not trapped
+    unsigned short pc;      // Address of the faulting instruction
+    unsigned short opcode;  // Opcode of the faulting instruction, 0 if it could not be fetched
+  };
+
+  // Outcome of running guest code through the exception free entry points of CPU
+  enum class Status : unsigned char {
+    ok,       // Every instruction executed
+    trapped,  // Execution stopped at a fault, see CPU::trap
+  };
+
+  // Short lower case name of fault for error messages
+  [[nodiscard]] std::string_view fault_name(Fault fault) noexcept;
+
+  // Throws the exception the throwing CPU entry points have always used for the fault of trap:
+  // InvalidInstruction, InvalidMemoryAddress or InvalidStackPointerValue
+  [[noreturn]] void throw_trap(const Trap& trap);
+}  // namespace arch
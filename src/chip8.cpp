@@ -1,35 +1,168 @@
 #include "chip8.h"
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <string>
 #include <vector>
 
-Chip8::Chip8(std::string& file_name) {
-  cpu = arch::CPU{};
-  memory = arch::Memory{};
-  keypad = arch::Keypad{};
-  graphics = arch::Graphics{};
+namespace {
+  std::vector<unsigned char> read_program(const std::string& file_name) {
+    std::ifstream program(file_name.c_str(), std::fstream::binary);
+    return std::vector<unsigned char>((std::istreambuf_iterator<char>(program)),
+                                      std::istreambuf_iterator<char>());
+  }
+}  // namespace
+
+template <class Access>
+arch::BasicMemory<Access> boot_memory(const std::vector<unsigned char>& program) {
+  arch::BasicMemory<Access> memory;
 
   // Load font set into memory
   for (auto i = 0; i < chip8_fontset.size(); i++) {
     memory.set_value(static_cast<unsigned short>(i), chip8_fontset[i]);
   }
 
-  std::ifstream program(file_name.c_str(), std::fstream::binary);
-  std::vector<unsigned char> program_vec((std::istreambuf_iterator<char>(program)),
-                                         std::istreambuf_iterator<char>());
-
   // load program into memory
-  for (auto i = 0; i < program_vec.size(); i++) {
-    memory.set_value(cpu.pc_reg + i, program_vec[i]);
+  for (auto i = 0; i < program.size(); i++) {
+    memory.set_value(static_cast<unsigned short>(arch::pc_start_value + i), program[i]);
+  }
+  return memory;
+}
+
+template <class Access>
+BasicChip8<Access>::BasicChip8(const std::string& file_name, unsigned int hot_threshold)
+    : BasicChip8(read_program(file_name), hot_threshold) {}
+
+template <class Access>
+BasicChip8<Access>::BasicChip8(const std::vector<unsigned char>& program,
+                               unsigned int hot_threshold)
+    : engine(hot_threshold) {
+  cpu = arch::BasicCPU<Access>{};
+  memory = boot_memory<Access>(program);
+  keypad = arch::Keypad{};
+  graphics = arch::BasicGraphics<Access>{};
+#if defined(CHIP8_TRACE)
+  set_trace_capacity(arch::default_trace_capacity);
+#endif
+}
+
+template <class Access>
+void BasicChip8<Access>::emulate_cycle() {
+  // A parked FX0A would only execute itself again, which on the VIP is another poll of the keypad
+  if (waiting_for_key()) {
+    const auto cycles = arch::instruction_cycles(cpu.curr_opcode, 0, false);
+    cpu.guest_cycles += cycles;
+    advance_time(timers.timing() == arch::Timing::vip_cycles ? cycles : 1);
+    return;
+  }
+
+  size_t ticks = 0;
+  execute(1, false, ticks);
+}
+
+template <class Access>
+RunResult BasicChip8<Access>::run_cycles(size_t n) { return run(n, false); }
+
+template <class Access>
+RunResult BasicChip8<Access>::run_until_draw(size_t max_cycles) { return run(max_cycles, true); }
+
+template <class Access>
+RunResult BasicChip8<Access>::run_frame() {
+  // Every instruction is one unit of guest time with Timing::instructions, so the frame is known to
+  // be that many cycles. With VIP cycles it is however many instructions fit before the tick.
+  const auto max_cycles = timers.timing() == arch::Timing::instructions
+                              ? timers.next_timer_event()
+                              : std::numeric_limits<size_t>::max();
+  return run(max_cycles, false, true);
+}
+
+template <class Access>
+RunResult BasicChip8<Access>::run_frame(unsigned int ips) {
+  if (ips != timers.instructions_per_second()) {
+    timers.set_instructions_per_second(ips);
   }
+  return run_frame();
 }
 
-void Chip8::emulate_cycle() {
-  cpu.fetch(memory);
+template <class Access>
+void BasicChip8<Access>::set_instructions_per_second(unsigned int ips) {
+  timers.set_instructions_per_second(ips);
+}
+
+template <class Access>
+unsigned int BasicChip8<Access>::instructions_per_second() const {
+  return timers.instructions_per_second();
+}
+
+template <class Access>
+void BasicChip8<Access>::set_timing(arch::Timing timing) {
+  timers.set_timing(timing);
+}
+
+template <class Access>
+arch::Timing BasicChip8<Access>::timing() const { return timers.timing(); }
+
+template <class Access>
+unsigned long long BasicChip8<Access>::guest_cycles() const { return cpu.guest_cycles; }
+
+template <class Access>
+size_t BasicChip8<Access>::next_timer_event() const {
+  return timers.next_timer_event();
+}
+
+template <class Access>
+RunResult BasicChip8<Access>::run(size_t max_cycles, bool stop_on_draw, bool stop_on_tick) {
+  RunResult result{0, false, StopReason::cycle_limit};
+  // Idle loops are entered through a jump, so only look for one at the start and after jumps
+  auto check_idle = true;
+
+  while (result.cycles < max_cycles) {
+    if (waiting_for_key()) {
+      result.stop = StopReason::waiting_for_key;
+      break;
+    }
+
+    if (cpu.trapped()) {
+      result.stop = StopReason::trap;
+      break;
+    }
+
+    if (check_idle) {
+      check_idle = false;
+      const auto skip = fast_forward_idle(max_cycles - result.cycles, stop_on_tick);
+      if (skip.cycles > 0) {
+        result.cycles += skip.cycles;
+        if (stop_on_tick && skip.ticks > 0) {
+          break;
+        }
+        continue;
+      }
+    }
+
+    size_t ticks = 0;
+    result.cycles += execute(max_cycles - result.cycles, stop_on_draw, ticks);
+    check_idle = (cpu.curr_opcode & 0xF000) == 0x1000;
+
+    if (cpu.updated_screen) {
+      result.screen_changed = true;
+      if (stop_on_draw) {
+        result.stop = StopReason::draw;
+        break;
+      }
+    }
+
+    if (stop_on_tick && ticks > 0) {
+      break;
+    }
+  }
 
-  cpu.decode_execute(memory, graphics, keypad);
+  cpu.updated_screen = result.screen_changed;
+  return result;
+}
 
+template <class Access>
+void BasicChip8<Access>::tick_timers() {
   if (cpu.delay_timer_reg > 0) {
     --cpu.delay_timer_reg;
   }
@@ -42,11 +175,130 @@ void Chip8::emulate_cycle() {
   }
 }
 
-bool Chip8::should_draw() const { return cpu.updated_screen; }
+template <class Access>
+size_t BasicChip8<Access>::execute(size_t max_cycles, bool stop_on_draw, size_t& ticks) {
+  // The timers cannot change in the middle of a batch, so it runs up to the next tick at most
+  const auto vip = timers.timing() == arch::Timing::vip_cycles;
+  arch::BatchLimits limits{max_cycles, std::numeric_limits<unsigned long long>::max(), stop_on_draw,
+                           true};
+  if (vip) {
+    limits.cycles = timers.next_timer_event();
+  } else {
+    limits.count = std::min(max_cycles, timers.next_timer_event());
+  }
+#if defined(CHIP8_PROFILER)
+  // Guest time is profiled per address, so every instruction is its own batch
+  limits.count = 1;
+  const auto pc = cpu.pc_reg;
+#endif
+
+  const auto guest_cycles = cpu.guest_cycles;
+  const auto executed = engine.run_batch(cpu, memory, graphics, keypad, limits);
+  const auto elapsed = vip ? static_cast<size_t>(cpu.guest_cycles - guest_cycles) : executed;
+#if defined(CHIP8_PROFILER)
+  profiler.record(pc, elapsed);
+#endif
+  ticks = advance_time(elapsed);
+  return executed;
+}
+
+template <class Access>
+size_t BasicChip8<Access>::advance_time(size_t units) {
+  const auto ticks = timers.advance(units);
+  for (auto i = ticks; i > 0; i--) {
+    tick_timers();
+  }
+  return ticks;
+}
+
+template <class Access>
+const arch::Trap& BasicChip8<Access>::trap() const noexcept { return cpu.trap(); }
+
+template <class Access>
+bool BasicChip8<Access>::waiting_for_key() const {
+  return cpu.waiting_for_key && !keypad.key_pressed;
+}
+
+template <class Access>
+arch::IdleSkip BasicChip8<Access>::fast_forward_idle(size_t max_cycles, bool stop_on_tick) {
+#if defined(CHIP8_PROFILER)
+  const auto pc = cpu.pc_reg;
+  const auto guest_cycles = cpu.guest_cycles;
+#endif
+  const auto skip = arch::skip_idle_loop(cpu, memory, keypad, max_cycles, timers, stop_on_tick);
+#if defined(CHIP8_PROFILER)
+  // The skipped iterations were spent polling, so their time goes to the start of the loop
+  profiler.record(pc, timers.timing() == arch::Timing::vip_cycles
+                          ? static_cast<size_t>(cpu.guest_cycles - guest_cycles)
+                          : skip.cycles);
+#endif
+  return skip;
+}
+
+template <class Access>
+bool BasicChip8<Access>::should_draw() const { return cpu.updated_screen; }
 
-bool Chip8::get_pixel(unsigned int x, unsigned int y) const { return graphics.get_pixel(x, y); }
+template <class Access>
+const arch::TierCounters& BasicChip8<Access>::tier_counters() const { return engine.counters(); }
 
-void Chip8::handle_keys(enum input_events::Events key_state) {
+template <class Access>
+void BasicChip8<Access>::force_tier(std::optional<arch::Tier> tier) { engine.forced_tier = tier; }
+
+template <class Access>
+void BasicChip8<Access>::set_fusion(bool enabled) {
+  cpu.dispatch = enabled ? arch::Dispatch::fused : arch::BasicCPU<Access>::initial_dispatch;
+}
+
+template <class Access>
+const arch::FusionCounters& BasicChip8<Access>::fusion_counters() const {
+  return cpu.fusion_counters;
+}
+
+#if defined(CHIP8_OPCODE_COUNTERS)
+template <class Access>
+const arch::OpcodeCounters& BasicChip8<Access>::opcode_counters() const {
+  return cpu.opcode_counters;
+}
+#endif
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+template <class Access>
+const arch::HandlerLatencies& BasicChip8<Access>::handler_latencies() const {
+  return cpu.handler_latencies;
+}
+#endif
+
+#if defined(CHIP8_TRACE)
+template <class Access>
+const arch::TraceBuffer& BasicChip8<Access>::trace_buffer() const { return *trace; }
+
+template <class Access>
+void BasicChip8<Access>::set_trace_capacity(size_t records) {
+  trace = std::make_unique<arch::TraceBuffer>(records);
+  cpu.trace = trace.get();
+}
+
+template <class Access>
+bool BasicChip8<Access>::dump_trace(const std::string& path) const { return trace->dump(path); }
+#endif
+
+#if defined(CHIP8_PROFILER)
+template <class Access>
+arch::Profiler& BasicChip8<Access>::guest_profiler() { return profiler; }
+
+template <class Access>
+std::string BasicChip8<Access>::profile_report(size_t max_blocks) const {
+  return arch::profile_report(profiler, memory, max_blocks);
+}
+#endif
+
+template <class Access>
+bool BasicChip8<Access>::get_pixel(unsigned int x, unsigned int y) const {
+  return graphics.get_pixel(x, y);
+}
+
+template <class Access>
+void BasicChip8<Access>::handle_keys(enum input_events::Events key_state) {
   // A nasty switch
   switch (key_state) {
     case input_events::Events::zero_pressed:
@@ -148,4 +400,12 @@ void Chip8::handle_keys(enum input_events::Events key_state) {
     default:
       break;
   }
-}
\ No newline at end of file
+}
+
+template arch::BasicMemory<arch::CheckedAccess> boot_memory(
+    const std::vector<unsigned char>& program);
+template arch::BasicMemory<arch::WrappingAccess> boot_memory(
+    const std::vector<unsigned char>& program);
+
+template class BasicChip8<arch::CheckedAccess>;
+template class BasicChip8<arch::WrappingAccess>;
@@ -1,12 +1,22 @@
 #pragma once
 
 #include <array>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "arch/cpu.h"
 #include "arch/graphics.h"
+#include "arch/idle.h"
 #include "arch/keypad.h"
 #include "arch/memory.h"
+#include "arch/profiler.h"
+#include "arch/tiered.h"
+#include "arch/timers.h"
+#include "arch/trace.h"
+#include "arch/trap.h"
 #include "display/input_events.h"
 
 constexpr std::array<unsigned char, 80> chip8_fontset = {
@@ -28,12 +38,144 @@ constexpr std::array<unsigned char, 80> chip8_fontset = {
     0xF0, 0x80, 0xF0, 0x80, 0x80   // F
 };
 
-class Chip8 {
+// Memory of a freshly booted machine: the font at 0 and program at arch::pc_start_value. Throws
+// arch::InvalidMemoryAddress if the program does not fit.
+template <class Access>
+[[nodiscard]] arch::BasicMemory<Access> boot_memory(const std::vector<unsigned char>& program);
+
+// Why a batch of cycles returned to the caller
+enum class StopReason {
+  cycle_limit,      // Every requested cycle ran
+  draw,             // An instruction updated the screen, only for run_until_draw
+  waiting_for_key,  // FX0A is waiting for a key press, see Chip8::waiting_for_key
+  trap,             // An instruction faulted, see Chip8::trap
+};
+
+// Outcome of a batch of cycles
+struct RunResult {
+  size_t cycles;        // Cycles emulated, including idle loop cycles that were skipped
+  bool screen_changed;  // Any instruction updated the screen
+  StopReason stop;      // Why the batch ended
+};
+
+// The whole machine. Access is the bounds policy of its memory and screen, see arch::CheckedAccess
+// and arch::WrappingAccess.
+template <class Access>
+class BasicChip8 {
 public:
-  Chip8(std::string& file_name);
+  BasicChip8(const std::string& file_name,
+             unsigned int hot_threshold = arch::default_hot_threshold);
 
+  // Loads program from memory instead of a file
+  explicit BasicChip8(const std::vector<unsigned char>& program,
+                      unsigned int hot_threshold = arch::default_hot_threshold);
+
+  // Emulates a single cycle, advancing guest time by one instruction, or by the machine cycles it
+  // took with arch::Timing::vip_cycles. The delay and sound timers tick every 1/60 s of guest time,
+  // see arch::TimerUnit. Does nothing but advance guest time once an instruction has trapped.
   void emulate_cycle();
 
+  // Batched versions of emulate_cycle that keep going without returning to the caller in between
+  // cycles. They return early when FX0A starts waiting for a key or an instruction traps.
+
+  // Emulates n cycles
+  RunResult run_cycles(size_t n);
+
+  // Emulates cycles until one updates the screen, but no more than max_cycles
+  RunResult run_until_draw(size_t max_cycles = std::numeric_limits<size_t>::max());
+
+  // Emulates the cycles up to and including the next timer tick, which is one 60 Hz frame of guest
+  // time. Fractions of a cycle are carried over to the next frame. With arch::Timing::vip_cycles
+  // the number of instructions depends on what they cost.
+  RunResult run_frame();
+
+  // As above after changing the emulated speed to ips instructions per second if it differs, which
+  // only takes effect with arch::Timing::instructions
+  RunResult run_frame(unsigned int ips);
+
+  // Emulated speed with arch::Timing::instructions, arch::default_instructions_per_second unless
+  // changed. Changing it starts a fresh timer period.
+  void set_instructions_per_second(unsigned int ips);
+
+  [[nodiscard]] unsigned int instructions_per_second() const;
+
+  // What guest time is measured in, arch::Timing::instructions unless changed. With
+  // arch::Timing::vip_cycles every instruction takes as long as it took the COSMAC VIP, see
+  // arch::instruction_cycles. Changing it starts a fresh timer period.
+  void set_timing(arch::Timing timing);
+
+  [[nodiscard]] arch::Timing timing() const;
+
+  // Machine cycles the COSMAC VIP would have taken for every cycle emulated so far
+  [[nodiscard]] unsigned long long guest_cycles() const;
+
+  // Guest time left until the delay and sound timers next tick, in cycles or in VIP machine cycles
+  // depending on timing. With arch::Timing::instructions batched runners can run this many cycles
+  // straight through without looking at the timers.
+  [[nodiscard]] size_t next_timer_event() const;
+
+  // Decrements the delay and sound timers once. Cycles already tick them as guest time passes,
+  // this is for drivers that keep them going in real time while FX0A waits for a key.
+  void tick_timers();
+
+  // True while FX0A is waiting for a key press. Cycles emulated in this state only tick the timers,
+  // so drivers can block on their input source instead and call tick_timers at 60 Hz until
+  // handle_keys delivers a key.
+  [[nodiscard]] bool waiting_for_key() const;
+
+  // Skips up to max_cycles cycles of a polling loop on the delay timer or the keypad that the
+  // program counter is at, as if emulate_cycle had been called that many times. With stop_on_tick
+  // it stops at the first timer tick.
+  arch::IdleSkip fast_forward_idle(size_t max_cycles, bool stop_on_tick = false);
+
+  // The fault that stopped the emulator, Fault::none while it is running normally. Nothing
+  // executes after a fault.
+  [[nodiscard]] const arch::Trap& trap() const noexcept;
+
+  // Number of instructions executed in each tier so far
+  [[nodiscard]] const arch::TierCounters& tier_counters() const;
+
+  // Runs every instruction in tier instead of promoting hot code, std::nullopt restores promotion
+  void force_tier(std::optional<arch::Tier> tier);
+
+  // Runs predecoded code as superinstructions where it can, see arch::Dispatch::fused. Only used
+  // with Timing::instructions, since a superinstruction can overrun a VIP cycle budget, and never
+  // in builds with the profiler, which run one instruction at a time.
+  void set_fusion(bool enabled);
+
+  // How often superinstructions ran so far, see arch::BasicCPU::fusion_counters
+  [[nodiscard]] const arch::FusionCounters& fusion_counters() const;
+
+#if defined(CHIP8_OPCODE_COUNTERS)
+  // Instruction mix of everything run so far, see arch::BasicCPU::opcode_counters
+  [[nodiscard]] const arch::OpcodeCounters& opcode_counters() const;
+#endif
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  // Host time each opcode form took so far, see arch::BasicCPU::handler_latencies
+  [[nodiscard]] const arch::HandlerLatencies& handler_latencies() const;
+#endif
+
+#if defined(CHIP8_TRACE)
+  // The most recent instructions executed, see arch::BasicCPU::trace
+  [[nodiscard]] const arch::TraceBuffer& trace_buffer() const;
+
+  // Replaces the trace buffer with an empty one that holds the last records instructions
+  void set_trace_capacity(size_t records);
+
+  // Writes the trace buffer to path, see arch::TraceBuffer::dump
+  bool dump_trace(const std::string& path) const;
+#endif
+
+#if defined(CHIP8_PROFILER)
+  // Guest time spent at each address so far, counted exactly unless its sample period is changed.
+  // Skipped idle loop iterations count towards the start of the loop.
+  arch::Profiler& guest_profiler();
+
+  // Hottest basic blocks of the program in memory, see arch::profile_report
+  [[nodiscard]] std::string profile_report(size_t max_blocks = 20) const;
+#endif
+
   bool should_draw() const;
 
   bool get_pixel(unsigned int x, unsigned int y) const;
@@ -41,8 +183,30 @@ public:
   void handle_keys(enum input_events::Events key_state);
 
 private:
-  arch::CPU cpu;
-  arch::Memory memory;
+  RunResult run(size_t max_cycles, bool stop_on_draw, bool stop_on_tick = false);
+
+  // Hands the engine a batch of at most max_cycles instructions that ends at the next timer tick,
+  // or earlier on a draw with stop_on_draw, and advances guest time past what it executed. Returns
+  // the number of instructions executed and sets ticks to the number of timer ticks.
+  size_t execute(size_t max_cycles, bool stop_on_draw, size_t& ticks);
+
+  // Advances guest time by units of the current timing and ticks the timers for every 1/60 s of it
+  // that has passed. Returns the number of ticks.
+  size_t advance_time(size_t units);
+
+  arch::BasicCPU<Access> cpu;
+  arch::BasicMemory<Access> memory;
   arch::Keypad keypad;
-  arch::Graphics graphics;
+  arch::BasicGraphics<Access> graphics;
+  arch::TieredEngine engine;
+  arch::TimerUnit timers;
+#if defined(CHIP8_PROFILER)
+  arch::Profiler profiler;
+#endif
+#if defined(CHIP8_TRACE)
+  std::unique_ptr<arch::TraceBuffer> trace;  // On the heap so that the CPU can point at it
+#endif
 };
+
+// Bounds checked machine, which traps on any access past the end of memory
+using Chip8 = BasicChip8<arch::CheckedAccess>;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "frontend.h"
+#include "input_events.h"
+
+namespace display {
+  // Frontend that keeps everything in memory, for tests and tools that inspect what a ROM draws.
+  // Every presented frame is recorded and input comes from a script of events. Time is a
+  // VirtualClock.
+  class CaptureFrontend {
+  public:
+    void present_frame(const Frame& frame) { frames.push_back(frame); }
+
+    // Takes the next scripted event, if any
+    input_events::Events poll_input() {
+      if (input.empty()) {
+        return input_events::Events::none;
+      }
+      const auto event = input.front();
+      input.pop_front();
+      return event;
+    }
+
+    // Takes the next scripted event right away, or lets duration pass if there is none
+    input_events::Events wait_for_input(std::chrono::nanoseconds duration) {
+      if (input.empty()) {
+        clock.sleep(duration);
+      }
+      return poll_input();
+    }
+
+    [[nodiscard]] std::chrono::nanoseconds now() const noexcept { return clock.now(); }
+
+    void sleep(std::chrono::nanoseconds duration) noexcept { clock.sleep(duration); }
+
+    std::vector<Frame> frames;               // Every frame presented, oldest first
+    std::deque<input_events::Events> input;  // Events still to be delivered, next first
+
+  private:
+    VirtualClock clock;
+  };
+
+  static_assert(Frontend<CaptureFrontend>);
+}  // namespace display
@@ -50,7 +50,22 @@ public:
   void delay(unsigned int milli_sec) const { SDL_Delay(milli_sec); }
 
   enum input_events::Events handle_input() {
-    SDL_PollEvent(&event);
+    if (SDL_PollEvent(&event) == 0) {
+      return input_events::Events::none;
+    }
+    return translate_event();
+  }
+
+  enum input_events::Events wait_for_input(unsigned int timeout_ms) {
+    if (SDL_WaitEventTimeout(&event, static_cast<int>(timeout_ms)) == 0) {
+      return input_events::Events::none;
+    }
+    return translate_event();
+  }
+
+private:
+  // Maps the last polled event to the emulator's input events
+  enum input_events::Events translate_event() const {
     // some hard coded mappings using the layout shown here
     // http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy2
     // A nasty switch...
@@ -139,7 +154,6 @@ public:
     return input_events::Events::none;
   }
 
-private:
   struct sdl_deleter {
     void operator()(SDL_Window* ptr) const { SDL_DestroyWindow(ptr); };
     void operator()(SDL_Renderer* ptr) const { SDL_DestroyRenderer(ptr); };
@@ -178,6 +192,10 @@ void display::Display::delay(unsigned int milli_sec) const { p_impl->delay(milli
 
 enum input_events::Events display::Display::handle_input() const { return p_impl->handle_input(); }
 
+enum input_events::Events display::Display::wait_for_input(unsigned int timeout_ms) const {
+  return p_impl->wait_for_input(timeout_ms);
+}
+
 long long display::Display::get_performance_counter() const noexcept {
   return SDL_GetPerformanceCounter();
 }
@@ -27,8 +27,13 @@ namespace display {
 
     void delay(unsigned int milli_sec) const;
 
+    // Returns the next pending input event or input_events::Events::none if there is none
     enum input_events::Events handle_input() const;
 
+    // Blocks until an input event arrives or timeout_ms milliseconds pass, in which case
+    // input_events::Events::none is returned
+    enum input_events::Events wait_for_input(unsigned int timeout_ms) const;
+
     long long get_performance_counter() const noexcept;
 
     long long get_performance_frequency() const noexcept;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <bitset>
+#include <chrono>
+#include <concepts>
+
+#include "input_events.h"
+
+namespace display {
+  constexpr unsigned int frame_width = 64;   // Pixels per row of a frame
+  constexpr unsigned int frame_height = 32;  // Rows of a frame
+
+  // One picture of the emulated screen, as handed to a frontend
+  struct Frame {
+    std::bitset<frame_width * frame_height> pixels;
+
+    [[nodiscard]] bool get_pixel(unsigned int x, unsigned int y) const {
+      return pixels[y * frame_width + x];
+    }
+
+    void set_pixel(unsigned int x, unsigned int y, bool value) {
+      pixels[y * frame_width + x] = value;
+    }
+
+    bool operator==(const Frame&) const = default;
+  };
+
+  // What the main loop needs from its surroundings: somewhere to show frames, a source of input and
+  // a clock. Frontends are picked at compile time by instantiating the loop with one, see
+  // run_frontend, so none of these calls go through a virtual function.
+  template <class F>
+  concept Frontend = requires(F frontend, const Frame& frame, std::chrono::nanoseconds duration) {
+    frontend.present_frame(frame);
+
+    // Next pending input event or input_events::Events::none if there is none
+    { frontend.poll_input() } -> std::same_as<input_events::Events>;
+
+    // Blocks until an input event arrives or duration passes, in which case
+    // input_events::Events::none is returned
+    { frontend.wait_for_input(duration) } -> std::same_as<input_events::Events>;
+
+    // Time since an arbitrary starting point
+    { frontend.now() } -> std::same_as<std::chrono::nanoseconds>;
+
+    frontend.sleep(duration);
+  };
+
+  // Clock of frontends without a real one. Time only passes when something waits or sleeps, and
+  // it passes instantly, so loops run as fast as the host can emulate while still seeing 60 Hz of
+  // emulated frames go by.
+  class VirtualClock {
+  public:
+    [[nodiscard]] std::chrono::nanoseconds now() const noexcept { return time; }
+
+    void sleep(std::chrono::nanoseconds duration) noexcept { time += duration; }
+
+  private:
+    std::chrono::nanoseconds time{0};
+  };
+}  // namespace display
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include "frontend.h"
+#include "input_events.h"
+
+namespace display {
+  // Frontend for machines without a display. Frames are counted and dropped, no input ever
+  // arrives and time is a VirtualClock, so nothing ever sleeps.
+  class NullFrontend {
+  public:
+    void present_frame(const Frame&) noexcept { frames_presented++; }
+
+    [[nodiscard]] input_events::Events poll_input() const noexcept {
+      return input_events::Events::none;
+    }
+
+    input_events::Events wait_for_input(std::chrono::nanoseconds duration) noexcept {
+      clock.sleep(duration);
+      return input_events::Events::none;
+    }
+
+    [[nodiscard]] std::chrono::nanoseconds now() const noexcept { return clock.now(); }
+
+    void sleep(std::chrono::nanoseconds duration) noexcept { clock.sleep(duration); }
+
+    size_t frames_presented = 0;
+
+  private:
+    VirtualClock clock;
+  };
+
+  static_assert(Frontend<NullFrontend>);
+}  // namespace display
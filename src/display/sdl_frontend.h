@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+
+#include "display.h"
+#include "frontend.h"
+#include "input_events.h"
+
+namespace display {
+  // Frontend drawing to an SDL window through Display, with every emulated pixel scaled to a
+  // square of scaling_factor screen pixels
+  class SdlFrontend {
+  public:
+    explicit SdlFrontend(unsigned int scaling_factor)
+        : display(frame_width * scaling_factor, frame_height * scaling_factor),
+          scaling_factor(scaling_factor) {}
+
+    void present_frame(const Frame& frame) const {
+      for (unsigned int x = 0; x < frame_width; x++) {
+        for (unsigned int y = 0; y < frame_height; y++) {
+          const unsigned char level = frame.get_pixel(x, y) ? 255 : 0;  // White or black
+          display.draw_scaled_pixel(level, level, level, x, y, scaling_factor);
+        }
+      }
+      display.render_display();
+    }
+
+    [[nodiscard]] input_events::Events poll_input() const { return display.handle_input(); }
+
+    input_events::Events wait_for_input(std::chrono::nanoseconds duration) const {
+      return display.wait_for_input(milliseconds(duration));
+    }
+
+    [[nodiscard]] std::chrono::nanoseconds now() const noexcept {
+      // Split the conversion so the counter cannot overflow when multiplied
+      const auto counter = display.get_performance_counter();
+      const auto frequency = display.get_performance_frequency();
+      return std::chrono::seconds(counter / frequency)
+             + std::chrono::nanoseconds(counter % frequency * 1'000'000'000 / frequency);
+    }
+
+    void sleep(std::chrono::nanoseconds duration) const { display.delay(milliseconds(duration)); }
+
+  private:
+    // SDL counts in whole milliseconds, so round down to never wait past the end of a frame
+    static unsigned int milliseconds(std::chrono::nanoseconds duration) {
+      return static_cast<unsigned int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+    }
+
+    Display display;
+    unsigned int scaling_factor;
+  };
+
+  static_assert(Frontend<SdlFrontend>);
+}  // namespace display
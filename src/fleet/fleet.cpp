@@ -0,0 +1,105 @@
+#include "fleet.h"
+
+#include <array>
+#include <format>
+
+#include "chip8.h"
+#include "frontend_loop.h"
+
+std::string_view fleet::stop_name(JobStop stop) noexcept {
+  switch (stop) {
+    case JobStop::cycle_limit:
+      return "cycle limit";
+    case JobStop::frame_limit:
+      return "frame limit";
+    case JobStop::waiting_for_key:
+      return "waiting for key";
+    case JobStop::trap:
+      return "trap";
+  }
+  return "unknown";
+}
+
+fleet::JobResult fleet::run_job(const Job& job) {
+  BasicChip8<arch::DefaultAccess> emulator(*job.program);
+  emulator.set_timing(job.timing);
+  emulator.set_instructions_per_second(job.instructions_per_second);
+
+  JobResult result{0, 0, JobStop::cycle_limit, arch::Trap{}, 0, std::nullopt, 0};
+  auto next_input = job.input.begin();
+  for (;; result.frames++) {
+    if (job.max_cycles != 0 && result.cycles >= job.max_cycles) {
+      result.stop = JobStop::cycle_limit;
+      break;
+    }
+    if (job.max_frames != 0 && result.frames >= job.max_frames) {
+      result.stop = JobStop::frame_limit;
+      break;
+    }
+
+    for (; next_input != job.input.end() && next_input->frame <= result.frames; ++next_input) {
+      emulator.handle_keys(next_input->event);
+    }
+
+    // A frame waiting for a key only ticks the timers, as it does in run_frontend
+    if (emulator.waiting_for_key()) {
+      if (next_input == job.input.end()) {
+        result.stop = JobStop::waiting_for_key;
+        break;
+      }
+      emulator.tick_timers();
+      continue;
+    }
+
+    const auto frame = emulator.run_frame();
+    result.cycles += frame.cycles;
+    if (frame.stop == StopReason::trap) {
+      result.frames++;
+      result.stop = JobStop::trap;
+      break;
+    }
+  }
+
+  result.trap = emulator.trap();
+  const auto screen = read_frame(emulator);
+  result.digest = frame_digest(screen);
+  if (job.keep_screen) {
+    result.screen = screen;
+  }
+  return result;
+}
+
+fleet::FleetReport fleet::run_fleet(const std::vector<Job>& jobs, unsigned int workers) {
+  FleetReport report{std::vector<JobResult>(jobs.size()), {}, {}};
+  const auto start = std::chrono::steady_clock::now();
+  // Every job writes its own result, so the workers share nothing but the queues
+  report.workers = run_work_stealing(jobs.size(), workers, [&](size_t index, unsigned int worker) {
+    report.results[index] = run_job(jobs[index]);
+    report.results[index].worker = worker;
+  });
+  report.elapsed = std::chrono::steady_clock::now() - start;
+  return report;
+}
+
+std::string fleet::fleet_summary(const FleetReport& report) {
+  std::array<size_t, 4> stops{};
+  unsigned long long cycles = 0;
+  for (const auto& result : report.results) {
+    stops[static_cast<size_t>(result.stop)]++;
+    cycles += result.cycles;
+  }
+  const auto seconds = std::chrono::duration<double>(report.elapsed).count();
+
+  auto summary = std::format("{0} jobs", report.results.size());
+  for (size_t stop = 0; stop < stops.size(); stop++) {
+    summary += std::format(", {0} {1}", stops[stop], stop_name(static_cast<JobStop>(stop)));
+  }
+  summary += std::format("\n{0} cycles in {1:.3f} s on {2} workers, {3:.1f} M cycles/s\n", cycles,
+                         seconds, report.workers.size(),
+                         seconds > 0 ? static_cast<double>(cycles) / seconds / 1e6 : 0.0);
+  for (size_t worker = 0; worker < report.workers.size(); worker++) {
+    summary += std::format("worker {0}: {1} jobs, {2} stolen\n", worker,
+                           report.workers[worker].tasks, report.workers[worker].stolen);
+  }
+  return summary;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arch/cycles.h"
+#include "arch/timers.h"
+#include "arch/trap.h"
+#include "display/frontend.h"
+#include "display/input_events.h"
+#include "work_stealing.h"
+
+namespace fleet {
+  // Input event delivered at the start of a 60 Hz frame of guest time
+  struct ScriptedInput {
+    size_t frame;                // Frames since the job started, counted from 0
+    input_events::Events event;  // Key press or release
+  };
+
+  // One run of a ROM, fully in memory, so that no job touches a file or a display
+  struct Job {
+    std::string name;  // How the job is reported
+
+    // Program to load at 0x200. Shared, so that jobs of the same ROM hold one copy.
+    std::shared_ptr<const std::vector<unsigned char>> program;
+
+    std::vector<ScriptedInput> input;  // Ordered by frame
+
+    // Cycles to run, 0 for no limit. The job stops at the end of the frame in which they run out.
+    unsigned long long max_cycles = 0;
+
+    size_t max_frames = 0;  // Frames to run at most, 0 for no limit
+
+    arch::Timing timing = arch::Timing::instructions;
+    unsigned int instructions_per_second = arch::default_instructions_per_second;
+
+    bool keep_screen = false;  // Return the final screen, not only its digest
+  };
+
+  // Why a job stopped
+  enum class JobStop {
+    cycle_limit,      // max_cycles ran
+    frame_limit,      // max_frames frames passed
+    waiting_for_key,  // FX0A waits for a key that no scripted input will press
+    trap,             // An instruction faulted, see JobResult::trap
+  };
+
+  // Outcome of a job
+  struct JobResult {
+    size_t frames;                         // 60 Hz frames that passed
+    unsigned long long cycles;             // Cycles emulated
+    JobStop stop;                          // Why the job stopped
+    arch::Trap trap;                       // The fault that stopped it, Fault::none otherwise
+    unsigned long long digest;             // frame_digest of the final screen
+    std::optional<display::Frame> screen;  // The final screen, with Job::keep_screen
+    unsigned int worker;                   // Worker that ran the job
+  };
+
+  // Short lower case name of stop for reports
+  [[nodiscard]] std::string_view stop_name(JobStop stop) noexcept;
+
+  // Runs job on the calling thread as if it were worker 0
+  [[nodiscard]] JobResult run_job(const Job& job);
+
+  // Results of run_fleet
+  struct FleetReport {
+    std::vector<JobResult> results;    // In the order of the jobs
+    std::vector<WorkerStats> workers;  // What each worker did
+    std::chrono::nanoseconds elapsed;  // Host time of the whole run
+  };
+
+  // Runs every job on workers threads with run_work_stealing, one emulator per job. Workers go
+  // through many short lived emulators, so a fleet of a few thousand jobs keeps every core busy
+  // without ever holding more than workers emulators at once.
+  [[nodiscard]] FleetReport run_fleet(const std::vector<Job>& jobs,
+                                      unsigned int workers = default_workers());
+
+  // Totals of report: jobs by how they stopped, cycles, host time and throughput, and the tasks and
+  // steals of every worker
+  [[nodiscard]] std::string fleet_summary(const FleetReport& report);
+}  // namespace fleet
@@ -0,0 +1,203 @@
+#include <cctype>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fleet.h"
+
+namespace {
+  // Where to write the final screen of each job that asked for it, indexed like the jobs
+  using ScreenPaths = std::vector<std::string>;
+
+  // Key press or release of a script line: a hex digit and "down" or "up"
+  std::optional<input_events::Events> parse_key(const std::string& key, const std::string& action) {
+    if (key.size() != 1 || !std::isxdigit(static_cast<unsigned char>(key[0]))) {
+      return std::nullopt;
+    }
+    const auto digit = std::stoi(key, nullptr, 16);
+    if (action == "down") {
+      return static_cast<input_events::Events>(
+          static_cast<int>(input_events::Events::zero_pressed) + digit);
+    }
+    if (action == "up") {
+      return static_cast<input_events::Events>(
+          static_cast<int>(input_events::Events::zero_released) + digit);
+    }
+    return std::nullopt;
+  }
+
+  // Input script: one "<frame> <hex key> <down|up>" per line, blank lines and lines starting with
+  // # ignored. Events of the same frame are delivered in the order they are listed.
+  std::optional<std::vector<fleet::ScriptedInput>> read_input_script(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+      std::cerr << "Could not open " << path << std::endl;
+      return std::nullopt;
+    }
+    std::vector<fleet::ScriptedInput> input;
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); number++) {
+      std::istringstream fields(line);
+      std::string frame;
+      std::string key;
+      std::string action;
+      if (!(fields >> frame) || frame[0] == '#') {
+        continue;
+      }
+      fields >> key >> action;
+      const auto event = parse_key(key, action);
+      if (!event || frame.find_first_not_of("0123456789") != std::string::npos) {
+        std::cerr << std::format("{0}:{1}: expected <frame> <hex key> <down|up>", path, number)
+                  << std::endl;
+        return std::nullopt;
+      }
+      const auto at = static_cast<size_t>(std::stoull(frame));
+      if (!input.empty() && at < input.back().frame) {
+        std::cerr << std::format("{0}:{1}: frames must not go backwards", path, number)
+                  << std::endl;
+        return std::nullopt;
+      }
+      input.push_back({at, *event});
+    }
+    return input;
+  }
+
+  // Job list: one "<rom> <max cycles> [options]" per line, blank lines and lines starting with #
+  // ignored. Each ROM is read once however many jobs run it.
+  std::optional<std::vector<fleet::Job>> read_jobs(const std::string& path, ScreenPaths& screens) {
+    std::ifstream file(path);
+    if (!file) {
+      std::cerr << "Could not open " << path << std::endl;
+      return std::nullopt;
+    }
+    std::map<std::string, std::shared_ptr<const std::vector<unsigned char>>> programs;
+    std::vector<fleet::Job> jobs;
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); number++) {
+      std::istringstream fields(line);
+      std::string rom;
+      std::string cycles;
+      if (!(fields >> rom) || rom[0] == '#') {
+        continue;
+      }
+      const auto invalid = [&](const std::string& message) {
+        std::cerr << std::format("{0}:{1}: {2}", path, number, message) << std::endl;
+        return std::nullopt;
+      };
+      if (!(fields >> cycles) || cycles.find_first_not_of("0123456789") != std::string::npos) {
+        return invalid("expected <rom> <max cycles>");
+      }
+
+      fleet::Job job;
+      job.name = std::format("{0}:{1}", number, rom);
+      job.max_cycles = std::stoull(cycles);
+      std::string screen;
+      for (std::string option; fields >> option;) {
+        std::string value;
+        if (option == "--vip-timing") {
+          job.timing = arch::Timing::vip_cycles;
+        } else if (option == "--frames" && fields >> value) {
+          job.max_frames = static_cast<size_t>(std::stoull(value));
+        } else if (option == "--ips" && fields >> value) {
+          job.instructions_per_second = static_cast<unsigned int>(std::stoul(value));
+        } else if (option == "--input" && fields >> value) {
+          auto input = read_input_script(value);
+          if (!input) {
+            return invalid("bad input script " + value);
+          }
+          job.input = std::move(*input);
+        } else if (option == "--screen" && fields >> value) {
+          screen = value;
+          job.keep_screen = true;
+        } else {
+          return invalid("unknown option " + option);
+        }
+      }
+
+      auto& program = programs[rom];
+      if (!program) {
+        std::ifstream rom_file(rom, std::fstream::binary);
+        if (!rom_file) {
+          return invalid("could not open " + rom);
+        }
+        program = std::make_shared<const std::vector<unsigned char>>(
+            std::istreambuf_iterator<char>(rom_file), std::istreambuf_iterator<char>());
+      }
+      job.program = program;
+      jobs.push_back(std::move(job));
+      screens.push_back(screen);
+    }
+    return jobs;
+  }
+
+  // Writes screen as a plain PBM image, which most image viewers open
+  bool write_screen(const std::string& path, const display::Frame& screen) {
+    std::ofstream file(path);
+    file << "P1\n" << display::frame_width << ' ' << display::frame_height << '\n';
+    for (unsigned int y = 0; y < display::frame_height; y++) {
+      for (unsigned int x = 0; x < display::frame_width; x++) {
+        file << (screen.get_pixel(x, y) ? '1' : '0') << (x + 1 < display::frame_width ? ' ' : '\n');
+      }
+    }
+    return static_cast<bool>(file);
+  }
+}  // namespace
+
+// Runs every job of a job list in process on a pool of worker threads, and prints how each one
+// ended and a summary of the whole run
+int main(int argc, char** argv) {
+  auto valid = argc >= 2;
+  auto workers = fleet::default_workers();
+  for (auto i = 2; valid && i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--workers" && i + 1 < argc) {
+      workers = static_cast<unsigned int>(std::stoul(argv[++i]));
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid) {
+    std::string current_exec_name = argv[0];
+    std::cout << "Usage: " << current_exec_name << " < job list > [--workers < threads >]\n"
+              << "Job list lines: < rom > < max cycles > [--frames < frames >] [--ips < ips >]"
+                 " [--vip-timing] [--input < input script >] [--screen < pbm file >]\n"
+              << "Input script lines: < frame > < hex key > < down | up >" << std::endl;
+    return 1;
+  }
+
+  ScreenPaths screens;
+  const auto jobs = read_jobs(argv[1], screens);
+  if (!jobs) {
+    return 1;
+  }
+
+  const auto report = fleet::run_fleet(*jobs, workers);
+
+  auto trapped = false;
+  for (size_t i = 0; i < jobs->size(); i++) {
+    const auto& result = report.results[i];
+    std::cout << std::format("{0}  {1}  {2} frames  {3} cycles  screen {4:016x}  worker {5}",
+                             (*jobs)[i].name, fleet::stop_name(result.stop), result.frames,
+                             result.cycles, result.digest, result.worker);
+    if (result.stop == fleet::JobStop::trap) {
+      trapped = true;
+      std::cout << std::format("  {0} at {1:#05x} (opcode {2:#06x})",
+                               arch::fault_name(result.trap.fault), result.trap.pc,
+                               result.trap.opcode);
+    }
+    std::cout << '\n';
+    if (result.screen && !write_screen(screens[i], *result.screen)) {
+      std::cerr << "Could not write " << screens[i] << std::endl;
+    }
+  }
+  std::cout << '\n' << fleet::fleet_summary(report);
+  return trapped ? 1 : 0;
+}
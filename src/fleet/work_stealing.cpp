@@ -0,0 +1,106 @@
+#include "work_stealing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace {
+  // Tasks dealt to one worker. The owner takes from the front and thieves from the back, so they
+  // only contend over the last task.
+  class TaskQueue {
+  public:
+    void push(size_t index) { tasks.push_back(index); }
+
+    std::optional<size_t> pop() {
+      const std::lock_guard lock(mutex);
+      if (tasks.empty()) {
+        return std::nullopt;
+      }
+      const auto index = tasks.front();
+      tasks.pop_front();
+      return index;
+    }
+
+    std::optional<size_t> steal() {
+      const std::lock_guard lock(mutex);
+      if (tasks.empty()) {
+        return std::nullopt;
+      }
+      const auto index = tasks.back();
+      tasks.pop_back();
+      return index;
+    }
+
+  private:
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+}  // namespace
+
+unsigned int fleet::default_workers() noexcept {
+  return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+std::vector<fleet::WorkerStats> fleet::run_work_stealing(
+    size_t count, unsigned int workers,
+    const std::function<void(size_t index, unsigned int worker)>& task) {
+  workers = static_cast<unsigned int>(std::clamp<size_t>(count, 1, std::max(workers, 1U)));
+
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  for (unsigned int worker = 0; worker < workers; worker++) {
+    queues.push_back(std::make_unique<TaskQueue>());
+  }
+  for (size_t index = 0; index < count; index++) {
+    queues[index % workers]->push(index);
+  }
+
+  std::vector<WorkerStats> stats(workers, WorkerStats{0, 0});
+  std::atomic<bool> failed{false};
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+
+  const auto work = [&](unsigned int worker) {
+    auto& own = *queues[worker];
+    while (!failed.load(std::memory_order_relaxed)) {
+      auto index = own.pop();
+      // Look for a victim starting with the next worker, so thieves spread over the queues
+      for (unsigned int i = 1; !index && i < workers; i++) {
+        index = queues[(worker + i) % workers]->steal();
+        stats[worker].stolen += index ? 1 : 0;
+      }
+      if (!index) {
+        return;
+      }
+      try {
+        task(*index, worker);
+      } catch (...) {
+        const std::lock_guard lock(failure_mutex);
+        if (!failure) {
+          failure = std::current_exception();
+        }
+        failed = true;
+      }
+      stats[worker].tasks++;
+    }
+  };
+
+  // The calling thread is worker 0
+  std::vector<std::thread> threads;
+  for (unsigned int worker = 1; worker < workers; worker++) {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return stats;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace fleet {
+  // What one worker of run_work_stealing did
+  struct WorkerStats {
+    size_t tasks;   // Tasks the worker ran, including stolen ones
+    size_t stolen;  // Tasks the worker took from the queue of another
+  };
+
+  // Workers to use when none are asked for: one per hardware thread, at least one
+  [[nodiscard]] unsigned int default_workers() noexcept;
+
+  // Runs task(index, worker) once for every index below count on workers threads, and returns once
+  // all of them have finished. The indices are dealt round robin into a queue per worker. Workers
+  // run their own queue front to back and, once it is empty, steal from the back of the others, so
+  // a worker that drew slow tasks is helped out by those that drew fast ones. No task adds more
+  // work, so a worker stops the first time it finds every queue empty.
+  //
+  // The first exception a task throws is rethrown once every worker has stopped. Tasks not yet
+  // started when it was thrown are skipped.
+  std::vector<WorkerStats> run_work_stealing(
+      size_t count, unsigned int workers,
+      const std::function<void(size_t index, unsigned int worker)>& task);
+}  // namespace fleet
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "arch/graphics.h"
+#include "arch/latency.h"
+#include "arch/timers.h"
+#include "chip8.h"
+#include "display/frontend.h"
+#include "display/input_events.h"
+
+static_assert(display::frame_width == arch::graphics::screen_width
+                  && display::frame_height == arch::graphics::screen_height,
+              "Frames must hold the whole screen");
+
+// Host time spent in each phase of the frames run_frontend runs, measured with
+// std::chrono::steady_clock whatever clock the frontend keeps guest time with
+struct FramePhaseLatencies {
+  arch::LatencyHistogram input;    // Handling input, including blocking on FX0A for a key
+  arch::LatencyHistogram emulate;  // Chip8::run_frame
+  arch::LatencyHistogram pixels;   // Copying the screen into a frame, when it changed
+  arch::LatencyHistogram present;  // Frontend::present_frame, when the screen changed
+  arch::LatencyHistogram delay;    // Sleeping out the rest of the frame
+  arch::LatencyHistogram frame;    // Every phase together
+};
+
+// latency_line of every phase
+inline std::string frame_latency_report(const FramePhaseLatencies& latencies) {
+  return arch::latency_line("input", latencies.input)
+         + arch::latency_line("emulate", latencies.emulate)
+         + arch::latency_line("pixels", latencies.pixels)
+         + arch::latency_line("present", latencies.present)
+         + arch::latency_line("delay", latencies.delay)
+         + arch::latency_line("frame", latencies.frame);
+}
+
+// Records the host time between consecutive laps into a phase of FramePhaseLatencies. Does nothing
+// without latencies to record into.
+class PhaseTimer {
+public:
+  explicit PhaseTimer(FramePhaseLatencies* latencies) : latencies(latencies) {}
+
+  // Starts timing a frame
+  void start() {
+    if (latencies != nullptr) {
+      frame_start = last = std::chrono::steady_clock::now();
+    }
+  }
+
+  // Records the time since the previous lap, or since start, into phase
+  void lap(arch::LatencyHistogram FramePhaseLatencies::*phase) {
+    if (latencies != nullptr) {
+      const auto now = std::chrono::steady_clock::now();
+      (latencies->*phase).record(now - last);
+      last = now;
+    }
+  }
+
+  // Records the time since start as a whole frame
+  void finish() {
+    if (latencies != nullptr) {
+      latencies->frame.record(std::chrono::steady_clock::now() - frame_start);
+    }
+  }
+
+private:
+  FramePhaseLatencies* latencies;
+  std::chrono::steady_clock::time_point frame_start;
+  std::chrono::steady_clock::time_point last;
+};
+
+// How run_frontend runs
+struct FrontendOptions {
+  size_t max_frames = 0;  // Frames to run before returning, 0 to run until the frontend quits
+
+  // Instructions per second with arch::Timing::instructions, see Chip8::run_frame
+  unsigned int instructions_per_second = arch::default_instructions_per_second;
+
+  // Where to record the host time of each phase of every frame, nullptr to not time them
+  FramePhaseLatencies* phase_latencies = nullptr;
+};
+
+// Why run_frontend returned
+enum class FrontendStop {
+  frame_limit,  // max_frames frames ran
+  quit,         // The frontend delivered input_events::Events::quit
+  trap,         // An instruction faulted, see Chip8::trap
+};
+
+// Outcome of run_frontend
+struct FrontendResult {
+  size_t frames;      // 60 Hz frames that passed, including those spent waiting for a key
+  size_t cycles;      // Cycles emulated
+  FrontendStop stop;  // Why the loop ended
+};
+
+// Copies the screen of emulator into a frame
+template <class Emulator>
+display::Frame read_frame(const Emulator& emulator) {
+  display::Frame frame;
+  for (unsigned int y = 0; y < display::frame_height; y++) {
+    for (unsigned int x = 0; x < display::frame_width; x++) {
+      frame.set_pixel(x, y, emulator.get_pixel(x, y));
+    }
+  }
+  return frame;
+}
+
+// FNV-1a over the pixels of frame, so runs can be compared without looking at them
+inline unsigned long long frame_digest(const display::Frame& frame) {
+  unsigned long long hash = 0xCBF29CE484222325;
+  for (unsigned int y = 0; y < display::frame_height; y++) {
+    for (unsigned int x = 0; x < display::frame_width; x++) {
+      hash = (hash ^ static_cast<unsigned int>(frame.get_pixel(x, y))) * 0x100000001B3;
+    }
+  }
+  return hash;
+}
+
+// Runs emulator in 60 Hz frames against frontend: delivers its input, emulates a frame of guest
+// time, presents the screen if it changed and sleeps for the rest of the frame. The frontend is a
+// template parameter, so the loop is compiled separately for each one and calls it directly.
+template <display::Frontend F, class Emulator>
+FrontendResult run_frontend(Emulator& emulator, F& frontend, const FrontendOptions& options = {}) {
+  constexpr std::chrono::nanoseconds frame_period
+      = std::chrono::nanoseconds(std::chrono::seconds(1)) / arch::timer_frequency;
+  FrontendResult result{0, 0, FrontendStop::frame_limit};
+  PhaseTimer timer(options.phase_latencies);
+
+  for (; options.max_frames == 0 || result.frames < options.max_frames; result.frames++) {
+    timer.start();
+    const auto start = frontend.now();
+
+    // Handle every input event that arrived since the last frame
+    for (auto event = frontend.poll_input(); event != input_events::Events::none;
+         event = frontend.poll_input()) {
+      if (event == input_events::Events::quit) {
+        result.stop = FrontendStop::quit;
+        return result;
+      }
+      emulator.handle_keys(event);
+    }
+
+    // Nothing runs until FX0A gets a key, so sleep on the input instead of spinning. A frame
+    // without a key only ticks the timers, which keep counting down at 60 Hz.
+    for (auto elapsed = frontend.now() - start;
+         emulator.waiting_for_key() && elapsed < frame_period; elapsed = frontend.now() - start) {
+      const auto event = frontend.wait_for_input(frame_period - elapsed);
+      if (event == input_events::Events::quit) {
+        result.stop = FrontendStop::quit;
+        return result;
+      }
+      emulator.handle_keys(event);
+    }
+    timer.lap(&FramePhaseLatencies::input);
+    if (emulator.waiting_for_key()) {
+      emulator.tick_timers();
+      timer.finish();
+      continue;
+    }
+
+    const auto frame = emulator.run_frame(options.instructions_per_second);
+    result.cycles += frame.cycles;
+    timer.lap(&FramePhaseLatencies::emulate);
+
+    if (frame.stop == StopReason::trap) {
+      result.frames++;
+      result.stop = FrontendStop::trap;
+      return result;
+    }
+
+    if (frame.screen_changed) {
+      const auto pixels = read_frame(emulator);
+      timer.lap(&FramePhaseLatencies::pixels);
+      frontend.present_frame(pixels);
+      timer.lap(&FramePhaseLatencies::present);
+    }
+
+    // Cap frame rate if necessary
+    const auto elapsed = frontend.now() - start;
+    if (elapsed < frame_period) {
+      frontend.sleep(frame_period - elapsed);
+    }
+    timer.lap(&FramePhaseLatencies::delay);
+    timer.finish();
+  }
+  return result;
+}
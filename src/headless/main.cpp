@@ -0,0 +1,121 @@
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "chip8.h"
+#include "display/null_frontend.h"
+#include "frontend_loop.h"
+
+// Runs a ROM for a number of 60 Hz frames without a display or input, as fast as the host allows,
+// and prints how long it took and a digest of the final screen
+int main(int argc, char** argv) {
+  auto valid = argc >= 3;
+  auto vip_timing = false;
+  auto fused = false;
+#if defined(CHIP8_PROFILER)
+  unsigned int profile_period = 1;  // Guest time units between samples, 1 counts exactly
+#endif
+#if defined(CHIP8_TRACE)
+  std::string trace_path;  // Where to dump the trace at exit, next to the ROM on a fault if empty
+#endif
+  for (auto i = 3; valid && i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--vip-timing") {
+      vip_timing = true;
+    } else if (arg == "--fused") {
+      fused = true;
+#if defined(CHIP8_PROFILER)
+    } else if (arg == "--profile-period" && i + 1 < argc) {
+      profile_period = static_cast<unsigned int>(std::stoul(argv[++i]));
+#endif
+#if defined(CHIP8_TRACE)
+    } else if (arg == "--trace" && i + 1 < argc) {
+      trace_path = argv[++i];
+#endif
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid) {
+    std::string current_exec_name = argv[0];
+    std::cout << "Usage: " << current_exec_name
+              << " < path to rom to run > < frames > [--vip-timing] [--fused]"
+#if defined(CHIP8_PROFILER)
+              << " [--profile-period < guest time units >]"
+#endif
+#if defined(CHIP8_TRACE)
+              << " [--trace < trace file >]"
+#endif
+              << std::endl;
+    return 1;
+  }
+
+  std::string rom_path = argv[1];
+  if (!std::ifstream(rom_path)) {
+    std::cerr << "Could not open " << rom_path << std::endl;
+    return 1;
+  }
+
+  FrontendOptions options;
+  options.max_frames = std::stoull(argv[2]);
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  FramePhaseLatencies phase_latencies;
+  options.phase_latencies = &phase_latencies;
+#endif
+
+  display::NullFrontend frontend;
+  BasicChip8<arch::DefaultAccess> emulator(rom_path);
+  if (vip_timing) {
+    emulator.set_timing(arch::Timing::vip_cycles);
+  }
+  emulator.set_fusion(fused);
+#if defined(CHIP8_OPCODE_COUNTERS) || defined(CHIP8_LATENCY_HISTOGRAMS) || defined(CHIP8_TRACE)
+  // Translated code is neither counted, timed nor traced, so keep every instruction in an
+  // instrumented tier
+  emulator.force_tier(arch::Tier::predecoded);
+#endif
+#if defined(CHIP8_PROFILER)
+  emulator.guest_profiler().set_sample_period(profile_period);
+#endif
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = run_frontend(emulator, frontend, options);
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << std::format("{0} frames, {1} cycles, {2} frames presented in {3:.3f} s\n",
+                           result.frames, result.cycles, frontend.frames_presented,
+                           elapsed.count());
+  std::cout << std::format("Screen digest {0:016x}\n", frame_digest(read_frame(emulator)));
+  if (fused) {
+    std::cerr << '\n' << arch::fusion_report(emulator.fusion_counters());
+  }
+#if defined(CHIP8_OPCODE_COUNTERS)
+  std::cerr << '\n' << arch::opcode_report(emulator.opcode_counters());
+#endif
+#if defined(CHIP8_PROFILER)
+  std::cerr << '\n' << emulator.profile_report();
+#endif
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  std::cerr << '\n'
+            << frame_latency_report(phase_latencies) << '\n'
+            << arch::handler_latency_report(emulator.handler_latencies());
+#endif
+#if defined(CHIP8_TRACE)
+  if (result.stop == FrontendStop::trap && trace_path.empty()) {
+    trace_path = rom_path + ".trace";
+  }
+  if (!trace_path.empty() && emulator.dump_trace(trace_path)) {
+    std::cerr << "Trace written to " << trace_path << std::endl;
+  }
+#endif
+
+  if (result.stop == FrontendStop::trap) {
+    const auto& trap = emulator.trap();
+    std::cerr << std::format("ROM stopped with {0} at {1:#05x} (opcode {2:#06x})",
+                             arch::fault_name(trap.fault), trap.pc, trap.opcode)
+              << std::endl;
+    return 1;
+  }
+}
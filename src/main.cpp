@@ -1,71 +1,62 @@
+#include <format>
 #include <iostream>
 #include <string>
 
 #include "chip8.h"
-#include "display/display.h"
-#include "display/input_events.h"
+#include "display/sdl_frontend.h"
+#include "frontend_loop.h"
 
 constexpr unsigned int SCALING_FACTOR = 20;
-constexpr unsigned int WINDOW_WIDTH
-    = arch::graphics::screen_width * SCALING_FACTOR;  // Width of screen in px
-constexpr unsigned int WINDOW_HEIGHT
-    = arch::graphics::screen_height * SCALING_FACTOR;  // Height of screen in px
-constexpr float ms_per_frame = 1.0f / 60.f * 1000.0f;  // Minimum time per frame
 
 int main(int argc, char** argv) {
-  if (argc != 2) {
+  // --vip-timing runs every instruction for as long as it took on the COSMAC VIP
+  const auto vip_timing = argc == 3 && std::string(argv[2]) == "--vip-timing";
+  if (argc != 2 && !vip_timing) {
     std::string current_exec_name = argv[0];
-    std::cout << "Usage: " << current_exec_name << " < path to rom to run > " << std::endl;
+    std::cout << "Usage: " << current_exec_name << " < path to rom to run > [--vip-timing]"
+              << std::endl;
     return 1;
   }
 
   std::string rom_path = argv[1];
 
-  display::Display display(WINDOW_WIDTH, WINDOW_HEIGHT);
-  Chip8 emulator(rom_path);
-
-  // Performance measurement
-  long long time_per_frame_ms = 0;
-
-  while (1) {
-    auto start = display.get_performance_counter();
-
-    const enum input_events::Events inputted_event = display.handle_input();
-
-    if (inputted_event == input_events::Events::quit) {
-      break;
-    }
-
-    emulator.handle_keys(inputted_event);
-
-    emulator.emulate_cycle();
-
-    if (emulator.should_draw()) {
-      for (auto x = 0; x < arch::graphics::screen_width; x++) {
-        for (auto y = 0; y < arch::graphics::screen_height; y++) {
-          const auto pix = emulator.get_pixel(x, y);
-          if (pix) {
-            display.draw_scaled_pixel(255, 255, 255, x, y, SCALING_FACTOR);  // Color white
-          } else {
-            display.draw_scaled_pixel(0, 0, 0, x, y, SCALING_FACTOR);  // Colour black
-          }
-        }
-      }
-      display.render_display();
-      auto end = display.get_performance_counter();
-      time_per_frame_ms += (end - start);
-
-      auto elapsed_ms = static_cast<float>(time_per_frame_ms)
-                        / static_cast<float>(display.get_performance_frequency()) * 1000.0f;
-      // Cap frame rate if necessary
-      if (elapsed_ms < ms_per_frame) {
-        display.delay(static_cast<unsigned int>(ms_per_frame - elapsed_ms));
-      }
-
-      time_per_frame_ms = 0;  // Reset counter
-    } else {
-      auto end = display.get_performance_counter();
-      time_per_frame_ms += (end - start);
+  display::SdlFrontend frontend(SCALING_FACTOR);
+  BasicChip8<arch::DefaultAccess> emulator(rom_path);
+  if (vip_timing) {
+    emulator.set_timing(arch::Timing::vip_cycles);
+  }
+#if defined(CHIP8_OPCODE_COUNTERS) || defined(CHIP8_LATENCY_HISTOGRAMS) || defined(CHIP8_TRACE)
+  // Translated code is neither counted, timed nor traced, so keep every instruction in an
+  // instrumented tier
+  emulator.force_tier(arch::Tier::predecoded);
+#endif
+
+  FrontendOptions options;
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  FramePhaseLatencies phase_latencies;
+  options.phase_latencies = &phase_latencies;
+#endif
+  const auto result = run_frontend(emulator, frontend, options);
+#if defined(CHIP8_OPCODE_COUNTERS)
+  std::cerr << arch::opcode_report(emulator.opcode_counters());
+#endif
+#if defined(CHIP8_PROFILER)
+  std::cerr << emulator.profile_report();
+#endif
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+  std::cerr << frame_latency_report(phase_latencies)
+            << arch::handler_latency_report(emulator.handler_latencies());
+#endif
+  if (result.stop == FrontendStop::trap) {
+    const auto& trap = emulator.trap();
+    std::cerr << std::format("ROM stopped with {0} at {1:#05x} (opcode {2:#06x})",
+                             arch::fault_name(trap.fault), trap.pc, trap.opcode)
+              << std::endl;
+#if defined(CHIP8_TRACE)
+    if (emulator.dump_trace(rom_path + ".trace")) {
+      std::cerr << "Trace written to " << rom_path << ".trace" << std::endl;
     }
+#endif
+    return 1;
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include "trace.h"
+
+namespace {
+  // Read only view of a whole file. Mapped where the platform allows, so that opening a trace of
+  // millions of records costs nothing until the records looked at are paged in.
+  class MappedFile {
+  public:
+    explicit MappedFile(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+      const auto fd = open(path.c_str(), O_RDONLY);
+      if (fd >= 0) {
+        struct stat status {};
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+          auto* address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ,
+                               MAP_PRIVATE, fd, 0);
+          if (address != MAP_FAILED) {
+            mapped = static_cast<const unsigned char*>(address);
+            length = static_cast<size_t>(status.st_size);
+          }
+        }
+        close(fd);
+      }
+      if (mapped != nullptr) {
+        return;
+      }
+#endif
+      std::ifstream file(path, std::fstream::binary);
+      copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      length = copy.size();
+    }
+
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+      if (mapped != nullptr) {
+        munmap(const_cast<unsigned char*>(mapped), length);
+      }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const unsigned char* data() const noexcept {
+      return mapped != nullptr ? mapped : copy.data();
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return length; }
+
+  private:
+    const unsigned char* mapped = nullptr;
+    size_t length = 0;
+    std::vector<unsigned char> copy;  // The file contents where it could not be mapped
+  };
+
+  struct Options {
+    std::string path;
+    std::optional<unsigned short> pc;        // Only records of this address
+    unsigned long long from = 0;             // First cycle to show
+    std::optional<unsigned long long> to;    // Last cycle to show
+    std::optional<unsigned long long> last;  // Only the last this many cycles of the range
+  };
+
+  std::optional<Options> parse_options(int argc, char** argv) {
+    if (argc < 2) {
+      return std::nullopt;
+    }
+    Options options;
+    options.path = argv[1];
+    for (auto i = 2; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (i + 1 >= argc) {
+        return std::nullopt;
+      }
+      if (arg == "--pc") {
+        options.pc = static_cast<unsigned short>(std::stoul(argv[++i], nullptr, 16));
+      } else if (arg == "--from") {
+        options.from = std::stoull(argv[++i]);
+      } else if (arg == "--to") {
+        options.to = std::stoull(argv[++i]);
+      } else if (arg == "--last") {
+        options.last = std::stoull(argv[++i]);
+      } else {
+        return std::nullopt;
+      }
+    }
+    return options;
+  }
+}  // namespace
+
+// Prints the records of a trace file dumped by the emulator, disassembled, optionally only those
+// of one address or of a range of cycles
+int main(int argc, char** argv) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::string current_exec_name = argv[0];
+    std::cout << "Usage: " << current_exec_name
+              << " < trace file > [--pc < hex address >] [--from < cycle >] [--to < cycle >]"
+                 " [--last < cycles >]"
+              << std::endl;
+    return 1;
+  }
+
+  const MappedFile file(options->path);
+  arch::TraceFileHeader header{};
+  if (file.size() < sizeof(header)) {
+    std::cerr << options->path << " is not a trace file" << std::endl;
+    return 1;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != arch::trace_magic || header.version != arch::trace_version
+      || header.record_size != sizeof(arch::TraceRecord)
+      || (file.size() - sizeof(header)) / sizeof(arch::TraceRecord) < header.count) {
+    std::cerr << options->path << " is not a trace file this version can read" << std::endl;
+    return 1;
+  }
+
+  // Records are in cycle order with no gaps, so any cycle is found by its offset
+  const auto end_cycle = header.first_cycle + header.count;
+  auto begin = std::max(options->from, header.first_cycle);
+  auto end = options->to ? std::min(*options->to + 1, end_cycle) : end_cycle;
+  if (options->last && end > begin && end - begin > *options->last) {
+    begin = end - *options->last;
+  }
+
+  const auto* records = file.data() + sizeof(header);
+  for (auto cycle = begin; cycle < end; cycle++) {
+    arch::TraceRecord record{};
+    std::memcpy(&record, records + (cycle - header.first_cycle) * sizeof(record), sizeof(record));
+    if (options->pc && record.pc != *options->pc) {
+      continue;
+    }
+    std::cout << arch::trace_record_line(cycle, record) << '\n';
+  }
+}
@@ -0,0 +1,111 @@
+#include "aot.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+// Generated from roms/pong.rom by chip8_aot at build time
+extern const arch::AotProgram pong_aot;
+
+namespace {
+  struct Machine {
+    arch::CPU cpu{};
+    arch::Memory mem{};
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+
+    explicit Machine(const arch::AotProgram& program) {
+      for (size_t i = 0; i < chip8_fontset.size(); i++) {
+        mem.set_value(static_cast<unsigned short>(i), chip8_fontset[i]);
+      }
+      for (size_t i = 0; i < program.rom_size; i++) {
+        mem.set_value(static_cast<unsigned short>(arch::pc_start_value + i), program.rom[i]);
+      }
+    }
+  };
+
+  void expect_same_state(const Machine& expected, const Machine& actual) {
+    EXPECT_EQ(expected.cpu.pc_reg, actual.cpu.pc_reg);
+    EXPECT_EQ(expected.cpu.index_reg, actual.cpu.index_reg);
+    EXPECT_EQ(expected.cpu.curr_opcode, actual.cpu.curr_opcode);
+    EXPECT_EQ(expected.cpu.get_stack_pointer(), actual.cpu.get_stack_pointer());
+    EXPECT_EQ(expected.cpu.delay_timer_reg, actual.cpu.delay_timer_reg);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(expected.cpu.get_general_reg(reg), actual.cpu.get_general_reg(reg));
+    }
+    for (unsigned short address = 0; address <= arch::max_mem_address; address++) {
+      ASSERT_EQ(expected.mem.get_value(address), actual.mem.get_value(address));
+    }
+    for (size_t y = 0; y < arch::graphics::screen_height; y++) {
+      for (size_t x = 0; x < arch::graphics::screen_width; x++) {
+        ASSERT_EQ(expected.graphics.get_pixel(x, y), actual.graphics.get_pixel(x, y));
+      }
+    }
+  }
+}  // namespace
+
+TEST(aot_test, find_blocks_splits_at_control_flow) {
+  // 0x200: 6005 (V0 = 5)
+  // 0x202: 3005 (skip if V0 == 5)
+  // 0x204: 120A (jump to 0x20A)
+  // 0x206: 7001 (V0 += 1)
+  // 0x208: 00EE (return)
+  // 0x20A: 2206 (call 0x206)
+  // 0x20C: 0000 (invalid)
+  const std::vector<unsigned char> rom{0x60, 0x05, 0x30, 0x05, 0x12, 0x0A, 0x70,
+                                       0x01, 0x00, 0xEE, 0x22, 0x06, 0x00, 0x00};
+  const auto blocks = arch::find_aot_blocks(rom);
+
+  ASSERT_EQ(blocks.size(), 4);
+  EXPECT_EQ(blocks[0].address, 0x200);
+  EXPECT_EQ(blocks[0].opcodes, (std::vector<unsigned short>{0x6005, 0x3005}));
+  EXPECT_EQ(blocks[1].address, 0x204);
+  EXPECT_EQ(blocks[1].opcodes, (std::vector<unsigned short>{0x120A}));
+  EXPECT_EQ(blocks[2].address, 0x206);
+  EXPECT_EQ(blocks[2].opcodes, (std::vector<unsigned short>{0x7001, 0x00EE}));
+  EXPECT_EQ(blocks[3].address, 0x20A);
+  EXPECT_EQ(blocks[3].opcodes, (std::vector<unsigned short>{0x2206}));
+}
+
+TEST(aot_test, compiled_rom_matches_interpreter) {
+  Machine expected(pong_aot);
+  Machine actual(pong_aot);
+  arch::AotEngine engine(pong_aot);
+
+  // Uneven counts so that blocks are also cut off by the budget
+  size_t compiled = 0;
+  for (size_t count : {1, 7, 100, 1000, 12345, 50000}) {
+    expected.cpu.try_run(expected.mem, expected.graphics, expected.keypad, count);
+    compiled += engine.run(actual.cpu, actual.mem, actual.graphics, actual.keypad, count);
+    expect_same_state(expected, actual);
+    EXPECT_EQ(expected.cpu.updated_screen, actual.cpu.updated_screen);
+
+    expected.cpu.delay_timer_reg = 0;
+    actual.cpu.delay_timer_reg = 0;
+  }
+  EXPECT_GT(compiled, 0);
+}
+
+TEST(aot_test, overwritten_code_is_interpreted) {
+  Machine expected(pong_aot);
+  Machine actual(pong_aot);
+  arch::AotEngine engine(pong_aot);
+
+  // Replace the first instruction with 6F42 (VF = 0x42)
+  for (auto* machine : {&expected, &actual}) {
+    machine->mem.set_value(0x200, 0x6F);
+    machine->mem.set_value(0x201, 0x42);
+  }
+  engine.invalidate(0x200);
+
+  expected.cpu.try_run(expected.mem, expected.graphics, expected.keypad, 1);
+  EXPECT_EQ(engine.run(actual.cpu, actual.mem, actual.graphics, actual.keypad, 1), 0);
+  EXPECT_EQ(actual.cpu.get_general_reg(0xF), 0x42);
+  expect_same_state(expected, actual);
+}
@@ -0,0 +1,208 @@
+#include "chip8.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(chip8_test, run_cycles_runs_every_cycle) {
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+
+  const auto result = emulator.run_cycles(100);
+
+  EXPECT_EQ(result.cycles, 100);
+  EXPECT_FALSE(result.screen_changed);
+  EXPECT_EQ(result.stop, StopReason::cycle_limit);
+}
+
+TEST(chip8_test, run_cycles_hands_engine_whole_batches) {
+  // 0x200: 7001 (V0 += 1), 0x202: 7102 (V1 += 2), 0x204: 7203 (V2 += 3), 0x206: 1200 (jump to
+  // 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x71, 0x02, 0x72, 0x03, 0x12, 0x00});
+  emulator.force_tier(arch::Tier::translated);
+
+  // The loop is one translated block of 4 instructions, which only runs translated when the engine
+  // is given at least 4 instructions at a time. The first frame is 12 cycles at 700 per second.
+  const auto result = emulator.run_cycles(12);
+  EXPECT_EQ(result.cycles, 12);
+  EXPECT_EQ(result.stop, StopReason::cycle_limit);
+  EXPECT_EQ(emulator.next_timer_event(), 12);
+#if !defined(CHIP8_PROFILER)
+  // Profiled builds hand the engine one instruction at a time to time every address
+  if (arch::Jit::available()) {
+    EXPECT_EQ(emulator.tier_counters().translated, 12);
+    EXPECT_EQ(emulator.tier_counters().predecoded, 0);
+  }
+#endif
+}
+
+TEST(chip8_test, run_until_draw_stops_at_draw) {
+  // 0x200: 6105 (V1 = 5), 0x202: A000 (I = sprite for 0), 0x204: D115 (draw at V1, V1),
+  // 0x206: 1206 (jump to 0x206)
+  Chip8 emulator(std::vector<unsigned char>{0x61, 0x05, 0xA0, 0x00, 0xD1, 0x15, 0x12, 0x06});
+
+  auto result = emulator.run_until_draw();
+  EXPECT_EQ(result.cycles, 3);
+  EXPECT_TRUE(result.screen_changed);
+  EXPECT_EQ(result.stop, StopReason::draw);
+  EXPECT_TRUE(emulator.should_draw());
+  EXPECT_TRUE(emulator.get_pixel(5, 5));
+  EXPECT_FALSE(emulator.get_pixel(4, 5));
+
+  result = emulator.run_until_draw(1000);
+  EXPECT_EQ(result.cycles, 1000);
+  EXPECT_FALSE(result.screen_changed);
+  EXPECT_EQ(result.stop, StopReason::cycle_limit);
+  EXPECT_FALSE(emulator.should_draw());
+}
+
+TEST(chip8_test, run_stops_while_waiting_for_key) {
+  // 0x200: F00A (wait for key into V0), 0x202: 1202 (jump to 0x202)
+  Chip8 emulator(std::vector<unsigned char>{0xF0, 0x0A, 0x12, 0x02});
+
+  auto result = emulator.run_cycles(10);
+  EXPECT_EQ(result.cycles, 1);
+  EXPECT_EQ(result.stop, StopReason::waiting_for_key);
+  EXPECT_TRUE(emulator.waiting_for_key());
+
+  result = emulator.run_cycles(10);
+  EXPECT_EQ(result.cycles, 0);
+
+  emulator.handle_keys(input_events::Events::five_pressed);
+  EXPECT_FALSE(emulator.waiting_for_key());
+
+  result = emulator.run_cycles(10);
+  EXPECT_EQ(result.cycles, 10);
+  EXPECT_EQ(result.stop, StopReason::cycle_limit);
+}
+
+TEST(chip8_test, run_frame_carries_fractional_cycles) {
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+
+  // 700 instructions per second is 11 and 2/3 per frame, and each frame ends on the cycle the
+  // timers tick on
+  EXPECT_EQ(emulator.run_frame(700).cycles, 12);
+  EXPECT_EQ(emulator.run_frame(700).cycles, 12);
+  EXPECT_EQ(emulator.run_frame(700).cycles, 11);
+  EXPECT_EQ(emulator.run_frame(60).cycles, 1);
+  EXPECT_EQ(emulator.instructions_per_second(), 60);
+}
+
+TEST(chip8_test, timers_follow_emulated_time) {
+  // 0x200: 603C (V0 = 60), 0x202: F015 (delay timer = V0), 0x204: F007 (V0 = delay timer),
+  // 0x206: 3000 (skip if V0 == 0), 0x208: 1204 (jump to 0x204), 0x20A: D005 (draw at V0, V0),
+  // 0x20C: 120C (jump to 0x20C)
+  const std::vector<unsigned char> program{0x60, 0x3C, 0xF0, 0x15, 0xF0, 0x07, 0x30,
+                                           0x00, 0x12, 0x04, 0xD0, 0x05, 0x12, 0x0C};
+
+  // The 60 ticks of a second take 700 cycles at 700 instructions per second and twice as many
+  // when the CPU runs twice as fast. The draw is the third cycle after the F007 that reads 0.
+  Chip8 emulator(program);
+  EXPECT_EQ(emulator.instructions_per_second(), arch::default_instructions_per_second);
+  EXPECT_EQ(emulator.run_until_draw().cycles, 704);
+
+  Chip8 fast_emulator(program);
+  fast_emulator.set_instructions_per_second(1400);
+  EXPECT_EQ(fast_emulator.run_until_draw().cycles, 1403);
+}
+
+TEST(chip8_test, next_timer_event_counts_down_to_tick) {
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+
+  EXPECT_EQ(emulator.next_timer_event(), 12);
+  emulator.run_cycles(5);
+  EXPECT_EQ(emulator.next_timer_event(), 7);
+  emulator.run_cycles(7);
+  EXPECT_EQ(emulator.next_timer_event(), 12);
+}
+
+TEST(chip8_test, vip_timing_runs_frames_by_cost) {
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+  emulator.set_timing(arch::Timing::vip_cycles);
+  EXPECT_EQ(emulator.timing(), arch::Timing::vip_cycles);
+
+  // An iteration is 102 machine cycles, and the frame ends with the instruction the tick lands in
+  const auto frame_cycles = arch::vip_cycles_per_second / arch::timer_frequency;
+  const auto iteration = arch::instruction_cycles(0x7001, 0, false)
+                         + arch::instruction_cycles(0x1200, 0, false);
+  EXPECT_EQ(emulator.next_timer_event(), frame_cycles);
+  const auto frame = emulator.run_frame();
+  EXPECT_EQ(frame.cycles, 2 * (frame_cycles / iteration + 1));
+  EXPECT_EQ(emulator.guest_cycles(), (frame_cycles / iteration + 1) * iteration);
+  EXPECT_EQ(emulator.next_timer_event(), frame_cycles - (emulator.guest_cycles() - frame_cycles));
+}
+
+TEST(chip8_test, vip_timing_batches_match_single_steps) {
+  // 0x200: 7001 (V0 += 1), 0x202: 3005 (skip if V0 == 5), 0x204: 1200 (jump to 0x200),
+  // 0x206: 6000 (V0 = 0), 0x208: 1200 (jump to 0x200)
+  const std::vector<unsigned char> program{0x70, 0x01, 0x30, 0x05, 0x12,
+                                           0x00, 0x60, 0x00, 0x12, 0x00};
+  Chip8 batched(program);
+  Chip8 stepped(program);
+  batched.set_timing(arch::Timing::vip_cycles);
+  stepped.set_timing(arch::Timing::vip_cycles);
+  batched.force_tier(arch::Tier::translated);
+
+  // Translated blocks that end in a taken skip still cost the skip, and no block runs past a tick
+  for (auto frame = 0; frame < 10; frame++) {
+    const auto frame_cycles = batched.run_frame().cycles;
+    size_t steps = 0;
+    while (stepped.guest_cycles() < batched.guest_cycles()) {
+      stepped.emulate_cycle();
+      steps++;
+    }
+    EXPECT_EQ(frame_cycles, steps);
+    EXPECT_EQ(stepped.guest_cycles(), batched.guest_cycles());
+    EXPECT_EQ(stepped.next_timer_event(), batched.next_timer_event());
+  }
+}
+
+TEST(chip8_test, vip_timing_slows_down_drawing) {
+  // 0x200: D015 (draw at V0, V0), 0x202: 1200 (jump to 0x200)
+  Chip8 draws(std::vector<unsigned char>{0xD0, 0x15, 0x12, 0x00});
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 adds(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+  draws.set_timing(arch::Timing::vip_cycles);
+  adds.set_timing(arch::Timing::vip_cycles);
+
+  EXPECT_LT(draws.run_frame().cycles, adds.run_frame().cycles);
+}
+
+TEST(chip8_test, vip_timing_ticks_timers_by_machine_cycles) {
+  // 0x200: 603C (V0 = 60), 0x202: F015 (delay timer = V0), 0x204: F007 (V0 = delay timer),
+  // 0x206: 3000 (skip if V0 == 0), 0x208: 1204 (jump to 0x204), 0x20A: D005 (draw at V0, V0),
+  // 0x20C: 120C (jump to 0x20C)
+  Chip8 emulator(std::vector<unsigned char>{0x60, 0x3C, 0xF0, 0x15, 0xF0, 0x07, 0x30, 0x00, 0x12,
+                                            0x04, 0xD0, 0x05, 0x12, 0x0C});
+  emulator.set_timing(arch::Timing::vip_cycles);
+
+  // The delay loop is skipped up to each tick, so every frame ends on one and the timer runs out
+  // at the end of the 60th. The draw happens in the next frame, which ends on its last instruction.
+  size_t frames = 1;
+  while (!emulator.run_frame().screen_changed) {
+    frames++;
+  }
+  EXPECT_EQ(frames, 61);
+  const unsigned long long frame_cycles = arch::vip_cycles_per_second / arch::timer_frequency;
+  EXPECT_GE(emulator.guest_cycles(), 61 * frame_cycles);
+  EXPECT_LT(emulator.guest_cycles(),
+            61 * frame_cycles + arch::instruction_cycles(0x120C, 0, false));
+}
+
+TEST(chip8_test, run_stops_at_trap) {
+  // 0x200: 7001 (V0 += 1), 0x202: FFFF (invalid)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0xFF, 0xFF});
+
+  auto result = emulator.run_cycles(10);
+  EXPECT_EQ(result.cycles, 2);
+  EXPECT_EQ(result.stop, StopReason::trap);
+  EXPECT_EQ(emulator.trap().fault, arch::Fault::invalid_instruction);
+  EXPECT_EQ(emulator.trap().pc, 0x202);
+
+  result = emulator.run_cycles(10);
+  EXPECT_EQ(result.cycles, 0);
+  EXPECT_EQ(result.stop, StopReason::trap);
+}
@@ -5,6 +5,8 @@
 #include <array>
 #include <random>
 
+#include "graphics.h"
+#include "keypad.h"
 #include "memory.h"
 
 TEST(cpu_test, get_first_general_reg) {
@@ -293,3 +295,311 @@ TEST(cpu_test, set_stack_pointer_val_too_big) {
     SUCCEED();
   }
 }
+
+TEST(cpu_test, step_executes_and_caches_instruction) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  mem.set_value(0x200, 0x63);
+  mem.set_value(0x201, 0x2F);
+
+  cpu.step(mem, graphics, keypad);
+
+  EXPECT_EQ(cpu.curr_opcode, 0x632F);
+  EXPECT_EQ(cpu.pc_reg, 0x202);
+  EXPECT_EQ(cpu.get_general_reg(0x3), 0x2F);
+  ASSERT_NE(mem.get_decoded(0x200), nullptr);
+  EXPECT_EQ(mem.get_decoded(0x200)->opcode, 0x632F);
+}
+
+TEST(cpu_test, step_reuses_cached_instruction) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  // 0x200: 7101 (V1 += 1), 0x202: 1200 (jump to 0x200)
+  mem.set_value(0x200, 0x71);
+  mem.set_value(0x201, 0x01);
+  mem.set_value(0x202, 0x12);
+  mem.set_value(0x203, 0x00);
+
+  for (auto i = 0; i < 20; i++) {
+    cpu.step(mem, graphics, keypad);
+  }
+
+  EXPECT_EQ(cpu.get_general_reg(0x1), 10);
+  EXPECT_EQ(cpu.pc_reg, 0x200);
+}
+
+TEST(cpu_test, step_sees_self_modifying_write) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  // 0x200: 6005 (V0 = 5), 0x202: A200 (I = 0x200), 0x204: F055 (store V0 at 0x200),
+  // 0x206: 1200 (jump to 0x200)
+  constexpr std::array<unsigned char, 8> program{0x60, 0x05, 0xA2, 0x00,
+                                                 0xF0, 0x55, 0x12, 0x00};
+  for (size_t i = 0; i < program.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  for (auto i = 0; i < 4; i++) {
+    cpu.step(mem, graphics, keypad);
+  }
+
+  // FX55 overwrote the high byte of the first instruction so it now reads 0x0505 which is invalid
+  EXPECT_EQ(mem.get_decoded(0x200), nullptr);
+  try {
+    cpu.step(mem, graphics, keypad);
+    FAIL() << "InvalidInstruction exception should have been thrown.\n";
+  } catch (const arch::InvalidInstruction&) {
+    EXPECT_EQ(cpu.curr_opcode, 0x0505);
+  }
+}
+
+TEST(cpu_test, run_engines_agree) {
+  // 0x200: 6003 (V0 = 3), 0x202: 7101 (V1 += 1), 0x204: 8014 (V0 += V1),
+  // 0x206: 3E01 (skip if VE == 1), 0x208: 1202 (jump to 0x202)
+  constexpr std::array<unsigned char, 10> program{0x60, 0x03, 0x71, 0x01, 0x80,
+                                                  0x14, 0x3E, 0x01, 0x12, 0x02};
+
+  arch::CPU switch_cpu{};
+  arch::CPU threaded_cpu{};
+  switch_cpu.dispatch = arch::Dispatch::switch_table;
+  threaded_cpu.dispatch = arch::Dispatch::threaded;
+
+  arch::Memory switch_mem{};
+  arch::Memory threaded_mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  for (size_t i = 0; i < program.size(); i++) {
+    switch_mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    threaded_mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  switch_cpu.run(switch_mem, graphics, keypad, 1001);
+  threaded_cpu.run(threaded_mem, graphics, keypad, 1001);
+
+  EXPECT_EQ(switch_cpu.pc_reg, threaded_cpu.pc_reg);
+  EXPECT_EQ(switch_cpu.curr_opcode, threaded_cpu.curr_opcode);
+  for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+    EXPECT_EQ(switch_cpu.get_general_reg(reg), threaded_cpu.get_general_reg(reg));
+  }
+  EXPECT_EQ(threaded_cpu.get_general_reg(0x1), 250);
+}
+
+TEST(cpu_test, try_step_records_invalid_instruction) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  // 0x200: 6105 (V1 = 5), 0x202: FFFF (invalid), 0x204: 6207 (V2 = 7)
+  constexpr std::array<unsigned char, 6> program{0x61, 0x05, 0xFF, 0xFF, 0x62, 0x07};
+  for (size_t i = 0; i < program.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  EXPECT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::ok);
+  EXPECT_FALSE(cpu.trapped());
+  EXPECT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::trapped);
+  EXPECT_EQ(cpu.trap().fault, arch::Fault::invalid_instruction);
+  EXPECT_EQ(cpu.trap().pc, 0x202);
+  EXPECT_EQ(cpu.trap().opcode, 0xFFFF);
+  EXPECT_EQ(cpu.pc_reg, 0x204);
+
+  // Nothing runs until the trap is cleared
+  EXPECT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::trapped);
+  EXPECT_EQ(cpu.pc_reg, 0x204);
+
+  cpu.clear_trap();
+  EXPECT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::ok);
+  EXPECT_EQ(cpu.get_general_reg(0x2), 7);
+}
+
+TEST(cpu_test, try_run_stops_at_trap_on_every_engine) {
+  // 0x200: 7101 (V1 += 1), 0x202: 3105 (skip if V1 == 5), 0x204: 1200 (jump to 0x200),
+  // 0x206: 0000 (invalid)
+  constexpr std::array<unsigned char, 8> program{0x71, 0x01, 0x31, 0x05,
+                                                 0x12, 0x00, 0x00, 0x00};
+
+  for (const auto dispatch :
+       {arch::Dispatch::switch_table, arch::Dispatch::threaded, arch::Dispatch::fused}) {
+    arch::CPU cpu{};
+    arch::Memory mem{};
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+    cpu.dispatch = dispatch;
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+
+    EXPECT_EQ(cpu.try_run(mem, graphics, keypad, 1000), arch::Status::trapped);
+    EXPECT_EQ(cpu.trap().fault, arch::Fault::invalid_instruction);
+    EXPECT_EQ(cpu.trap().pc, 0x206);
+    EXPECT_EQ(cpu.get_general_reg(0x1), 5);
+  }
+}
+
+TEST(cpu_test, try_fetch_records_invalid_address) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+
+  cpu.pc_reg = arch::max_mem_address;
+  EXPECT_EQ(cpu.try_fetch(mem), arch::Status::trapped);
+  EXPECT_EQ(cpu.trap().fault, arch::Fault::invalid_address);
+  EXPECT_EQ(cpu.trap().pc, arch::max_mem_address);
+  EXPECT_EQ(cpu.trap().opcode, 0);
+  EXPECT_EQ(cpu.pc_reg, arch::max_mem_address);
+}
+
+TEST(cpu_test, try_step_records_stack_faults) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  // 0x200: 2200 (call 0x200)
+  mem.set_value(0x200, 0x22);
+  mem.set_value(0x201, 0x00);
+
+  for (size_t i = 0; i < arch::stack_size; i++) {
+    ASSERT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::ok);
+  }
+  EXPECT_EQ(cpu.try_step(mem, graphics, keypad), arch::Status::trapped);
+  EXPECT_EQ(cpu.trap().fault, arch::Fault::stack_overflow);
+  EXPECT_EQ(cpu.get_stack_pointer(), arch::stack_size);
+
+  // 0x300: 00EE (return)
+  arch::CPU empty_stack_cpu{};
+  empty_stack_cpu.pc_reg = 0x300;
+  mem.set_value(0x300, 0x00);
+  mem.set_value(0x301, 0xEE);
+  EXPECT_EQ(empty_stack_cpu.try_step(mem, graphics, keypad), arch::Status::trapped);
+  EXPECT_EQ(empty_stack_cpu.trap().fault, arch::Fault::stack_underflow);
+  EXPECT_EQ(empty_stack_cpu.trap().pc, 0x300);
+}
+
+TEST(cpu_test, try_decode_execute_records_out_of_range_sprite) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  cpu.index_reg = arch::max_mem_address - 2;
+  cpu.curr_opcode = 0xD005;
+  EXPECT_EQ(cpu.try_decode_execute(mem, graphics, keypad), arch::Status::trapped);
+  EXPECT_EQ(cpu.trap().fault, arch::Fault::invalid_address);
+  EXPECT_FALSE(cpu.updated_screen);
+}
+
+TEST(cpu_test, step_throws_and_clears_trap) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  // 0x200: 00EE (return with an empty stack)
+  mem.set_value(0x200, 0x00);
+  mem.set_value(0x201, 0xEE);
+
+  try {
+    cpu.step(mem, graphics, keypad);
+    FAIL() << "InvalidStackPointerValue exception should have been thrown.\n";
+  } catch (const arch::InvalidStackPointerValue&) {
+    EXPECT_FALSE(cpu.trapped());
+  }
+}
+
+TEST(cpu_test, wrapping_access_wraps_instead_of_trapping) {
+  arch::BasicCPU<arch::WrappingAccess> cpu{};
+  arch::BasicMemory<arch::WrappingAccess> mem{};
+  arch::BasicGraphics<arch::WrappingAccess> graphics{};
+  arch::Keypad keypad{};
+
+  // The opcode straddles the end of memory, 0xFFF: F3 and 0x000: 55 (store V0 to V3)
+  mem.set_value(arch::max_mem_address, 0xF3);
+  mem.set_value(0x000, 0x55);
+  cpu.pc_reg = arch::max_mem_address;
+  EXPECT_EQ(cpu.try_fetch(mem), arch::Status::ok);
+  EXPECT_EQ(cpu.curr_opcode, 0xF355);
+
+  for (auto i = 0; i < 4; i++) {
+    cpu.set_general_reg(static_cast<unsigned char>(i), static_cast<unsigned char>(0xA0 + i));
+  }
+  cpu.index_reg = arch::max_mem_address - 1;
+  EXPECT_EQ(cpu.try_decode_execute(mem, graphics, keypad), arch::Status::ok);
+  EXPECT_EQ(mem.get_value(arch::max_mem_address - 1), 0xA0);
+  EXPECT_EQ(mem.get_value(arch::max_mem_address), 0xA1);
+  EXPECT_EQ(mem.get_value(0x000), 0xA2);
+  EXPECT_EQ(mem.get_value(0x001), 0xA3);
+
+  // Sprite rows past the end of memory come from the start of it, drawn at (VE, VE) = (0, 0)
+  cpu.index_reg = arch::max_mem_address - 1;
+  cpu.curr_opcode = 0xDEE4;
+  EXPECT_EQ(cpu.try_decode_execute(mem, graphics, keypad), arch::Status::ok);
+  EXPECT_TRUE(cpu.updated_screen);
+  EXPECT_TRUE(graphics.get_pixel(0, 2));
+  EXPECT_FALSE(cpu.trapped());
+}
+
+#if defined(CHIP8_OPCODE_TABLE)
+TEST(cpu_test, opcode_table_matches_decode_for_every_opcode) {
+  const std::string seed_str("Definately a random string");
+  std::seed_seq seed(seed_str.begin(), seed_str.end());
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<> random_byte(0x00, 0xFF);
+
+  for (unsigned opcode = 0; opcode <= 0xFFFF; opcode++) {
+    arch::CPU decode_cpu{};
+    arch::CPU table_cpu{};
+    decode_cpu.dispatch = arch::Dispatch::switch_table;
+    table_cpu.dispatch = arch::Dispatch::opcode_table;
+
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      const auto value = static_cast<unsigned char>(random_byte(gen));
+      decode_cpu.set_general_reg(reg, value);
+      table_cpu.set_general_reg(reg, value);
+    }
+    decode_cpu.index_reg = table_cpu.index_reg = 0x300;
+    decode_cpu.set_stack_pointer(1);
+    table_cpu.set_stack_pointer(1);
+    decode_cpu.curr_opcode = table_cpu.curr_opcode = static_cast<unsigned short>(opcode);
+
+    arch::Memory decode_mem{};
+    arch::Memory table_mem{};
+    arch::Graphics decode_graphics{};
+    arch::Graphics table_graphics{};
+    arch::Keypad keypad{};
+
+    auto decode_threw = false;
+    auto table_threw = false;
+    try {
+      decode_cpu.decode_execute(decode_mem, decode_graphics, keypad);
+    } catch (const arch::InvalidInstruction&) {
+      decode_threw = true;
+    }
+    try {
+      table_cpu.decode_execute(table_mem, table_graphics, keypad);
+    } catch (const arch::InvalidInstruction&) {
+      table_threw = true;
+    }
+
+    ASSERT_EQ(decode_threw, table_threw) << std::hex << opcode;
+    ASSERT_EQ(decode_cpu.pc_reg, table_cpu.pc_reg) << std::hex << opcode;
+    ASSERT_EQ(decode_cpu.index_reg, table_cpu.index_reg) << std::hex << opcode;
+    ASSERT_EQ(decode_cpu.get_stack_pointer(), table_cpu.get_stack_pointer()) << std::hex << opcode;
+    ASSERT_EQ(decode_cpu.delay_timer_reg, table_cpu.delay_timer_reg) << std::hex << opcode;
+    ASSERT_EQ(decode_cpu.sound_timer_reg, table_cpu.sound_timer_reg) << std::hex << opcode;
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      ASSERT_EQ(decode_cpu.get_general_reg(reg), table_cpu.get_general_reg(reg))
+          << std::hex << opcode;
+    }
+  }
+}
+#endif
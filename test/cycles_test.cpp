@@ -0,0 +1,77 @@
+#include "cycles.h"
+
+#include <gtest/gtest.h>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+static_assert(arch::instruction_cycles(0x6005, 0, false) == arch::vip_fetch_cycles + 6,
+              "Costs are known at compile time");
+
+TEST(cycles_test, every_form_has_a_cost) {
+  for (const auto& spec : arch::opcode_specs) {
+    SCOPED_TRACE(spec.pattern);
+    EXPECT_GT(arch::vip_op_costs[static_cast<size_t>(spec.op)].cycles, 0);
+    EXPECT_GT(arch::instruction_cycles(spec.pattern, 0, false), arch::vip_fetch_cycles);
+  }
+  EXPECT_EQ(arch::instruction_cycles(0xFFFF, 0, false), arch::vip_fetch_cycles);
+}
+
+TEST(cycles_test, taken_skips_cost_more) {
+  for (unsigned short opcode : {0x3000, 0x4000, 0x5010, 0x9010, 0xE09E, 0xE0A1}) {
+    SCOPED_TRACE(opcode);
+    EXPECT_GT(arch::instruction_cycles(opcode, 0, true),
+              arch::instruction_cycles(opcode, 0, false));
+  }
+  EXPECT_EQ(arch::instruction_cycles(0x7001, 0, true), arch::instruction_cycles(0x7001, 0, false));
+}
+
+TEST(cycles_test, draw_depends_on_height_and_alignment) {
+  const auto draw = [](unsigned short opcode, unsigned char x) {
+    return arch::instruction_cycles(opcode, x, false);
+  };
+  EXPECT_EQ(draw(0xD015, 8) - draw(0xD014, 8), arch::vip_draw_row_cycles(8));
+  EXPECT_LT(draw(0xD015, 8), draw(0xD015, 9));
+  EXPECT_LT(draw(0xD015, 9), draw(0xD015, 15));
+  EXPECT_EQ(draw(0xD015, 0), draw(0xD015, 64));
+}
+
+TEST(cycles_test, register_transfers_scale_with_count) {
+  const auto cost = [](unsigned short opcode, unsigned char vx = 0) {
+    return arch::instruction_cycles(opcode, vx, false);
+  };
+  EXPECT_EQ(cost(0xF155) - cost(0xF055), cost(0xF265) - cost(0xF165));
+  EXPECT_LT(cost(0xF033), cost(0xF033, 199));
+}
+
+TEST(cycles_test, cpu_accumulates_guest_cycles) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  // 0x200: 6F09 (VF = 9), 0x202: 3F09 (skip if VF == 9), 0x204: 0000, 0x206: DF01 (draw at VF, VF)
+  const unsigned char program[] = {0x6F, 0x09, 0x3F, 0x09, 0x00, 0x00, 0xDF, 0x01};
+  for (unsigned short i = 0; i < sizeof(program); i++) {
+    mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  struct Step {
+    unsigned short opcode;
+    unsigned char vx;
+    bool skipped;
+  };
+  unsigned long long expected = 0;
+  for (const auto& step : {Step{0x6F09, 0, false}, Step{0x3F09, 9, true}, Step{0xDF01, 9, false}}) {
+    const auto cycles = arch::instruction_cycles(step.opcode, step.vx, step.skipped);
+    const auto pc = cpu.pc_reg;
+    const auto vf = cpu.get_general_reg(0xF);
+    cpu.step(mem, graphics, keypad);
+    // DXYN has just overwritten VF with its collision flag, the cost comes from the value before
+    EXPECT_EQ(cpu.count_cycles(pc, vf), cycles);
+    expected += cycles;
+  }
+  EXPECT_EQ(cpu.get_general_reg(0xF), 0);
+  EXPECT_EQ(cpu.guest_cycles, expected);
+}
@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+
+#include "cpu.h"
+
+// Entry point for running the opcode tests again with every CPU starting out on the dispatch engine
+// named by CHIP8_TEST_DISPATCH, regardless of the engine the library was built to default to.
+int main(int argc, char** argv) {
+  arch::CPU::initial_dispatch = arch::Dispatch::CHIP8_TEST_DISPATCH;
+
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
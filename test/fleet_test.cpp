@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "fleet.h"
+#include "work_stealing.h"
+
+namespace {
+  fleet::Job job_of(std::vector<unsigned char> program, unsigned long long max_cycles) {
+    fleet::Job job;
+    job.name = "test";
+    job.program = std::make_shared<const std::vector<unsigned char>>(std::move(program));
+    job.max_cycles = max_cycles;
+    return job;
+  }
+
+  // 0x200: A000 (I = sprite for 0), 0x202: D015 (draw at V0, V1), 0x204: 7001 (V0 += 1),
+  // 0x206: 1202 (jump to 0x202)
+  const std::vector<unsigned char> drawing{0xA0, 0x00, 0xD0, 0x15, 0x70, 0x01, 0x12, 0x02};
+
+  // 0x200: F00A (V0 = key), 0x202: F029 (I = sprite for V0), 0x204: D115 (draw at V1, V1),
+  // 0x206: 1206 (jump to 0x206)
+  const std::vector<unsigned char> key_wait{0xF0, 0x0A, 0xF0, 0x29, 0xD1, 0x15, 0x12, 0x06};
+}  // namespace
+
+TEST(fleet_test, runs_every_task_once) {
+  for (const auto workers : {1U, 2U, 8U}) {
+    std::vector<std::atomic<int>> runs(100);
+    const auto stats = fleet::run_work_stealing(
+        runs.size(), workers, [&](size_t index, unsigned int) { runs[index]++; });
+
+    size_t tasks = 0;
+    for (const auto& worker : stats) {
+      tasks += worker.tasks;
+    }
+    EXPECT_EQ(stats.size(), workers);
+    EXPECT_EQ(tasks, runs.size());
+    for (const auto& count : runs) {
+      EXPECT_EQ(count, 1);
+    }
+  }
+}
+
+TEST(fleet_test, idle_workers_steal) {
+  // Each even task waits on worker 0 until another worker runs one, which only a steal can do
+  std::atomic<bool> stolen{false};
+  const auto stats = fleet::run_work_stealing(4, 2, [&](size_t index, unsigned int worker) {
+    if (index % 2 == 0 && worker == 0) {
+      while (!stolen) {
+      }
+    } else if (index % 2 == 0) {
+      stolen = true;
+    }
+  });
+  EXPECT_EQ(stats[0].tasks + stats[1].tasks, 4);
+  EXPECT_EQ(stats[0].stolen, 0);
+  EXPECT_GE(stats[1].stolen, 1);
+}
+
+TEST(fleet_test, rethrows_task_failures) {
+  EXPECT_THROW(fleet::run_work_stealing(10, 3,
+                                        [](size_t index, unsigned int) {
+                                          if (index == 5) {
+                                            throw std::runtime_error("job failed");
+                                          }
+                                        }),
+               std::runtime_error);
+}
+
+TEST(fleet_test, job_stops_at_budget) {
+  auto job = job_of(drawing, 1000);
+  job.keep_screen = true;
+  const auto result = fleet::run_job(job);
+  EXPECT_EQ(result.stop, fleet::JobStop::cycle_limit);
+  EXPECT_GE(result.cycles, 1000);
+  // Jobs only stop between frames
+  EXPECT_LE(result.cycles, 1000 + arch::default_instructions_per_second / arch::timer_frequency);
+  ASSERT_TRUE(result.screen);
+  EXPECT_TRUE(result.screen->get_pixel(0, 0));
+
+  job.max_cycles = 0;
+  job.max_frames = 3;
+  EXPECT_EQ(fleet::run_job(job).stop, fleet::JobStop::frame_limit);
+  EXPECT_EQ(fleet::run_job(job).frames, 3);
+}
+
+TEST(fleet_test, job_replays_input) {
+  auto job = job_of(key_wait, 10000);
+  EXPECT_EQ(fleet::run_job(job).stop, fleet::JobStop::waiting_for_key);
+
+  job.input = {{5, input_events::Events::seven_pressed}, {6, input_events::Events::seven_released}};
+  const auto pressed = fleet::run_job(job);
+  EXPECT_EQ(pressed.stop, fleet::JobStop::cycle_limit);
+  EXPECT_NE(pressed.digest, fleet::run_job(job_of(key_wait, 10000)).digest);
+}
+
+TEST(fleet_test, job_reports_trap) {
+  // 0x200: 00EE (return with nothing on the stack)
+  const auto result = fleet::run_job(job_of({0x00, 0xEE}, 1000));
+  EXPECT_EQ(result.stop, fleet::JobStop::trap);
+  EXPECT_EQ(result.trap.fault, arch::Fault::stack_underflow);
+  EXPECT_EQ(result.trap.pc, 0x200);
+}
+
+TEST(fleet_test, fleet_matches_single_runs) {
+  std::vector<fleet::Job> jobs;
+  for (unsigned long long cycles = 100; cycles <= 2000; cycles += 100) {
+    jobs.push_back(job_of(cycles % 200 == 0 ? drawing : key_wait, cycles));
+  }
+  const auto report = fleet::run_fleet(jobs, 4);
+  ASSERT_EQ(report.results.size(), jobs.size());
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const auto expected = fleet::run_job(jobs[i]);
+    EXPECT_EQ(report.results[i].cycles, expected.cycles);
+    EXPECT_EQ(report.results[i].digest, expected.digest);
+    EXPECT_LT(report.results[i].worker, 4);
+  }
+
+  const auto summary = fleet::fleet_summary(report);
+  EXPECT_NE(summary.find("20 jobs, 10 cycle limit, 0 frame limit, 10 waiting for key, 0 trap"),
+            std::string::npos);
+  EXPECT_NE(summary.find("worker 3:"), std::string::npos);
+}
@@ -0,0 +1,95 @@
+#include "frontend_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "chip8.h"
+#include "display/capture_frontend.h"
+#include "display/null_frontend.h"
+
+TEST(frontend_test, captures_frames_that_changed) {
+  // 0x200: 6105 (V1 = 5), 0x202: A000 (I = sprite for 0), 0x204: D115 (draw at V1, V1),
+  // 0x206: 1206 (jump to 0x206)
+  Chip8 emulator(std::vector<unsigned char>{0x61, 0x05, 0xA0, 0x00, 0xD1, 0x15, 0x12, 0x06});
+  display::CaptureFrontend frontend;
+
+  const auto result = run_frontend(emulator, frontend, {3});
+  EXPECT_EQ(result.frames, 3);
+  EXPECT_EQ(result.stop, FrontendStop::frame_limit);
+  ASSERT_EQ(frontend.frames.size(), 1);
+  EXPECT_EQ(frontend.frames[0], read_frame(emulator));
+  EXPECT_TRUE(frontend.frames[0].get_pixel(5, 5));
+  EXPECT_FALSE(frontend.frames[0].get_pixel(4, 5));
+}
+
+TEST(frontend_test, frames_follow_the_clock) {
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00});
+  display::NullFrontend frontend;
+
+  // 700 instructions per second run in one second of virtual time, without waiting for it
+  const auto result = run_frontend(emulator, frontend, {60});
+  EXPECT_EQ(result.cycles, 700);
+  EXPECT_EQ(frontend.frames_presented, 0);
+  EXPECT_EQ(std::chrono::round<std::chrono::milliseconds>(frontend.now()),
+            std::chrono::seconds(1));
+}
+
+TEST(frontend_test, waits_for_key_on_input) {
+  // 0x200: 6078 (V0 = 120), 0x202: F015 (delay timer = V0), 0x204: F10A (wait for key into V1),
+  // 0x206: 1206 (jump to 0x206)
+  Chip8 emulator(std::vector<unsigned char>{0x60, 0x78, 0xF0, 0x15, 0xF1, 0x0A, 0x12, 0x06});
+  display::CaptureFrontend frontend;
+
+  // The first frame stops at FX0A and the next ones only wait, ticking the timers
+  auto result = run_frontend(emulator, frontend, {10});
+  EXPECT_EQ(result.frames, 10);
+  EXPECT_EQ(result.cycles, 3);
+  EXPECT_TRUE(emulator.waiting_for_key());
+
+  // The key arrives in the next frame, which runs the rest of the tick period of the first
+  frontend.input.push_back(input_events::Events::five_pressed);
+  result = run_frontend(emulator, frontend, {1});
+  EXPECT_FALSE(emulator.waiting_for_key());
+  EXPECT_EQ(result.cycles, 9);
+}
+
+TEST(frontend_test, stops_on_quit_and_trap) {
+  // 0x200: 1200 (jump to 0x200)
+  Chip8 looping(std::vector<unsigned char>{0x12, 0x00});
+  display::CaptureFrontend frontend;
+  frontend.input.push_back(input_events::Events::quit);
+  auto result = run_frontend(looping, frontend);
+  EXPECT_EQ(result.stop, FrontendStop::quit);
+  EXPECT_EQ(result.frames, 0);
+
+  // 0x200: FFFF (invalid)
+  Chip8 faulting(std::vector<unsigned char>{0xFF, 0xFF});
+  result = run_frontend(faulting, frontend);
+  EXPECT_EQ(result.stop, FrontendStop::trap);
+  EXPECT_EQ(result.frames, 1);
+  EXPECT_EQ(faulting.trap().fault, arch::Fault::invalid_instruction);
+}
+
+TEST(frontend_test, times_frame_phases) {
+  // 0x200: 6105 (V1 = 5), 0x202: A000 (I = sprite for 0), 0x204: D115 (draw at V1, V1),
+  // 0x206: 1206 (jump to 0x206)
+  Chip8 emulator(std::vector<unsigned char>{0x61, 0x05, 0xA0, 0x00, 0xD1, 0x15, 0x12, 0x06});
+  display::CaptureFrontend frontend;
+  FramePhaseLatencies latencies;
+  FrontendOptions options;
+  options.max_frames = 3;
+  options.phase_latencies = &latencies;
+
+  run_frontend(emulator, frontend, options);
+  EXPECT_EQ(latencies.frame.count(), 3);
+  EXPECT_EQ(latencies.input.count(), 3);
+  EXPECT_EQ(latencies.emulate.count(), 3);
+  EXPECT_EQ(latencies.delay.count(), 3);
+  // Only the first frame drew anything
+  EXPECT_EQ(latencies.pixels.count(), 1);
+  EXPECT_EQ(latencies.present.count(), 1);
+  EXPECT_GE(latencies.frame.max(), latencies.emulate.max());
+}
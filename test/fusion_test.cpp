@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  // 0x200: 6000 (V0 = 0), 0x202: 6105 (V1 = 5), 0x204: 6200 (V2 = 0),
+  // 0x206: 7001 (V0 += 1), 0x208: 300A (skip if V0 == 0x0A), 0x20A: 1206 (jump to 0x206),
+  // 0x20C: A000 (I = 0x000), 0x20E: D125 (draw 5 rows at V1, V2),
+  // 0x210: F307 (V3 = delay timer), 0x212: 3300 (skip if V3 == 0), 0x214: 1210 (jump to 0x210),
+  // 0x216: 7201 (V2 += 1), 0x218: 1200 (jump to 0x200)
+  constexpr std::array<unsigned char, 26> program{
+      0x60, 0x00, 0x61, 0x05, 0x62, 0x00, 0x70, 0x01, 0x30, 0x0A, 0x12, 0x06, 0xA0,
+      0x00, 0xD1, 0x25, 0xF3, 0x07, 0x33, 0x00, 0x12, 0x10, 0x72, 0x01, 0x12, 0x00};
+
+  void load_program(arch::Memory& mem) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+  }
+
+  void expect_same_state(const arch::CPU& expected, const arch::CPU& actual) {
+    EXPECT_EQ(expected.pc_reg, actual.pc_reg);
+    EXPECT_EQ(expected.index_reg, actual.index_reg);
+    EXPECT_EQ(expected.curr_opcode, actual.curr_opcode);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(expected.get_general_reg(reg), actual.get_general_reg(reg));
+    }
+  }
+}  // namespace
+
+TEST(fusion_test, recognizes_sequences) {
+  arch::Memory mem{};
+  load_program(mem);
+
+  const auto load_run = arch::CPU::fuse(mem, 0x200);
+  EXPECT_EQ(load_run.kind, arch::Fusion::load_run);
+  EXPECT_EQ(load_run.length, 3);
+  EXPECT_EQ(load_run.x[1], 0x1);
+  EXPECT_EQ(load_run.nn[1], 0x05);
+  EXPECT_EQ(load_run.last_opcode, 0x6200);
+
+  EXPECT_EQ(arch::CPU::fuse(mem, 0x202).length, 2);
+
+  const auto counted_loop = arch::CPU::fuse(mem, 0x206);
+  EXPECT_EQ(counted_loop.kind, arch::Fusion::counted_loop);
+  EXPECT_EQ(counted_loop.length, 3);
+  EXPECT_EQ(counted_loop.nnn, 0x206);
+
+  const auto sprite_draw = arch::CPU::fuse(mem, 0x20C);
+  EXPECT_EQ(sprite_draw.kind, arch::Fusion::sprite_draw);
+  EXPECT_EQ(sprite_draw.length, 2);
+  EXPECT_EQ(sprite_draw.nn[0], 5);
+
+  const auto delay_wait = arch::CPU::fuse(mem, 0x210);
+  EXPECT_EQ(delay_wait.kind, arch::Fusion::delay_wait);
+  EXPECT_EQ(delay_wait.nnn, 0x210);
+
+  EXPECT_EQ(arch::CPU::fuse(mem, 0x216).kind, arch::Fusion::none);
+  EXPECT_EQ(arch::CPU::fuse(mem, 0xFFE).kind, arch::Fusion::none);
+}
+
+TEST(fusion_test, matches_unfused_at_every_boundary) {
+  arch::Graphics graphics{};
+  arch::Graphics fused_graphics{};
+  arch::Keypad keypad{};
+
+  for (size_t count = 1; count < 200; count++) {
+    arch::CPU expected{};
+    arch::CPU actual{};
+    expected.dispatch = arch::Dispatch::switch_table;
+    actual.dispatch = arch::Dispatch::fused;
+
+    arch::Memory expected_mem{};
+    arch::Memory actual_mem{};
+    load_program(expected_mem);
+    load_program(actual_mem);
+
+    expected.run(expected_mem, graphics, keypad, count);
+    actual.run(actual_mem, fused_graphics, keypad, count);
+
+    SCOPED_TRACE(count);
+    expect_same_state(expected, actual);
+    EXPECT_EQ(actual.fusion_counters.total_instructions, count);
+  }
+}
+
+TEST(fusion_test, counts_hits) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem);
+
+  cpu.dispatch = arch::Dispatch::fused;
+  // One pass: load run, counted loop to 10, sprite, delay wait, V2 += 1 and the jump back
+  cpu.run(mem, graphics, keypad, 3 + 29 + 2 + 2 + 2);
+
+  const auto& counters = cpu.fusion_counters;
+  EXPECT_EQ(counters.hits[static_cast<size_t>(arch::Fusion::load_run)], 1);
+  EXPECT_EQ(counters.hits[static_cast<size_t>(arch::Fusion::counted_loop)], 1);
+  EXPECT_EQ(counters.instructions[static_cast<size_t>(arch::Fusion::counted_loop)], 29);
+  EXPECT_EQ(counters.hits[static_cast<size_t>(arch::Fusion::sprite_draw)], 1);
+  EXPECT_EQ(counters.hits[static_cast<size_t>(arch::Fusion::delay_wait)], 1);
+  EXPECT_EQ(counters.total_instructions, 38);
+  EXPECT_EQ(cpu.pc_reg, 0x200);
+
+  const auto report = arch::fusion_report(counters);
+  EXPECT_EQ(std::count(report.begin(), report.end(), '\n'), 4);
+}
+
+TEST(fusion_test, delay_wait_spins_within_budget) {
+  arch::CPU expected{};
+  arch::CPU actual{};
+  expected.dispatch = arch::Dispatch::switch_table;
+  actual.dispatch = arch::Dispatch::fused;
+  expected.pc_reg = actual.pc_reg = 0x210;
+  expected.delay_timer_reg = actual.delay_timer_reg = 3;
+
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem);
+
+  expected.run(mem, graphics, keypad, 1000);
+  actual.run(mem, graphics, keypad, 1000);
+
+  expect_same_state(expected, actual);
+  EXPECT_EQ(actual.fusion_counters.hits[static_cast<size_t>(arch::Fusion::delay_wait)], 1);
+}
+
+TEST(fusion_test, write_resets_covering_sequences) {
+  arch::Memory mem{};
+  load_program(mem);
+
+  EXPECT_EQ(mem.get_fused(0x200)->kind, arch::Fusion::pending);
+  mem.set_fused(0x200, arch::CPU::fuse(mem, 0x200));
+  mem.set_fused(0x20C, arch::CPU::fuse(mem, 0x20C));
+  EXPECT_EQ(mem.get_fused(0x200)->kind, arch::Fusion::load_run);
+
+  // 0x20F is within max_fused_length instructions of 0x200
+  mem.set_value(0x20F, 0x25);
+  EXPECT_EQ(mem.get_fused(0x200)->kind, arch::Fusion::pending);
+  EXPECT_EQ(mem.get_fused(0x20C)->kind, arch::Fusion::pending);
+
+  mem.set_fused(0x200, arch::CPU::fuse(mem, 0x200));
+  mem.set_value(0x210, 0xF3);
+  EXPECT_EQ(mem.get_fused(0x200)->kind, arch::Fusion::load_run);
+
+  EXPECT_EQ(mem.get_fused(0x201), nullptr);
+  EXPECT_EQ(mem.get_fused(0x1000), nullptr);
+}
+
+TEST(fusion_test, chip8_fuses_predecoded_code) {
+  const std::vector<unsigned char> rom(program.begin(), program.end());
+  Chip8 fused(rom);
+  Chip8 unfused(rom);
+  fused.set_fusion(true);
+  fused.force_tier(arch::Tier::predecoded);
+  unfused.force_tier(arch::Tier::predecoded);
+
+  const auto fused_result = fused.run_cycles(5000);
+  const auto unfused_result = unfused.run_cycles(5000);
+  EXPECT_EQ(fused_result.cycles, unfused_result.cycles);
+  EXPECT_EQ(fused.tier_counters().predecoded, unfused.tier_counters().predecoded);
+  EXPECT_EQ(fused.guest_cycles(), unfused.guest_cycles());
+  EXPECT_EQ(fused.next_timer_event(), unfused.next_timer_event());
+
+  const auto& counters = fused.fusion_counters();
+  EXPECT_EQ(counters.total_instructions, fused.tier_counters().predecoded);
+  EXPECT_EQ(unfused.fusion_counters().total_instructions, 0);
+#if !defined(CHIP8_PROFILER)
+  // Profiled builds run one instruction at a time, which no superinstruction fits in
+  EXPECT_GT(counters.hits[static_cast<size_t>(arch::Fusion::load_run)], 0);
+  EXPECT_GT(counters.hits[static_cast<size_t>(arch::Fusion::counted_loop)], 0);
+#endif
+}
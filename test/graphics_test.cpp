@@ -125,4 +125,12 @@ TEST(graphics_test, test_draw_pixel_false_false) {
   arch::Graphics graphics{};
   graphics.set_pixel(2, 5, false);
   EXPECT_EQ(graphics.draw_pixel(2, 5, false), false);
-}
\ No newline at end of file
+}
+
+TEST(graphics_test, wrapping_access_wraps_out_of_bounds_pixel) {
+  arch::BasicGraphics<arch::WrappingAccess> graphics{};
+  graphics.set_pixel(arch::graphics::screen_width + 2, arch::graphics::screen_height + 5, true);
+  EXPECT_EQ(graphics.get_pixel(2, 5), true);
+  EXPECT_EQ(graphics.draw_pixel(2 * arch::graphics::screen_width + 2, 5, true), true);
+  EXPECT_EQ(graphics.get_pixel(2, 5), false);
+}
@@ -0,0 +1,226 @@
+#include "idle.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  void load_program(arch::Memory& mem, const std::vector<unsigned char>& program) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+  }
+
+  // Same as Chip8::emulate_cycle
+  void emulate_cycle(arch::CPU& cpu, arch::Memory& mem, arch::Graphics& graphics,
+                     arch::Keypad& keypad, arch::TimerUnit& timers) {
+    const auto pc = cpu.pc_reg;
+    const auto vf = cpu.get_general_reg(0xF);
+    cpu.step(mem, graphics, keypad);
+    const auto cycles = cpu.count_cycles(pc, vf);
+    const auto vip = timers.timing() == arch::Timing::vip_cycles;
+    for (auto ticks = vip ? timers.advance(cycles) : timers.step(); ticks > 0; ticks--) {
+      if (cpu.delay_timer_reg > 0) {
+        --cpu.delay_timer_reg;
+      }
+      if (cpu.sound_timer_reg > 0) {
+        --cpu.sound_timer_reg;
+      }
+    }
+  }
+
+  // Ticks the timers every cycle
+  void emulate_cycle(arch::CPU& cpu, arch::Memory& mem, arch::Graphics& graphics,
+                     arch::Keypad& keypad) {
+    arch::TimerUnit timers(arch::timer_frequency);
+    emulate_cycle(cpu, mem, graphics, keypad, timers);
+  }
+
+  // Runs cycles cycles of program from the given timer values at ips instructions per second or in
+  // VIP machine cycles, once executing every instruction and once skipping idle loops, and checks
+  // that both end up in the same state
+  void expect_skip_matches(const std::vector<unsigned char>& program, unsigned char delay,
+                           size_t cycles, unsigned int ips = arch::timer_frequency,
+                           arch::Timing timing = arch::Timing::instructions) {
+    arch::CPU expected{};
+    arch::CPU actual{};
+    arch::Memory mem{};
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+    load_program(mem, program);
+    expected.delay_timer_reg = actual.delay_timer_reg = delay;
+    expected.sound_timer_reg = actual.sound_timer_reg = 200;
+
+    arch::TimerUnit expected_timers(ips);
+    expected_timers.set_timing(timing);
+    for (size_t i = 0; i < cycles; i++) {
+      emulate_cycle(expected, mem, graphics, keypad, expected_timers);
+    }
+
+    arch::TimerUnit actual_timers(ips);
+    actual_timers.set_timing(timing);
+    size_t done = 0;
+    size_t skipped = 0;
+    while (done < cycles) {
+      const auto skip = arch::skip_idle_loop(actual, mem, keypad, cycles - done, actual_timers);
+      if (skip.cycles == 0) {
+        emulate_cycle(actual, mem, graphics, keypad, actual_timers);
+        done++;
+      } else {
+        done += skip.cycles;
+        skipped += skip.cycles;
+      }
+    }
+
+    EXPECT_EQ(done, cycles);
+    EXPECT_GT(skipped, 0);
+    EXPECT_EQ(expected.pc_reg, actual.pc_reg);
+    EXPECT_EQ(expected.curr_opcode, actual.curr_opcode);
+    EXPECT_EQ(expected.delay_timer_reg, actual.delay_timer_reg);
+    EXPECT_EQ(expected.sound_timer_reg, actual.sound_timer_reg);
+    EXPECT_EQ(expected.guest_cycles, actual.guest_cycles);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(expected.get_general_reg(reg), actual.get_general_reg(reg));
+    }
+  }
+}  // namespace
+
+TEST(idle_test, detects_delay_timer_loop) {
+  arch::Memory mem{};
+  // 0x200: F307 (V3 = delay timer), 0x202: 3300 (skip if V3 == 0), 0x204: 1200 (jump to 0x200)
+  load_program(mem, {0xF3, 0x07, 0x33, 0x00, 0x12, 0x00});
+
+  const auto loop = arch::detect_idle_loop(mem, 0x200);
+  EXPECT_EQ(loop.wait, arch::IdleWait::delay_timer);
+  EXPECT_EQ(loop.length, 3);
+  EXPECT_EQ(loop.x, 0x3);
+  EXPECT_EQ(loop.nn, 0x00);
+  EXPECT_TRUE(loop.exit_on_equal);
+
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0x202).wait, arch::IdleWait::none);
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0x201).wait, arch::IdleWait::none);
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0xFFE).wait, arch::IdleWait::none);
+}
+
+TEST(idle_test, rejects_loops_with_side_effects) {
+  arch::Memory mem{};
+  // 0x200: F307 (V3 = delay timer), 0x202: 3400 (skip if V4 == 0), 0x204: 1200 (jump to 0x200)
+  load_program(mem, {0xF3, 0x07, 0x34, 0x00, 0x12, 0x00});
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0x200).wait, arch::IdleWait::none);
+
+  // 0x200: F307 (V3 = delay timer), 0x202: 3300 (skip if V3 == 0), 0x204: 1206 (jump to 0x206)
+  mem.set_value(0x203, 0x00);
+  mem.set_value(0x202, 0x33);
+  mem.set_value(0x205, 0x06);
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0x200).wait, arch::IdleWait::none);
+}
+
+TEST(idle_test, detects_keypad_loops) {
+  arch::Memory mem{};
+  // 0x200: E29E (skip if key V2 pressed), 0x202: 1200 (jump to 0x200),
+  // 0x204: E2A1 (skip if key V2 not pressed), 0x206: 1204 (jump to 0x204)
+  load_program(mem, {0xE2, 0x9E, 0x12, 0x00, 0xE2, 0xA1, 0x12, 0x04});
+
+  const auto press = arch::detect_idle_loop(mem, 0x200);
+  EXPECT_EQ(press.wait, arch::IdleWait::key_press);
+  EXPECT_EQ(press.length, 2);
+  EXPECT_EQ(press.x, 0x2);
+  EXPECT_EQ(arch::detect_idle_loop(mem, 0x204).wait, arch::IdleWait::key_release);
+}
+
+TEST(idle_test, skips_delay_timer_wait) {
+  // 0x200: F307 (V3 = delay timer), 0x202: 3300 (skip if V3 == 0), 0x204: 1200 (jump to 0x200),
+  // 0x206: 7401 (V4 += 1), 0x208: 6350 (V3 = 0x50), 0x20A: F315 (delay timer = V3),
+  // 0x20C: 1200 (jump to 0x200)
+  const std::vector<unsigned char> program{0xF3, 0x07, 0x33, 0x00, 0x12, 0x00, 0x74,
+                                           0x01, 0x63, 0x50, 0xF3, 0x15, 0x12, 0x00};
+  for (unsigned char delay : {0, 1, 2, 3, 4, 100, 255}) {
+    SCOPED_TRACE(delay);
+    expect_skip_matches(program, delay, 2000);
+  }
+}
+
+TEST(idle_test, skips_delay_timer_wait_at_instruction_rate) {
+  // Same program as above, with several instructions per timer tick
+  const std::vector<unsigned char> program{0xF3, 0x07, 0x33, 0x00, 0x12, 0x00, 0x74,
+                                           0x01, 0x63, 0x50, 0xF3, 0x15, 0x12, 0x00};
+  for (unsigned int ips : {61, 500, 700, 1000}) {
+    for (unsigned char delay : {0, 1, 2, 100}) {
+      SCOPED_TRACE(ips);
+      SCOPED_TRACE(delay);
+      expect_skip_matches(program, delay, 20000, ips);
+    }
+  }
+}
+
+TEST(idle_test, skips_delay_timer_wait_in_vip_cycles) {
+  // Same program as above, with instructions taking the time they took on the COSMAC VIP
+  const std::vector<unsigned char> program{0xF3, 0x07, 0x33, 0x00, 0x12, 0x00, 0x74,
+                                           0x01, 0x63, 0x50, 0xF3, 0x15, 0x12, 0x00};
+  for (unsigned char delay : {0, 1, 2, 100}) {
+    SCOPED_TRACE(delay);
+    expect_skip_matches(program, delay, 20000, arch::timer_frequency, arch::Timing::vip_cycles);
+  }
+}
+
+TEST(idle_test, stops_skipping_on_tick) {
+  // 0x200: E29E (skip if key V2 pressed), 0x202: 1200 (jump to 0x200)
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Keypad keypad{};
+  load_program(mem, {0xE2, 0x9E, 0x12, 0x00});
+  arch::TimerUnit timers(700);
+  timers.advance(5);
+
+  // The tick is 7 cycles away, which is the end of the fourth iteration
+  const auto skip = arch::skip_idle_loop(cpu, mem, keypad, 1000, timers, true);
+  EXPECT_EQ(skip.cycles, 8);
+  EXPECT_EQ(skip.ticks, 1);
+  EXPECT_EQ(timers.next_timer_event(), 11);
+}
+
+TEST(idle_test, skips_loop_that_never_exits) {
+  // 0x200: F307 (V3 = delay timer), 0x202: 4300 (skip if V3 != 0), 0x204: 1200 (jump to 0x200)
+  const std::vector<unsigned char> program{0xF3, 0x07, 0x43, 0x00, 0x12, 0x00};
+  expect_skip_matches(program, 0, 1000);
+
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Keypad keypad{};
+  load_program(mem, program);
+  const auto skip = arch::skip_idle_loop(cpu, mem, keypad, 1000);
+  // Only whole iterations are skipped
+  EXPECT_EQ(skip.cycles, 999);
+  EXPECT_EQ(cpu.pc_reg, 0x200);
+}
+
+TEST(idle_test, skips_keypad_wait_until_pressed) {
+  // 0x200: 6205 (V2 = 5), 0x202: E29E (skip if key V2 pressed), 0x204: 1202 (jump to 0x202),
+  // 0x206: 7401 (V4 += 1)
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem, {0x62, 0x05, 0xE2, 0x9E, 0x12, 0x02, 0x74, 0x01});
+  cpu.delay_timer_reg = 50;
+
+  emulate_cycle(cpu, mem, graphics, keypad);
+  auto skip = arch::skip_idle_loop(cpu, mem, keypad, 100);
+  EXPECT_EQ(skip.wait, arch::IdleWait::key_press);
+  EXPECT_EQ(skip.cycles, 100);
+  EXPECT_EQ(cpu.delay_timer_reg, 0);
+  EXPECT_EQ(cpu.pc_reg, 0x202);
+  EXPECT_EQ(cpu.curr_opcode, 0x1202);
+
+  keypad.press_key(0x5);
+  skip = arch::skip_idle_loop(cpu, mem, keypad, 100);
+  EXPECT_EQ(skip.cycles, 0);
+  emulate_cycle(cpu, mem, graphics, keypad);
+  emulate_cycle(cpu, mem, graphics, keypad);
+  EXPECT_EQ(cpu.get_general_reg(0x4), 1);
+}
@@ -0,0 +1,161 @@
+#include "ir.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  void load_program(arch::Memory& mem, const std::vector<unsigned short>& program) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + 2 * i),
+                    static_cast<unsigned char>(program[i] >> 8));
+      mem.set_value(static_cast<unsigned short>(0x201 + 2 * i),
+                    static_cast<unsigned char>(program[i]));
+    }
+  }
+
+  arch::IrBlock optimized_block(const std::vector<unsigned short>& program) {
+    arch::Memory mem{};
+    load_program(mem, program);
+    auto block = arch::lower_block(mem, 0x200);
+    arch::optimize(block);
+    return block;
+  }
+
+  size_t count_uops(const arch::IrBlock& block, arch::UopKind kind, unsigned char reg) {
+    return static_cast<size_t>(
+        std::count_if(block.uops.begin(), block.uops.end(), [&](const arch::Uop& uop) {
+          const auto guest = kind == arch::UopKind::store ? uop.dst : uop.a;
+          return uop.kind == kind && guest == reg;
+        }));
+  }
+}  // namespace
+
+TEST(ir_test, lowering_stops_at_untranslated_instruction) {
+  // 6005 (V0 = 5), 2300 (call 0x300)
+  arch::Memory mem{};
+  load_program(mem, {0x6005, 0x2300});
+
+  const auto block = arch::lower_block(mem, 0x200);
+  EXPECT_EQ(block.length, 1);
+  EXPECT_EQ(block.last_opcode, 0x6005);
+  EXPECT_EQ(block.exit, arch::IrExit::jump);
+  EXPECT_EQ(block.target, 0x202);
+  EXPECT_EQ(arch::lower_block(mem, 0x202).length, 0);
+}
+
+TEST(ir_test, overwritten_flag_is_dropped) {
+  // 8014 (V0 += V1), 8125 (V1 -= V2), 1200 (jump to 0x200). The carry of 8014 is never read.
+  const auto block = optimized_block({0x8014, 0x8125, 0x1200});
+  EXPECT_EQ(block.length, 3);
+  EXPECT_EQ(count_uops(block, arch::UopKind::store, 0xF), 1);
+  EXPECT_EQ(std::count_if(block.uops.begin(), block.uops.end(),
+                          [](const auto& uop) { return uop.kind == arch::UopKind::carry; }),
+            0);
+}
+
+TEST(ir_test, constants_are_folded) {
+  // 6005 (V0 = 5), 7003 (V0 += 3), A20A (I = 0x20A), F01E (I += V0), 3008 (skip if V0 == 8)
+  const auto block = optimized_block({0x6005, 0x7003, 0xA20A, 0xF01E, 0x3008});
+  ASSERT_EQ(block.uops.size(), 4);
+  EXPECT_EQ(count_uops(block, arch::UopKind::store, 0x0), 1);
+  EXPECT_EQ(count_uops(block, arch::UopKind::store, arch::ir_index_reg), 1);
+  for (const auto& uop : block.uops) {
+    EXPECT_TRUE(uop.kind == arch::UopKind::set || uop.kind == arch::UopKind::store);
+    if (uop.kind == arch::UopKind::set) {
+      EXPECT_TRUE(uop.imm == 0x08 || uop.imm == 0x212);
+    }
+  }
+  // The skip is always taken
+  EXPECT_EQ(block.exit, arch::IrExit::jump);
+  EXPECT_EQ(block.target, 0x20C);
+}
+
+TEST(ir_test, repeated_loads_are_removed) {
+  // 7101 (V1 += 1), 8210 (V2 = V1), 7101 (V1 += 1), 8310 (V3 = V1)
+  const auto block = optimized_block({0x7101, 0x8210, 0x7101, 0x8310});
+  EXPECT_EQ(count_uops(block, arch::UopKind::load, 0x1), 1);
+  EXPECT_EQ(count_uops(block, arch::UopKind::store, 0x1), 1);
+}
+
+TEST(ir_test, random_programs_match_interpreter) {
+  constexpr std::array<unsigned short, 24> forms{
+      0x3000, 0x4000, 0x5000, 0x6000, 0x7000, 0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005,
+      0x8006, 0x8007, 0x800E, 0x9000, 0xA000, 0xF007, 0xF015, 0xF018, 0xF01E, 0xF029, 0x7000,
+      0x8004, 0x8005};
+  const std::string seed_str("Definately a random string");
+  std::seed_seq seed(seed_str.begin(), seed_str.end());
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<> random_byte(0x00, 0xFF);
+  std::uniform_int_distribution<size_t> random_form(0, forms.size() - 1);
+
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  for (auto program_idx = 0; program_idx < 64; program_idx++) {
+    std::vector<unsigned short> program;
+    for (auto i = 0; i < 24; i++) {
+      const auto form = forms[random_form(gen)];
+      auto opcode = static_cast<unsigned short>(form | (random_byte(gen) & 0x0F) << 8);
+      if ((form & 0xF000) == 0x8000 || (form & 0xF000) == 0x5000 || (form & 0xF000) == 0x9000) {
+        opcode = static_cast<unsigned short>(opcode | (random_byte(gen) & 0x0F) << 4);
+      } else if ((form & 0xF000) != 0xF000) {
+        opcode = static_cast<unsigned short>(opcode | random_byte(gen));
+      }
+      program.push_back(opcode);
+    }
+    // A skip of the first jump lands on the second
+    program.push_back(0x1200);
+    program.push_back(0x1200);
+
+    arch::CPU expected{};
+    arch::CPU actual{};
+    arch::Memory expected_mem{};
+    arch::Memory actual_mem{};
+    load_program(expected_mem, program);
+    load_program(actual_mem, program);
+
+    arch::IrEngine engine{};
+    expected.run(expected_mem, graphics, keypad, 500);
+    const auto lowered = engine.run(actual, actual_mem, graphics, keypad, 500);
+
+    SCOPED_TRACE(program_idx);
+    EXPECT_GT(lowered, 0);
+    EXPECT_EQ(expected.pc_reg, actual.pc_reg);
+    EXPECT_EQ(expected.index_reg, actual.index_reg);
+    EXPECT_EQ(expected.curr_opcode, actual.curr_opcode);
+    EXPECT_EQ(expected.delay_timer_reg, actual.delay_timer_reg);
+    EXPECT_EQ(expected.sound_timer_reg, actual.sound_timer_reg);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(expected.get_general_reg(reg), actual.get_general_reg(reg));
+    }
+  }
+}
+
+TEST(ir_test, self_modifying_code_is_relowered) {
+  // 0x200: 6062 (V0 = 0x62), 0x202: 6107 (V1 = 0x07), 0x204: A208 (I = 0x208),
+  // 0x206: 1208 (jump to 0x208), 0x208: 6203 (V2 = 3), 0x20A: 3E01 (skip if VE == 1),
+  // 0x20C: 1210 (jump to 0x210), 0x20E: 120E (jump to self), 0x210: F155 (store V0 and V1 over
+  // 0x208 making it 6207), 0x212: 6E01 (VE = 1), 0x214: 1208 (jump to 0x208)
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem, {0x6062, 0x6107, 0xA208, 0x1208, 0x6203, 0x3E01, 0x1210, 0x120E, 0xF155,
+                     0x6E01, 0x1208});
+
+  arch::IrEngine engine{};
+  engine.run(cpu, mem, graphics, keypad, 50);
+
+  EXPECT_EQ(cpu.get_general_reg(0x2), 7);
+  EXPECT_EQ(cpu.pc_reg, 0x20E);
+}
@@ -0,0 +1,221 @@
+#include "jit.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <random>
+#include <string>
+
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  template <size_t Size>
+  void load_program(arch::Memory& mem, const std::array<unsigned char, Size>& program) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+  }
+
+  void expect_same_state(const arch::CPU& expected, const arch::CPU& actual) {
+    EXPECT_EQ(expected.pc_reg, actual.pc_reg);
+    EXPECT_EQ(expected.index_reg, actual.index_reg);
+    EXPECT_EQ(expected.curr_opcode, actual.curr_opcode);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(expected.get_general_reg(reg), actual.get_general_reg(reg));
+    }
+  }
+}  // namespace
+
+TEST(jit_test, translated_opcodes_match_interpreter) {
+  constexpr std::array<unsigned short, 17> forms{0x6000, 0x7000, 0x8000, 0x8001, 0x8002, 0x8003,
+                                                 0x8004, 0x8005, 0x8006, 0x8007, 0x800E, 0xA000,
+                                                 0xF01E, 0xF029, 0x1000, 0x3000, 0x4000};
+  const std::string seed_str("Definately a random string");
+  std::seed_seq seed(seed_str.begin(), seed_str.end());
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<> random_byte(0x00, 0xFF);
+
+  arch::Jit jit{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  for (auto form : forms) {
+    for (auto i = 0; i < 64; i++) {
+      auto opcode = static_cast<unsigned short>(form | (random_byte(gen) & 0x0F) << 8);
+      if ((form & 0xF000) == 0x8000) {
+        opcode = static_cast<unsigned short>(opcode | (random_byte(gen) & 0x0F) << 4);
+      } else if ((form & 0xF0FF) != 0xF01E && (form & 0xF0FF) != 0xF029) {
+        opcode = static_cast<unsigned short>(opcode | random_byte(gen));
+      }
+
+      arch::CPU expected{};
+      arch::CPU actual{};
+      for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+        const auto value = static_cast<unsigned char>(random_byte(gen));
+        expected.set_general_reg(reg, value);
+        actual.set_general_reg(reg, value);
+      }
+      expected.index_reg = actual.index_reg = static_cast<unsigned short>(random_byte(gen) << 4);
+
+      arch::Memory mem{};
+      mem.set_value(0x200, static_cast<unsigned char>(opcode >> 8));
+      mem.set_value(0x201, static_cast<unsigned char>(opcode));
+
+      expected.step(mem, graphics, keypad);
+      jit.flush();
+      jit.run(actual, mem, graphics, keypad, 1);
+
+      SCOPED_TRACE(opcode);
+      expect_same_state(expected, actual);
+    }
+  }
+}
+
+TEST(jit_test, loop_matches_interpreter) {
+  // 0x200: 6003 (V0 = 3), 0x202: 7101 (V1 += 1), 0x204: 8014 (V0 += V1),
+  // 0x206: 3E01 (skip if VE == 1), 0x208: 1202 (jump to 0x202)
+  constexpr std::array<unsigned char, 10> program{0x60, 0x03, 0x71, 0x01, 0x80,
+                                                  0x14, 0x3E, 0x01, 0x12, 0x02};
+
+  arch::CPU expected{};
+  arch::CPU actual{};
+  arch::Memory expected_mem{};
+  arch::Memory actual_mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(expected_mem, program);
+  load_program(actual_mem, program);
+
+  arch::Jit jit{};
+  expected.run(expected_mem, graphics, keypad, 1001);
+  const auto translated = jit.run(actual, actual_mem, graphics, keypad, 1001);
+
+  expect_same_state(expected, actual);
+  EXPECT_EQ(actual.get_general_reg(0x1), 250);
+  if (arch::Jit::available()) {
+    EXPECT_EQ(translated, 1001);
+  }
+}
+
+TEST(jit_test, runs_exact_count) {
+  // Same loop as above, stopping part way through a block
+  constexpr std::array<unsigned char, 10> program{0x60, 0x03, 0x71, 0x01, 0x80,
+                                                  0x14, 0x3E, 0x01, 0x12, 0x02};
+
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  arch::Jit jit{};
+
+  for (size_t count = 1; count < 12; count++) {
+    arch::CPU expected{};
+    arch::CPU actual{};
+    arch::Memory mem{};
+    load_program(mem, program);
+
+    expected.run(mem, graphics, keypad, count);
+    jit.run(actual, mem, graphics, keypad, count);
+
+    SCOPED_TRACE(count);
+    expect_same_state(expected, actual);
+  }
+}
+
+TEST(jit_test, interprets_untranslated_instructions) {
+  // 0x200: 6105 (V1 = 5), 0x202: F115 (delay timer = V1), 0x204: 2208 (call 0x208),
+  // 0x206: 1206 (jump to self), 0x208: 7201 (V2 += 1), 0x20A: 00EE (return)
+  constexpr std::array<unsigned char, 12> program{0x61, 0x05, 0xF1, 0x15, 0x22, 0x08,
+                                                  0x12, 0x06, 0x72, 0x01, 0x00, 0xEE};
+
+  arch::CPU expected{};
+  arch::CPU actual{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem, program);
+
+  arch::Jit jit{};
+  expected.run(mem, graphics, keypad, 20);
+  jit.run(actual, mem, graphics, keypad, 20);
+
+  expect_same_state(expected, actual);
+  EXPECT_EQ(actual.delay_timer_reg, 5);
+  EXPECT_EQ(actual.get_general_reg(0x2), 1);
+  EXPECT_EQ(actual.get_stack_pointer(), expected.get_stack_pointer());
+}
+
+TEST(jit_test, self_modifying_code_is_retranslated) {
+  // 0x200: 6062 (V0 = 0x62), 0x202: 6107 (V1 = 0x07), 0x204: A208 (I = 0x208),
+  // 0x206: 1208 (jump to 0x208), 0x208: 6203 (V2 = 3), 0x20A: 3E01 (skip if VE == 1),
+  // 0x20C: 1210 (jump to 0x210), 0x20E: 120E (jump to self), 0x210: F155 (store V0 and V1 over
+  // 0x208 making it 6207), 0x212: 6E01 (VE = 1), 0x214: 1208 (jump to 0x208)
+  constexpr std::array<unsigned char, 22> program{0x60, 0x62, 0x61, 0x07, 0xA2, 0x08, 0x12, 0x08,
+                                                  0x62, 0x03, 0x3E, 0x01, 0x12, 0x10, 0x12, 0x0E,
+                                                  0xF1, 0x55, 0x6E, 0x01, 0x12, 0x08};
+
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem, program);
+
+  arch::Jit jit{};
+  jit.run(cpu, mem, graphics, keypad, 50);
+
+  EXPECT_EQ(cpu.get_general_reg(0x2), 7);
+  EXPECT_EQ(cpu.pc_reg, 0x20E);
+}
+
+TEST(jit_test, invalidate_drops_translation) {
+  // 0x200: 6203 (V2 = 3), 0x202: 1200 (jump to 0x200)
+  constexpr std::array<unsigned char, 4> program{0x62, 0x03, 0x12, 0x00};
+
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem, program);
+
+  arch::Jit jit{};
+  jit.run(cpu, mem, graphics, keypad, 10);
+  EXPECT_EQ(cpu.get_general_reg(0x2), 3);
+
+  mem.set_value(0x201, 0x09);
+  jit.invalidate(0x201);
+  jit.run(cpu, mem, graphics, keypad, 10);
+  EXPECT_EQ(cpu.get_general_reg(0x2), 9);
+}
+
+TEST(jit_test, wrapped_store_drops_translation) {
+  // 0x000: 6203 (V2 = 3), 0x002: 1000 (jump to 0x000)
+  constexpr std::array<unsigned char, 4> low{0x62, 0x03, 0x10, 0x00};
+  // 0x200: 6162 (V1 = 0x62), 0x202: 6209 (V2 = 9), 0x204: AFFF (I = 0xFFF), 0x206: F255 (store
+  // V0 to V2 over 0xFFF, 0x000 and 0x001 making 0x000 6209), 0x208: 1000 (jump to 0x000)
+  constexpr std::array<unsigned char, 10> program{0x61, 0x62, 0x62, 0x09, 0xAF,
+                                                  0xFF, 0xF2, 0x55, 0x10, 0x00};
+
+  arch::BasicCPU<arch::WrappingAccess> cpu{};
+  arch::BasicMemory<arch::WrappingAccess> mem{};
+  arch::BasicGraphics<arch::WrappingAccess> graphics{};
+  arch::Keypad keypad{};
+  for (size_t i = 0; i < low.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(i), low[i]);
+  }
+  for (size_t i = 0; i < program.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  arch::Jit jit{};
+  cpu.pc_reg = 0x000;
+  jit.run(cpu, mem, graphics, keypad, 10);
+  EXPECT_EQ(cpu.get_general_reg(0x2), 3);
+
+  cpu.pc_reg = 0x200;
+  jit.run(cpu, mem, graphics, keypad, 5 + 2);
+  EXPECT_EQ(mem.get_value(0x000), 0x62);
+  EXPECT_EQ(mem.get_value(0x001), 0x09);
+  EXPECT_EQ(cpu.get_general_reg(0x2), 9);
+  EXPECT_EQ(cpu.pc_reg, 0x000);
+}
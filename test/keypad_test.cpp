@@ -8,4 +8,5 @@ TEST(keypad_test, test_constructor) {
   for (auto key = 0; key < arch::keypad::num_of_keys; key++) {
     EXPECT_EQ(keypad.is_pressed(static_cast<unsigned char>(key)), false);
   }
+  EXPECT_EQ(keypad.key_pressed, false);
 }
@@ -0,0 +1,96 @@
+#include "latency.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+#  include <vector>
+
+#  include "chip8.h"
+#  include "cpu.h"
+#  include "graphics.h"
+#  include "keypad.h"
+#  include "memory.h"
+#endif
+
+TEST(latency_test, buckets_cover_every_value_tightly) {
+  using Histogram = arch::LatencyHistogram;
+  for (unsigned long long ns = 0; ns < 100'000; ns++) {
+    const auto bucket = Histogram::bucket_of(ns);
+    EXPECT_GE(Histogram::bucket_end(bucket), ns);
+    // Off by no more than an eighth
+    EXPECT_LE(Histogram::bucket_end(bucket) - ns, ns / Histogram::sub_buckets);
+    if (bucket > 0) {
+      EXPECT_LT(Histogram::bucket_end(bucket - 1), ns);
+    }
+  }
+  EXPECT_EQ(Histogram::bucket_of(~0ULL), Histogram::num_buckets - 1);
+  EXPECT_EQ(Histogram::bucket_end(Histogram::num_buckets - 1), ~0ULL);
+}
+
+TEST(latency_test, percentiles) {
+  arch::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.percentile(0.5), std::chrono::nanoseconds(0));
+
+  for (auto ns = 1; ns <= 1000; ns++) {
+    histogram.record(std::chrono::nanoseconds(ns));
+  }
+  EXPECT_EQ(histogram.count(), 1000);
+  EXPECT_GE(histogram.percentile(0.5), std::chrono::nanoseconds(500));
+  EXPECT_LE(histogram.percentile(0.5), std::chrono::nanoseconds(500 + 500 / 8));
+  EXPECT_GE(histogram.percentile(0.99), std::chrono::nanoseconds(990));
+  // Never past the largest latency recorded
+  EXPECT_EQ(histogram.percentile(0.999), std::chrono::nanoseconds(1000));
+  EXPECT_EQ(histogram.max(), std::chrono::nanoseconds(1000));
+
+  // A single outlier only shows in the tail
+  histogram.record(std::chrono::milliseconds(5));
+  EXPECT_LE(histogram.percentile(0.99), std::chrono::nanoseconds(1000 + 1000 / 8));
+  EXPECT_EQ(histogram.percentile(1.0), std::chrono::milliseconds(5));
+}
+
+TEST(latency_test, handler_report_lists_executed_forms) {
+  arch::HandlerLatencies latencies{};
+  latencies[static_cast<size_t>(arch::Op::op_7XNN)].record(std::chrono::nanoseconds(10));
+  latencies[static_cast<size_t>(arch::Op::op_DXYN)].record(std::chrono::nanoseconds(300));
+
+  const auto report = arch::handler_latency_report(latencies);
+  EXPECT_EQ(std::count(report.begin(), report.end(), '\n'), 2);
+  // Slowest tail first
+  EXPECT_LT(report.find("DXYN"), report.find("7XNN"));
+  EXPECT_NE(report.find("p99.9"), std::string::npos);
+}
+
+#if defined(CHIP8_LATENCY_HISTOGRAMS)
+TEST(latency_test, cpu_times_every_handler) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  // 0x200: 7001 (V0 += 1), 0x202: 1200 (jump to 0x200)
+  mem.set_value(0x200, 0x70);
+  mem.set_value(0x201, 0x01);
+  mem.set_value(0x202, 0x12);
+  mem.set_value(0x203, 0x00);
+
+  cpu.run(mem, graphics, keypad, 10);
+  EXPECT_EQ(cpu.handler_latencies[static_cast<size_t>(arch::Op::op_7XNN)].count(), 5);
+  EXPECT_EQ(cpu.handler_latencies[static_cast<size_t>(arch::Op::op_1NNN)].count(), 5);
+}
+
+TEST(latency_test, chip8_times_hot_code) {
+  // 0x200: 7001 (V0 += 1), 0x202: 7101 (V1 += 1), 0x204: 1200 (jump to 0x200)
+  Chip8 emulator(std::vector<unsigned char>{0x70, 0x01, 0x71, 0x01, 0x12, 0x00});
+  // Far enough for the loop to be promoted to every tier
+  emulator.run_cycles(30 * arch::default_hot_threshold);
+
+  const auto& latencies = emulator.handler_latencies();
+  EXPECT_EQ(latencies[static_cast<size_t>(arch::Op::op_7XNN)].count(),
+            20 * arch::default_hot_threshold);
+  EXPECT_EQ(latencies[static_cast<size_t>(arch::Op::op_1NNN)].count(),
+            10 * arch::default_hot_threshold);
+}
+#endif
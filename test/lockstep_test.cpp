@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "lockstep.h"
+
+namespace {
+  // One lane run on its own, to compare the lanes of a lockstep engine against
+  struct Reference {
+    explicit Reference(const arch::Memory& image) : mem(image) {}
+
+    arch::CPU cpu{};
+    arch::Memory mem;
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+  };
+
+  void tick(arch::CPU& cpu) {
+    if (cpu.delay_timer_reg > 0) {
+      cpu.delay_timer_reg--;
+    }
+    if (cpu.sound_timer_reg > 0) {
+      cpu.sound_timer_reg--;
+    }
+  }
+
+  void expect_lane_matches(const arch::Lockstep& engine, size_t lane, const Reference& reference) {
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(engine.general_reg(lane, reg), reference.cpu.get_general_reg(reg))
+          << "lane " << lane << " V" << reg;
+    }
+    EXPECT_EQ(engine.index_reg(lane), reference.cpu.index_reg) << "lane " << lane;
+    EXPECT_EQ(engine.pc_reg(lane), reference.cpu.pc_reg) << "lane " << lane;
+    EXPECT_EQ(engine.delay_timer(lane), reference.cpu.delay_timer_reg) << "lane " << lane;
+    EXPECT_EQ(engine.sound_timer(lane), reference.cpu.sound_timer_reg) << "lane " << lane;
+  }
+
+  // Runs lanes lanes of program in lockstep and on their own for frames bursts of count
+  // instructions with a timer tick after each, each lane drawing its own random numbers, and checks
+  // that every lane ends up where it would on its own
+  arch::LockstepCounters compare_runs(const std::vector<unsigned char>& program, size_t lanes,
+                                      size_t frames, size_t count) {
+    const auto image = boot_memory<arch::CheckedAccess>(program);
+    arch::Lockstep engine(image, lanes);
+    std::vector<Reference> references(lanes, Reference(image));
+    for (size_t lane = 0; lane < lanes; lane++) {
+      engine.seed_rng(lane, static_cast<unsigned int>(lane));
+      references[lane].cpu.seed_rng(static_cast<unsigned int>(lane));
+    }
+
+    for (size_t frame = 0; frame < frames; frame++) {
+      engine.run(count);
+      engine.tick_timers();
+      for (auto& reference : references) {
+        reference.cpu.try_run(reference.mem, reference.graphics, reference.keypad, count);
+        tick(reference.cpu);
+      }
+    }
+    for (size_t lane = 0; lane < lanes; lane++) {
+      expect_lane_matches(engine, lane, references[lane]);
+      EXPECT_EQ(engine.memory(lane).get_value(0x300), references[lane].mem.get_value(0x300));
+    }
+    return engine.counters();
+  }
+}  // namespace
+
+TEST(lockstep_test, converged_lanes_step_together) {
+  // 0x200: 7001 (V0 += 1), 0x202: 8014 (V0 += V1), 0x204: 8125 (V1 -= V2), 0x206: 7201 (V2 += 1),
+  // 0x208: 1200 (jump to 0x200)
+  const auto counters
+      = compare_runs({0x70, 0x01, 0x80, 0x14, 0x81, 0x25, 0x72, 0x01, 0x12, 0x00}, 100, 3, 50);
+  EXPECT_EQ(counters.vector_instructions, 100 * 3 * 50);
+  EXPECT_EQ(counters.vector_steps, 3 * 50);
+  EXPECT_EQ(counters.scalar_instructions, 0);
+}
+
+TEST(lockstep_test, diverged_lanes_match_independent_runs) {
+  // 0x200: C00F (V0 = random & 0x0F), 0x202: 6105 (V1 = 5), 0x204: 8014 (V0 += V1),
+  // 0x206: 3008 (skip if V0 == 8), 0x208: 7201 (V2 += 1), 0x20A: A300 (I = 0x300),
+  // 0x20C: F21E (I += V2), 0x20E: F233 (BCD of V2 at I), 0x210: 8126 (V1 = V2 >> 1),
+  // 0x212: 2216 (call 0x216), 0x214: 1200 (jump to 0x200), 0x216: 8307 (V3 = V0 - V3),
+  // 0x218: F315 (delay timer = V3), 0x21A: F407 (V4 = delay timer), 0x21C: 00EE (return)
+  const auto counters = compare_runs({0xC0, 0x0F, 0x61, 0x05, 0x80, 0x14, 0x30, 0x08,
+                                      0x72, 0x01, 0xA3, 0x00, 0xF2, 0x1E, 0xF2, 0x33,
+                                      0x81, 0x26, 0x22, 0x16, 0x12, 0x00, 0x83, 0x07,
+                                      0xF3, 0x15, 0xF4, 0x07, 0x00, 0xEE},
+                                     67, 4, 97);
+  EXPECT_EQ(counters.vector_instructions + counters.scalar_instructions, 67 * 4 * 97);
+  EXPECT_GT(counters.vector_instructions, counters.scalar_instructions);
+}
+
+TEST(lockstep_test, lanes_that_rewrite_code_diverge) {
+  // 0x200: C0FF (V0 = random), 0x202: A209 (I = 0x209), 0x204: F055 (store V0 at I),
+  // 0x206: 6100 (V1 = 0), 0x208: 7100 (V1 += the stored random number), 0x20A: 1200 (jump to 0x200)
+  compare_runs({0xC0, 0xFF, 0xA2, 0x09, 0xF0, 0x55, 0x61, 0x00, 0x71, 0x00, 0x12, 0x00}, 40, 2,
+               33);
+}
+
+TEST(lockstep_test, trap_stops_only_its_lane) {
+  // 0x200: E09E (skip if key V0 is pressed), 0x202: 1200 (jump to 0x200), 0x204: 00EE (return with
+  // nothing on the stack)
+  arch::Lockstep engine(boot_memory<arch::CheckedAccess>({0xE0, 0x9E, 0x12, 0x00, 0x00, 0xEE}), 3);
+  engine.keypad(1).press_key(0);
+  engine.run(10);
+
+  EXPECT_EQ(engine.trap(1).fault, arch::Fault::stack_underflow);
+  EXPECT_EQ(engine.trap(1).pc, 0x204);
+  EXPECT_EQ(engine.trap(0).fault, arch::Fault::none);
+  EXPECT_EQ(engine.trap(2).fault, arch::Fault::none);
+  EXPECT_EQ(engine.pc_reg(0), 0x200);
+}
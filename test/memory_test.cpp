@@ -6,6 +6,8 @@
 #include <random>
 #include <tuple>
 
+#include "cpu.h"
+
 TEST(memory_test, set_get_single_value) {
   arch::Memory test_mem;
   constexpr unsigned short test_address = 100;
@@ -216,4 +218,61 @@ TEST(memory_test, fail_set_many_random_indicies_out_of_bounds) {
     }
     count++;
   }
-}
\ No newline at end of file
+}
+TEST(memory_test, decoded_slot_empty_by_default) {
+  arch::Memory test_mem{};
+
+  EXPECT_EQ(test_mem.get_decoded(0x200), nullptr);
+  EXPECT_EQ(test_mem.get_decoded(arch::max_mem_address - 1), nullptr);
+}
+
+TEST(memory_test, decoded_slot_set_get) {
+  arch::Memory test_mem{};
+  const auto instruction = arch::CPU::decode(0x6A12);
+
+  test_mem.set_decoded(0x200, instruction);
+  const auto* result = test_mem.get_decoded(0x200);
+
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->opcode, 0x6A12);
+  EXPECT_EQ(result->x, 0xA);
+  EXPECT_EQ(result->nn, 0x12);
+}
+
+TEST(memory_test, decoded_slot_ignores_odd_and_out_of_bounds_address) {
+  arch::Memory test_mem{};
+  const auto instruction = arch::CPU::decode(0x6A12);
+
+  test_mem.set_decoded(0x201, instruction);
+  test_mem.set_decoded(arch::mem_size, instruction);
+
+  EXPECT_EQ(test_mem.get_decoded(0x200), nullptr);
+  EXPECT_EQ(test_mem.get_decoded(0x201), nullptr);
+  EXPECT_EQ(test_mem.get_decoded(arch::mem_size), nullptr);
+}
+
+TEST(memory_test, decoded_slot_invalidated_by_write_to_either_byte) {
+  arch::Memory test_mem{};
+  const auto instruction = arch::CPU::decode(0x6A12);
+
+  test_mem.set_decoded(0x300, instruction);
+  test_mem.set_value(0x300, 0x7A);
+  EXPECT_EQ(test_mem.get_decoded(0x300), nullptr);
+
+  test_mem.set_decoded(0x300, instruction);
+  test_mem.set_value(0x301, 0x34);
+  EXPECT_EQ(test_mem.get_decoded(0x300), nullptr);
+
+  // Neighbouring slots are left untouched
+  test_mem.set_decoded(0x302, instruction);
+  test_mem.set_value(0x301, 0x35);
+  EXPECT_NE(test_mem.get_decoded(0x302), nullptr);
+}
+
+TEST(memory_test, wrapping_access_wraps_out_of_bounds_address) {
+  arch::BasicMemory<arch::WrappingAccess> test_mem{};
+
+  test_mem.set_value(arch::mem_size + 0x10, 0x5A);
+  EXPECT_EQ(test_mem.get_value(0x10), 0x5A);
+  EXPECT_EQ(test_mem.get_value(arch::mem_size + 0x10), 0x5A);
+}
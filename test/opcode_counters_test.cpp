@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  size_t count_lines(const std::string& text) {
+    return static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+  }
+}  // namespace
+
+TEST(opcode_counters_test, counts_and_sorts_report) {
+  arch::OpcodeCounters counters{};
+  counters.count(arch::Op::op_6XNN, 0x6003, false);
+  for (auto i = 0; i < 3; i++) {
+    counters.count(arch::Op::op_3XNN, 0x3000, i == 2);
+    counters.count(arch::Op::op_7XNN, 0x70FF, false);
+  }
+  counters.count(arch::Op::op_1NNN, 0x1202, true);
+
+  EXPECT_EQ(counters.forms[static_cast<size_t>(arch::Op::op_3XNN)], 3);
+  EXPECT_EQ(counters.skips_taken[static_cast<size_t>(arch::Op::op_3XNN)], 1);
+  EXPECT_EQ(counters.skips_taken[static_cast<size_t>(arch::Op::op_1NNN)], 0);
+  EXPECT_EQ(counters.opcodes[0x70FF], 3);
+
+  const auto report = arch::opcode_report(counters);
+  // Header, blank, forms heading, 4 forms, blank, skips heading, 1 skip, blank, opcodes heading,
+  // 4 opcodes
+  EXPECT_EQ(count_lines(report), 16);
+  EXPECT_NE(report.find("8 instructions"), std::string::npos);
+  EXPECT_NE(report.find("3XNN"), std::string::npos);
+  EXPECT_NE(report.find("ADD V0, 0xFF"), std::string::npos);
+  // Most frequent first, ties keep Op order
+  EXPECT_LT(report.find("3XNN"), report.find("7XNN"));
+  EXPECT_LT(report.find("7XNN"), report.find("1NNN"));
+  EXPECT_LT(report.find("1NNN"), report.find("6XNN"));
+}
+
+TEST(opcode_counters_test, empty_report) {
+  const auto report = arch::opcode_report(arch::OpcodeCounters{});
+  EXPECT_NE(report.find("0 instructions"), std::string::npos);
+  EXPECT_EQ(count_lines(report), 7);
+}
+
+#if defined(CHIP8_OPCODE_COUNTERS)
+namespace {
+  // 0x200: 6003 (V0 = 3), 0x202: 70FF (V0 -= 1), 0x204: 3000 (skip if V0 == 0),
+  // 0x206: 1202 (jump to 0x202), 0x208: 1208 (jump to 0x208)
+  constexpr std::array<unsigned char, 10> program{0x60, 0x03, 0x70, 0xFF, 0x30,
+                                                  0x00, 0x12, 0x02, 0x12, 0x08};
+
+  void load_program(arch::Memory& mem) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+  }
+}  // namespace
+
+TEST(opcode_counters_test, cpu_counts_every_engine) {
+  for (const auto dispatch : {arch::Dispatch::switch_table, arch::Dispatch::threaded}) {
+    arch::CPU cpu{};
+    arch::Memory mem{};
+    arch::Graphics graphics{};
+    arch::Keypad keypad{};
+    load_program(mem);
+    cpu.dispatch = dispatch;
+
+    // V0 = 3, then three passes of the loop, the last of which skips the jump back
+    cpu.run(mem, graphics, keypad, 1 + 3 * 2 + 2);
+    EXPECT_EQ(cpu.pc_reg, 0x208);
+
+    const auto& counters = cpu.opcode_counters;
+    EXPECT_EQ(counters.forms[static_cast<size_t>(arch::Op::op_6XNN)], 1);
+    EXPECT_EQ(counters.forms[static_cast<size_t>(arch::Op::op_7XNN)], 3);
+    EXPECT_EQ(counters.forms[static_cast<size_t>(arch::Op::op_3XNN)], 3);
+    EXPECT_EQ(counters.skips_taken[static_cast<size_t>(arch::Op::op_3XNN)], 1);
+    EXPECT_EQ(counters.forms[static_cast<size_t>(arch::Op::op_1NNN)], 2);
+    EXPECT_EQ(counters.opcodes[0x1202], 2);
+  }
+}
+
+TEST(opcode_counters_test, chip8_counts_hot_code) {
+  Chip8 emulator(std::vector<unsigned char>(program.begin(), program.end()));
+  // Far enough into the jump to self at 0x208 for it to be promoted to every tier
+  const auto cycles = emulator.run_cycles(10 * arch::default_hot_threshold).cycles;
+
+  const auto& forms = emulator.opcode_counters().forms;
+  EXPECT_EQ(std::accumulate(forms.begin(), forms.end(), 0ull), cycles);
+}
+#endif
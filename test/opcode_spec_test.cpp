@@ -0,0 +1,72 @@
+#include "opcode_spec.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "cpu.h"
+
+TEST(opcode_spec_test, decode_matches_table_for_every_opcode) {
+  for (unsigned int opcode = 0; opcode <= 0xFFFF; opcode++) {
+    auto expected = arch::Op::op_invalid;
+    auto matches = 0;
+    for (const auto& spec : arch::opcode_specs) {
+      if ((opcode & spec.mask) == spec.pattern) {
+        expected = spec.op;
+        matches++;
+      }
+    }
+
+    SCOPED_TRACE(opcode);
+    ASSERT_LE(matches, 1);
+    ASSERT_EQ(arch::decode_op(static_cast<unsigned short>(opcode)), expected);
+  }
+}
+
+TEST(opcode_spec_test, every_form_has_its_own_entry) {
+  for (size_t i = 0; i < arch::opcode_specs.size(); i++) {
+    const auto& spec = arch::opcode_specs[i];
+    EXPECT_EQ(static_cast<size_t>(spec.op), i);
+    EXPECT_EQ(arch::decode_op(spec.pattern), spec.op);
+    EXPECT_FALSE(spec.mnemonic.empty());
+  }
+}
+
+TEST(opcode_spec_test, disassembles_operands) {
+  EXPECT_EQ(arch::disassemble(0x00E0), "CLS");
+  EXPECT_EQ(arch::disassemble(0x00EE), "RET");
+  EXPECT_EQ(arch::disassemble(0x1208), "JP 0x208");
+  EXPECT_EQ(arch::disassemble(0x3A0C), "SE VA, 0x0C");
+  EXPECT_EQ(arch::disassemble(0x8014), "ADD V0, V1");
+  EXPECT_EQ(arch::disassemble(0xA2F0), "LD I, 0x2F0");
+  EXPECT_EQ(arch::disassemble(0xB300), "JP V0, 0x300");
+  EXPECT_EQ(arch::disassemble(0xD125), "DRW V1, V2, 0x5");
+  EXPECT_EQ(arch::disassemble(0xE3A1), "SKNP V3");
+  EXPECT_EQ(arch::disassemble(0xF355), "LD [I], V3");
+  EXPECT_EQ(arch::disassemble(0xF265), "LD V2, [I]");
+}
+
+TEST(opcode_spec_test, disassembles_invalid_opcode_as_data) {
+  EXPECT_EQ(arch::disassemble(0x5121), "DW 0x5121");
+  EXPECT_EQ(arch::disassemble(0xF0FF), "DW 0xF0FF");
+}
+
+TEST(opcode_spec_test, names_forms) {
+  EXPECT_EQ(arch::form_name(arch::Op::op_00E0), "00E0");
+  EXPECT_EQ(arch::form_name(arch::Op::op_1NNN), "1NNN");
+  EXPECT_EQ(arch::form_name(arch::Op::op_8XY4), "8XY4");
+  EXPECT_EQ(arch::form_name(arch::Op::op_DXYN), "DXYN");
+  EXPECT_EQ(arch::form_name(arch::Op::op_FX65), "FX65");
+  EXPECT_EQ(arch::form_name(arch::Op::op_invalid), "invalid");
+}
+
+TEST(opcode_spec_test, trace_shows_operand_registers) {
+  arch::CPU cpu{};
+  cpu.set_general_reg(0x0, 0x05);
+  cpu.set_general_reg(0x1, 0x03);
+  cpu.index_reg = 0x2F0;
+
+  EXPECT_EQ(arch::trace_line(cpu, 0x200, 0x8014), "0200  8014  ADD V0, V1       V0=05 V1=03");
+  EXPECT_EQ(arch::trace_line(cpu, 0x202, 0xF11E), "0202  F11E  ADD I, V1        V1=03 I=2F0");
+  EXPECT_EQ(arch::trace_line(cpu, 0x204, 0x00E0), "0204  00E0  CLS");
+}
@@ -1660,4 +1660,37 @@ TEST(cpu_opcode_test, execute_instruction_EXA1_no_skip) {
   cpu.decode_execute(mem, graphics, keypad);
 
   EXPECT_EQ(cpu.pc_reg, 0x200);
-}
\ No newline at end of file
+}
+TEST(cpu_opcode_test, execute_instruction_FX0A_waits_for_key) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  cpu.curr_opcode = 0xF30A;
+  cpu.pc_reg = 0x202;
+
+  cpu.decode_execute(mem, graphics, keypad);
+
+  EXPECT_EQ(cpu.pc_reg, 0x200);
+  EXPECT_TRUE(cpu.waiting_for_key);
+}
+
+TEST(cpu_opcode_test, execute_instruction_FX0A_key_pressed) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  cpu.curr_opcode = 0xF30A;
+  cpu.pc_reg = 0x202;
+  cpu.waiting_for_key = true;
+
+  keypad.press_key(0xB);
+
+  cpu.decode_execute(mem, graphics, keypad);
+
+  EXPECT_EQ(cpu.pc_reg, 0x202);
+  EXPECT_EQ(cpu.get_general_reg(0x3), 0xB);
+  EXPECT_FALSE(cpu.waiting_for_key);
+}
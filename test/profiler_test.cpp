@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+#include "profiler.h"
+
+#if defined(CHIP8_PROFILER)
+#  include "chip8.h"
+#endif
+
+namespace {
+  // 0x200: 6003 (V0 = 3), 0x202: 70FF (V0 -= 1), 0x204: 3000 (skip if V0 == 0),
+  // 0x206: 1202 (jump to 0x202), 0x208: 1208 (jump to 0x208)
+  constexpr std::array<unsigned char, 10> program{0x60, 0x03, 0x70, 0xFF, 0x30,
+                                                  0x00, 0x12, 0x02, 0x12, 0x08};
+
+  void load_program(arch::Memory& mem) {
+    for (size_t i = 0; i < program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+    }
+  }
+
+  // Samples of one run of program, with the final jump to itself taken 5 times
+  void record_run(arch::Profiler& profiler) {
+    profiler.record(0x200, 1);
+    for (auto i = 0; i < 3; i++) {
+      profiler.record(0x202, 1);
+      profiler.record(0x204, 1);
+    }
+    profiler.record(0x206, 2);
+    profiler.record(0x208, 5);
+  }
+}  // namespace
+
+TEST(profiler_test, exact_counts_every_unit) {
+  arch::Profiler profiler;
+  profiler.record(0x200, 1);
+  profiler.record(0x202, 12);
+  EXPECT_EQ(profiler.samples()[0x200], 1);
+  EXPECT_EQ(profiler.samples()[0x202], 12);
+  EXPECT_EQ(profiler.total_samples(), 13);
+}
+
+TEST(profiler_test, samples_once_per_period) {
+  arch::Profiler profiler(10);
+  for (auto i = 0; i < 7; i++) {
+    profiler.record(static_cast<unsigned short>(0x200 + 2 * i), 3);
+  }
+  // The period is crossed after 12 and 21 units, by the 4th and the 7th instruction
+  EXPECT_EQ(profiler.total_samples(), 2);
+  EXPECT_EQ(profiler.samples()[0x206], 1);
+  EXPECT_EQ(profiler.samples()[0x20C], 1);
+
+  // A long stretch, such as a skipped idle loop, can take several samples at once
+  profiler.record(0x300, 35);
+  EXPECT_EQ(profiler.samples()[0x300], 3);
+
+  profiler.set_sample_period(0);
+  EXPECT_EQ(profiler.sample_period(), 1);
+  EXPECT_EQ(profiler.total_samples(), 0);
+  EXPECT_EQ(profiler.samples()[0x300], 0);
+}
+
+TEST(profiler_test, groups_basic_blocks) {
+  arch::Memory mem{};
+  load_program(mem);
+  arch::Profiler profiler;
+  record_run(profiler);
+
+  const auto blocks = arch::profile_blocks(profiler, mem);
+  ASSERT_EQ(blocks.size(), 4);
+  // The loop body is entered by the jump back, and the skip and the jump each end a block
+  EXPECT_EQ(blocks[0].first, 0x202);
+  EXPECT_EQ(blocks[0].last, 0x204);
+  EXPECT_EQ(blocks[0].samples, 6);
+  EXPECT_EQ(blocks[1].first, 0x208);
+  EXPECT_EQ(blocks[2].first, 0x206);
+  EXPECT_EQ(blocks[3].first, 0x200);
+  EXPECT_EQ(blocks[3].samples, 1);
+}
+
+TEST(profiler_test, report_lists_hottest_blocks) {
+  arch::Memory mem{};
+  load_program(mem);
+  arch::Profiler profiler;
+  record_run(profiler);
+
+  const auto report = arch::profile_report(profiler, mem, 2);
+  EXPECT_NE(report.find("14 units of guest time, counted exactly"), std::string::npos);
+  EXPECT_NE(report.find("block 0202-0204"), std::string::npos);
+  EXPECT_NE(report.find("0202  70FF  ADD V0, 0xFF"), std::string::npos);
+  EXPECT_NE(report.find("2 colder blocks not shown"), std::string::npos);
+  EXPECT_EQ(report.find("block 0200"), std::string::npos);
+  EXPECT_LT(report.find("block 0202"), report.find("block 0208"));
+}
+
+#if defined(CHIP8_PROFILER)
+TEST(profiler_test, chip8_profiles_executed_instructions) {
+  Chip8 emulator(std::vector<unsigned char>(program.begin(), program.end()));
+  emulator.run_cycles(1 + 3 * 2 + 2 + 5);
+
+  const auto& profiler = emulator.guest_profiler();
+  EXPECT_EQ(profiler.total_samples(), 14);
+  EXPECT_EQ(profiler.samples()[0x202], 3);
+  EXPECT_EQ(profiler.samples()[0x206], 2);
+  EXPECT_EQ(profiler.samples()[0x208], 5);
+}
+#endif
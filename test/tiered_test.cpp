@@ -0,0 +1,166 @@
+#include "tiered.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "graphics.h"
+#include "keypad.h"
+#include "memory.h"
+
+namespace {
+  // 0x200: 6003 (V0 = 3), 0x202: 7101 (V1 += 1), 0x204: 8014 (V0 += V1),
+  // 0x206: 3E01 (skip if VE == 1), 0x208: 1202 (jump to 0x202)
+  constexpr std::array<unsigned char, 10> loop_program{0x60, 0x03, 0x71, 0x01, 0x80,
+                                                       0x14, 0x3E, 0x01, 0x12, 0x02};
+
+  void load_program(arch::Memory& mem) {
+    for (size_t i = 0; i < loop_program.size(); i++) {
+      mem.set_value(static_cast<unsigned short>(0x200 + i), loop_program[i]);
+    }
+  }
+}  // namespace
+
+TEST(tiered_test, starts_in_interpreter) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem);
+
+  arch::TieredEngine engine{};
+  engine.run(cpu, mem, graphics, keypad, 10);
+
+  EXPECT_EQ(engine.counters().interpreter, 10);
+  EXPECT_EQ(engine.counters().predecoded, 0);
+  EXPECT_EQ(engine.counters().translated, 0);
+  EXPECT_EQ(engine.tier_of(0x202), arch::Tier::interpreter);
+  // Nothing was predecoded
+  EXPECT_EQ(mem.get_decoded(0x202), nullptr);
+}
+
+TEST(tiered_test, promotes_hot_addresses) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem);
+
+  arch::TieredEngine engine(4);
+  // 0x200 runs once then 0x202 to 0x208 loop, each reaching 4 executions after 17 instructions
+  engine.run(cpu, mem, graphics, keypad, 17);
+
+  EXPECT_EQ(engine.tier_of(0x200), arch::Tier::interpreter);
+  EXPECT_EQ(engine.tier_of(0x202), arch::Tier::predecoded);
+  EXPECT_EQ(engine.tier_of(0x208), arch::Tier::predecoded);
+
+  engine.run(cpu, mem, graphics, keypad, 16);
+  if (arch::Jit::available()) {
+    EXPECT_EQ(engine.tier_of(0x202), arch::Tier::translated);
+  } else {
+    EXPECT_EQ(engine.tier_of(0x202), arch::Tier::predecoded);
+  }
+
+  engine.run(cpu, mem, graphics, keypad, 1000);
+  const auto& counters = engine.counters();
+  EXPECT_EQ(counters.interpreter + counters.predecoded + counters.translated, 1033);
+  if (arch::Jit::available()) {
+    EXPECT_GT(counters.translated, 900);
+  }
+}
+
+TEST(tiered_test, tiers_agree) {
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+
+  arch::CPU expected{};
+  arch::Memory expected_mem{};
+  load_program(expected_mem);
+  expected.run(expected_mem, graphics, keypad, 1001);
+
+  for (auto tier : {arch::Tier::interpreter, arch::Tier::predecoded, arch::Tier::translated}) {
+    arch::CPU cpu{};
+    arch::Memory mem{};
+    load_program(mem);
+
+    arch::TieredEngine engine{};
+    engine.forced_tier = tier;
+    engine.run(cpu, mem, graphics, keypad, 1001);
+
+    EXPECT_EQ(cpu.pc_reg, expected.pc_reg);
+    EXPECT_EQ(cpu.curr_opcode, expected.curr_opcode);
+    for (size_t reg = 0; reg < arch::num_general_reg; reg++) {
+      EXPECT_EQ(cpu.get_general_reg(reg), expected.get_general_reg(reg));
+    }
+    // Forcing a tier does not promote anything
+    EXPECT_EQ(engine.tier_of(0x202), arch::Tier::interpreter);
+  }
+}
+
+TEST(tiered_test, forced_tier_is_counted) {
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  load_program(mem);
+
+  arch::TieredEngine engine{};
+  engine.forced_tier = arch::Tier::predecoded;
+  engine.run(cpu, mem, graphics, keypad, 25);
+
+  EXPECT_EQ(engine.counters().interpreter, 0);
+  EXPECT_EQ(engine.counters().predecoded, 25);
+
+  engine.reset();
+  EXPECT_EQ(engine.counters().predecoded, 0);
+}
+
+TEST(tiered_test, interpreter_stores_drop_translations) {
+  // 0x200: 6203 (V2 = 3), 0x202: 6062 (V0 = 0x62), 0x204: 6109 (V1 = 0x09),
+  // 0x206: A200 (I = 0x200), 0x208: F155 (store V0 and V1 over 0x200 making it 6209),
+  // 0x20A: 1200 (jump to 0x200)
+  constexpr std::array<unsigned char, 12> program{0x62, 0x03, 0x60, 0x62, 0x61, 0x09,
+                                                  0xA2, 0x00, 0xF1, 0x55, 0x12, 0x00};
+
+  arch::CPU cpu{};
+  arch::Memory mem{};
+  arch::Graphics graphics{};
+  arch::Keypad keypad{};
+  for (size_t i = 0; i < program.size(); i++) {
+    mem.set_value(static_cast<unsigned short>(0x200 + i), program[i]);
+  }
+
+  arch::TieredEngine engine{};
+  // Translate the block at 0x200 before the store runs in the interpreter
+  engine.forced_tier = arch::Tier::translated;
+  engine.run(cpu, mem, graphics, keypad, 4);
+  engine.forced_tier = arch::Tier::interpreter;
+  engine.run(cpu, mem, graphics, keypad, 2);
+  engine.forced_tier = arch::Tier::translated;
+  engine.run(cpu, mem, graphics, keypad, 4);
+
+  EXPECT_EQ(cpu.get_general_reg(0x2), 9);
+}
+
+TEST(tiered_test, chip8_runs_hot_blocks_translated) {
+  Chip8 emulator(std::vector<unsigned char>(loop_program.begin(), loop_program.end()));
+  // Frames long enough for the whole loop body to fit in a batch many times over
+  emulator.set_instructions_per_second(1000000);
+
+  const auto result = emulator.run_cycles(100000);
+  EXPECT_EQ(result.cycles, 100000);
+
+  // Once warm the loop is the 3 instruction block at 0x202 ending in the skip and the jump at
+  // 0x208, which only run translated when whole blocks fit in what the engine is handed
+  const auto& counters = emulator.tier_counters();
+  EXPECT_EQ(counters.interpreter + counters.predecoded + counters.translated, 100000);
+#if !defined(CHIP8_PROFILER)
+  // Profiled builds hand the engine one instruction at a time to time every address
+  if (arch::Jit::available()) {
+    EXPECT_GT(counters.translated, 99000);
+  }
+#endif
+}
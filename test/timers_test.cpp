@@ -0,0 +1,51 @@
+#include "timers.h"
+
+#include <gtest/gtest.h>
+
+TEST(timers_test, ticks_sixty_times_per_second_of_guest_time) {
+  for (unsigned int ips : {60, 61, 500, 700, 1000, 1234567}) {
+    arch::TimerUnit stepped(ips);
+    size_t ticks = 0;
+    for (unsigned int i = 0; i < ips; i++) {
+      ticks += stepped.step();
+    }
+
+    arch::TimerUnit batched(ips);
+    SCOPED_TRACE(ips);
+    EXPECT_EQ(ticks, arch::timer_frequency);
+    EXPECT_EQ(batched.advance(ips), arch::timer_frequency);
+    EXPECT_EQ(stepped.next_timer_event(), batched.next_timer_event());
+  }
+}
+
+TEST(timers_test, next_timer_event_ends_on_tick) {
+  arch::TimerUnit timers(700);
+  size_t cycles = 0;
+  for (auto tick = 0; tick < 60; tick++) {
+    const auto until_tick = timers.next_timer_event();
+    EXPECT_GE(until_tick, 11);
+    EXPECT_LE(until_tick, 12);
+    EXPECT_EQ(timers.advance(until_tick - 1), 0);
+    EXPECT_EQ(timers.step(), 1);
+    cycles += until_tick;
+  }
+  EXPECT_EQ(cycles, 700);
+}
+
+TEST(timers_test, slow_rates_tick_more_than_once_per_instruction) {
+  arch::TimerUnit timers(20);
+  EXPECT_EQ(timers.next_timer_event(), 1);
+  EXPECT_EQ(timers.step(), 3);
+
+  timers.set_instructions_per_second(0);
+  EXPECT_EQ(timers.instructions_per_second(), 1);
+  EXPECT_EQ(timers.step(), 60);
+}
+
+TEST(timers_test, changing_rate_starts_fresh_period) {
+  arch::TimerUnit timers(700);
+  timers.advance(5);
+  timers.set_instructions_per_second(120);
+  EXPECT_EQ(timers.next_timer_event(), 2);
+  EXPECT_EQ(timers.advance(2), 1);
+}
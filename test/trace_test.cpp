@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(CHIP8_TRACE)
+#  include "chip8.h"
+#endif
+
+namespace {
+  arch::TraceRecord record_at(unsigned short pc, unsigned char delay) {
+    return {pc, 0x7001, 0x000, 0x0, static_cast<unsigned char>(pc), 0x00, delay, 0x00, 0};
+  }
+}  // namespace
+
+TEST(trace_test, keeps_most_recent_records) {
+  arch::TraceBuffer trace(3);
+  EXPECT_EQ(trace.capacity(), 4);
+
+  for (unsigned short i = 0; i < 6; i++) {
+    trace.write(record_at(static_cast<unsigned short>(0x200 + 2 * i), 0));
+  }
+  EXPECT_EQ(trace.written(), 6);
+
+  const auto snapshot = trace.snapshot();
+  EXPECT_EQ(snapshot.first_cycle, 2);
+  ASSERT_EQ(snapshot.records.size(), 4);
+  EXPECT_EQ(snapshot.records.front().pc, 0x204);
+  EXPECT_EQ(snapshot.records.back().pc, 0x20A);
+}
+
+TEST(trace_test, flags_timer_changes) {
+  arch::TraceBuffer trace(8);
+  trace.write(record_at(0x200, 5));
+  trace.write(record_at(0x202, 5));
+  trace.write(record_at(0x204, 4));
+
+  const auto snapshot = trace.snapshot();
+  EXPECT_NE(snapshot.records[0].flags & arch::trace_timers_changed, 0);
+  EXPECT_EQ(snapshot.records[1].flags & arch::trace_timers_changed, 0);
+  EXPECT_NE(snapshot.records[2].flags & arch::trace_timers_changed, 0);
+
+  EXPECT_EQ(arch::trace_record_line(2, snapshot.records[2]),
+            "           2  0204  7001  ADD V0, 0x01     V0=04 VF=00 I=000 DT=04 ST=00");
+  EXPECT_EQ(arch::trace_record_line(1, snapshot.records[1]),
+            "           1  0202  7001  ADD V0, 0x01     V0=02 VF=00 I=000");
+}
+
+TEST(trace_test, dumps_header_and_records) {
+  arch::TraceBuffer trace(2);
+  for (unsigned short i = 0; i < 3; i++) {
+    trace.write(record_at(static_cast<unsigned short>(0x200 + 2 * i), 0));
+  }
+
+  const std::string path = testing::TempDir() + "trace_test.trace";
+  ASSERT_TRUE(trace.dump(path));
+  std::ifstream file(path, std::fstream::binary);
+  const std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+  std::remove(path.c_str());
+
+  ASSERT_EQ(bytes.size(), sizeof(arch::TraceFileHeader) + 2 * sizeof(arch::TraceRecord));
+  arch::TraceFileHeader header{};
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  EXPECT_EQ(header.magic, arch::trace_magic);
+  EXPECT_EQ(header.version, arch::trace_version);
+  EXPECT_EQ(header.first_cycle, 1);
+  EXPECT_EQ(header.count, 2);
+
+  arch::TraceRecord last{};
+  std::memcpy(&last, bytes.data() + sizeof(header) + sizeof(last), sizeof(last));
+  EXPECT_EQ(last.pc, 0x204);
+}
+
+TEST(trace_test, snapshot_while_writing_keeps_intact_records) {
+  // Every record carries its own cycle, so a torn or mislabelled one shows up as a mismatch
+  arch::TraceBuffer trace(64);
+  constexpr unsigned long long total = 200000;
+  std::thread writer([&trace] {
+    for (unsigned long long cycle = 0; cycle < total; cycle++) {
+      const auto low = static_cast<unsigned short>(cycle);
+      const auto high = static_cast<unsigned short>(cycle >> 16);
+      trace.write({low, high, low, 0x0, 0x00, 0x00, 0x00, 0x00, 0});
+    }
+  });
+
+  auto intact = true;
+  while (intact && trace.written() < total) {
+    const auto snapshot = trace.snapshot();
+    for (size_t i = 0; i < snapshot.records.size(); i++) {
+      const auto cycle = snapshot.first_cycle + i;
+      const auto& record = snapshot.records[i];
+      intact = intact && record.pc == static_cast<unsigned short>(cycle)
+               && record.opcode == static_cast<unsigned short>(cycle >> 16)
+               && record.index == record.pc;
+    }
+  }
+  writer.join();
+  EXPECT_TRUE(intact);
+
+  const auto snapshot = trace.snapshot();
+  EXPECT_EQ(snapshot.first_cycle, total - 64);
+  EXPECT_EQ(snapshot.records.size(), 64);
+}
+
+#if defined(CHIP8_TRACE)
+TEST(trace_test, cpu_records_every_instruction) {
+  // 0x200: 6A07 (VA = 7), 0x202: A123 (I = 0x123), 0x204: 8AA4 (VA += VA), 0x206: 1206 (jump)
+  Chip8 emulator(std::vector<unsigned char>{0x6A, 0x07, 0xA1, 0x23, 0x8A, 0xA4, 0x12, 0x06});
+  emulator.run_cycles(5);
+
+  const auto snapshot = emulator.trace_buffer().snapshot();
+  ASSERT_EQ(snapshot.records.size(), 5);
+  EXPECT_EQ(snapshot.records[0].pc, 0x200);
+  EXPECT_EQ(snapshot.records[0].reg, 0xA);
+  EXPECT_EQ(snapshot.records[0].value, 7);
+  EXPECT_EQ(snapshot.records[1].reg, arch::no_register);
+  EXPECT_EQ(snapshot.records[1].index, 0x123);
+  EXPECT_EQ(snapshot.records[2].opcode, 0x8AA4);
+  EXPECT_EQ(snapshot.records[2].value, 14);
+  EXPECT_EQ(snapshot.records[4].pc, 0x206);
+
+  // Long past the point hot code would have been translated
+  emulator.run_cycles(10 * arch::default_hot_threshold);
+  EXPECT_EQ(emulator.trace_buffer().written(), 5 + 10 * arch::default_hot_threshold);
+}
+#endif